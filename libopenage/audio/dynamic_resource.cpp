@@ -194,7 +194,11 @@ void DynamicResource::load_chunk_async(std::shared_ptr<chunk_info_t> chunk_info,
 		// functions, we return zero
 		return 0;
 	};
-	this->loading_job_group.enqueue<int>(loading_function);
+
+	// the audio thread plays the chunk soon, so it is loaded first
+	job::job_options options;
+	options.priority = job::job_priority::realtime;
+	this->loading_job_group.enqueue<int>(loading_function, {}, options);
 }
 
 
@@ -0,0 +1,58 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Waits between the attempts of a lock-free operation that has to wait for
+ * another thread: it yields at first and then sleeps longer, up to a
+ * millisecond, so a waiting thread soon stops taking processor time.
+ */
+class Backoff {
+public:
+	Backoff()
+		:
+		attempts{0} {}
+
+	/** Waits before the next attempt. */
+	void wait() {
+		this->wait_until(std::chrono::steady_clock::time_point::max());
+	}
+
+	/**
+	 * Waits before the next attempt, but not beyond the deadline.
+	 * Returns false if the deadline has passed.
+	 */
+	template<typename Clock, typename Duration>
+	bool wait_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+		if (Clock::now() >= deadline) {
+			return false;
+		}
+		if (this->attempts < yields) {
+			std::this_thread::yield();
+		}
+		else {
+			size_t shift = std::min<size_t>(this->attempts - yields, 10);
+			auto wake = Clock::now() + std::chrono::microseconds{1 << shift};
+			std::this_thread::sleep_until(std::min<std::chrono::time_point<Clock, Duration>>(
+				std::chrono::time_point_cast<Duration>(wake), deadline
+			));
+		}
+		this->attempts += 1;
+		return true;
+	}
+
+private:
+	/** Attempts that only yield before the thread sleeps. */
+	static constexpr size_t yields = 64;
+
+	size_t attempts;
+};
+
+}} // namespace openage::datastructure
@@ -6,6 +6,7 @@
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <utility>
 
 namespace openage {
 namespace datastructure {
@@ -47,13 +48,16 @@ public:
 		return this->queue.front();
 	}
 
-	/** Removes the front item of the queue and returns it. */
-	T &pop() {
+	/**
+	 * Removes the front item of the queue and returns it. The item is
+	 * moved out before it is removed, a reference would dangle.
+	 */
+	T pop() {
 		std::unique_lock<mutex_t> lock{this->mutex};
 		while (this->queue.empty()) {
 			this->elements_available.wait(lock);
 		}
-		auto &item = this->queue.front();
+		T item = std::move(this->queue.front());
 		this->queue.pop();
 		return item;
 	}
@@ -66,6 +70,14 @@ public:
 		this->elements_available.notify_one();
 	}
 
+	/** Appends the given item to the queue. */
+	void push(T &&item) {
+		std::unique_lock<mutex_t> lock{this->mutex};
+		this->queue.push(std::move(item));
+		lock.unlock();
+		this->elements_available.notify_one();
+	}
+
 	/**
 	 * Return a lock to the queue so multiple
 	 * of the above operations can be done sequentially
@@ -0,0 +1,253 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../error/error.h"
+#include "backoff.h"
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * A bounded queue that many threads push to and take from, without locks.
+ *
+ * The items are stored in a ring buffer. Each slot has a sequence number
+ * that tells whether it waits for a producer or a consumer of the current
+ * round, so a thread claims a slot with one compare and swap on the
+ * position counter of its side (the queue of Dmitry Vyukov).
+ *
+ * The try_ operations fail at once if the queue is full or empty, the
+ * others wait until they succeed or their time ran out. Items are moved
+ * in and out, so move-only types can be queued; an item whose push failed
+ * was not moved from. Moving and creating the items must not throw.
+ */
+template <typename T>
+class MPMCQueue {
+	// a claimed slot must be filled and emptied, or the queue would block
+	static_assert(std::is_nothrow_move_constructible<T>::value and
+	              std::is_nothrow_move_assignable<T>::value,
+	              "queued items must be moved without exceptions");
+
+	struct slot {
+		std::atomic<size_t> sequence;
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+		T *item() {
+			return reinterpret_cast<T *>(&this->storage);
+		}
+	};
+
+public:
+	/**
+	 * Creates an empty queue, the capacity must be a power of two.
+	 */
+	explicit MPMCQueue(size_t capacity=1024)
+		:
+		mask{capacity - 1},
+		slots{new slot[capacity]} {
+
+		ENSURE(capacity >= 2 and (capacity & (capacity - 1)) == 0,
+		       "queue capacity " << capacity << " is not a power of two");
+
+		for (size_t i = 0; i < capacity; i++) {
+			this->slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		this->push_position.store(0, std::memory_order_relaxed);
+		this->pop_position.store(0, std::memory_order_relaxed);
+	}
+
+	/** Destroys the items that were not taken. */
+	~MPMCQueue() {
+		size_t position;
+		while (slot *taken = this->claim_pop(position)) {
+			taken->item()->~T();
+		}
+	}
+
+	MPMCQueue(const MPMCQueue &) = delete;
+	MPMCQueue &operator =(const MPMCQueue &) = delete;
+
+	/** Appends the item, returns false if the queue is full. */
+	template <typename U>
+	bool try_push(U &&item) {
+		static_assert(std::is_nothrow_constructible<T, U &&>::value,
+		              "queued items must be created without exceptions");
+
+		size_t position;
+		slot *claimed = this->claim_push(position);
+		if (claimed == nullptr) {
+			return false;
+		}
+		new (&claimed->storage) T(std::forward<U>(item));
+		claimed->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Appends the item, waits while the queue is full. */
+	template <typename U>
+	void push(U &&item) {
+		Backoff backoff;
+		while (not this->try_push(std::forward<U>(item))) {
+			backoff.wait();
+		}
+	}
+
+	/**
+	 * Appends the item, waits at most the given time while the queue is
+	 * full. Returns false if it is still full.
+	 */
+	template <typename U, typename Rep, typename Period>
+	bool try_push_for(U &&item, const std::chrono::duration<Rep, Period> &timeout) {
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		Backoff backoff;
+		while (not this->try_push(std::forward<U>(item))) {
+			if (not backoff.wait_until(deadline)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Moves the oldest item to result, returns false if the queue is empty. */
+	bool try_pop(T &result) {
+		size_t position;
+		slot *claimed = this->claim_pop(position);
+		if (claimed == nullptr) {
+			return false;
+		}
+		result = std::move(*claimed->item());
+		this->release_pop(claimed, position);
+		return true;
+	}
+
+	/** Removes the oldest item and returns it, waits while the queue is empty. */
+	T pop() {
+		size_t position;
+		slot *claimed;
+		Backoff backoff;
+		while ((claimed = this->claim_pop(position)) == nullptr) {
+			backoff.wait();
+		}
+		T result{std::move(*claimed->item())};
+		this->release_pop(claimed, position);
+		return result;
+	}
+
+	/**
+	 * Moves the oldest item to result, waits at most the given time while
+	 * the queue is empty. Returns false if it is still empty.
+	 */
+	template <typename Rep, typename Period>
+	bool try_pop_for(T &result, const std::chrono::duration<Rep, Period> &timeout) {
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		Backoff backoff;
+		while (not this->try_pop(result)) {
+			if (not backoff.wait_until(deadline)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Whether the queue looked empty, which may have changed when this returns.
+	 */
+	bool empty() const {
+		size_t position = this->pop_position.load(std::memory_order_relaxed);
+		const slot &next = this->slots[position & this->mask];
+		return next.sequence.load(std::memory_order_acquire) != position + 1;
+	}
+
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+
+private:
+	/**
+	 * Claims the slot at the push position,
+	 * nullptr if the queue is full.
+	 */
+	slot *claim_push(size_t &position) {
+		position = this->push_position.load(std::memory_order_relaxed);
+		while (true) {
+			slot *next = &this->slots[position & this->mask];
+			size_t sequence = next->sequence.load(std::memory_order_acquire);
+			intptr_t round = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (round == 0) {
+				if (this->push_position.compare_exchange_weak(position, position + 1,
+				                                              std::memory_order_relaxed)) {
+					return next;
+				}
+			}
+			else if (round < 0) {
+				// the consumers did not free the slot of the last round
+				return nullptr;
+			}
+			else {
+				position = this->push_position.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Claims the slot at the pop position,
+	 * nullptr if the queue is empty.
+	 */
+	slot *claim_pop(size_t &position) {
+		position = this->pop_position.load(std::memory_order_relaxed);
+		while (true) {
+			slot *next = &this->slots[position & this->mask];
+			size_t sequence = next->sequence.load(std::memory_order_acquire);
+			intptr_t round = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+			if (round == 0) {
+				if (this->pop_position.compare_exchange_weak(position, position + 1,
+				                                             std::memory_order_relaxed)) {
+					return next;
+				}
+			}
+			else if (round < 0) {
+				// no producer filled the slot yet
+				return nullptr;
+			}
+			else {
+				position = this->pop_position.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/** Destroys the taken item and frees the slot for the next round. */
+	void release_pop(slot *claimed, size_t position) {
+		claimed->item()->~T();
+		claimed->sequence.store(position + this->mask + 1, std::memory_order_release);
+	}
+
+	size_t mask;
+
+	std::unique_ptr<slot[]> slots;
+
+	/** Position of the next push, producers increment it. */
+	std::atomic<size_t> push_position;
+
+	/**
+	 * keeps the positions, which are written by different threads,
+	 * on different cache lines.
+	 */
+	struct {
+		char bytes[64];
+	} padding;
+
+	/** Position of the next pop, consumers increment it. */
+	std::atomic<size_t> pop_position;
+};
+
+}} // namespace openage::datastructure
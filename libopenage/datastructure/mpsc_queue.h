@@ -0,0 +1,100 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * A queue that many threads can push to and one thread takes from.
+ *
+ * Pushing is lock-free: the new node is put in front of a linked list
+ * with a compare and swap. The consumer detaches the whole list at once
+ * and reverses it, so the items are taken in the order they were pushed.
+ * Checking for items is a single atomic load.
+ */
+template <typename T>
+class MPSCQueue {
+	struct node {
+		T item;
+		node *next;
+	};
+
+public:
+	MPSCQueue()
+		:
+		head{nullptr} {}
+
+	~MPSCQueue() {
+		this->clear();
+	}
+
+	MPSCQueue(const MPSCQueue &) = delete;
+	MPSCQueue &operator =(const MPSCQueue &) = delete;
+
+	/** Appends the given item to the queue. Can be called from any thread. */
+	void push(T item) {
+		node *added = new node{std::move(item), this->head.load(std::memory_order_relaxed)};
+		while (not this->head.compare_exchange_weak(added->next, added,
+		                                            std::memory_order_release,
+		                                            std::memory_order_relaxed)) {}
+	}
+
+	/** Returns whether the queue is empty, without locking. */
+	bool empty() const {
+		return this->head.load(std::memory_order_acquire) == nullptr;
+	}
+
+	/**
+	 * Removes all items from the queue and calls f for each, oldest first.
+	 * Only one thread may take items at a time. Items that are pushed
+	 * meanwhile are left for the next call.
+	 */
+	template <typename F>
+	void take_all(F f) {
+		node *list = this->head.exchange(nullptr, std::memory_order_acquire);
+
+		node *ordered = nullptr;
+		while (list != nullptr) {
+			node *next = list->next;
+			list->next = ordered;
+			ordered = list;
+			list = next;
+		}
+
+		// frees the items that are left if f throws
+		node_list remaining{ordered};
+		while (remaining.first != nullptr) {
+			std::unique_ptr<node> current{remaining.first};
+			remaining.first = current->next;
+			f(current->item);
+		}
+	}
+
+	/** Removes all elements from the queue. */
+	void clear() {
+		this->take_all([](T &) {});
+	}
+
+private:
+	struct node_list {
+		node *first;
+
+		~node_list() {
+			while (this->first != nullptr) {
+				node *next = this->first->next;
+				delete this->first;
+				this->first = next;
+			}
+		}
+	};
+
+	/** The most recently pushed node. */
+	std::atomic<node *> head;
+};
+
+}} // namespace openage::datastructure
@@ -0,0 +1,215 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../error/error.h"
+#include "backoff.h"
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * A bounded queue that one thread pushes to and another thread takes
+ * from, without locks.
+ *
+ * Like the MPMCQueue, but as each position is only written by one thread,
+ * it needs no compare and swap and no sequence numbers. Each side caches
+ * the position of the other one and only reloads it when the queue looks
+ * full or empty, so the threads rarely touch each other's cache line.
+ *
+ * The operations are the same as those of the MPMCQueue.
+ */
+template <typename T>
+class SPSCQueue {
+	// same requirements as the MPMCQueue, so both can be exchanged
+	static_assert(std::is_nothrow_move_constructible<T>::value and
+	              std::is_nothrow_move_assignable<T>::value,
+	              "queued items must be moved without exceptions");
+
+	using storage_t = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+public:
+	/**
+	 * Creates an empty queue, the capacity must be a power of two.
+	 */
+	explicit SPSCQueue(size_t capacity=1024)
+		:
+		mask{capacity - 1},
+		slots{new storage_t[capacity]},
+		push_position{0},
+		cached_pop_position{0},
+		pop_position{0},
+		cached_push_position{0} {
+
+		ENSURE(capacity >= 2 and (capacity & (capacity - 1)) == 0,
+		       "queue capacity " << capacity << " is not a power of two");
+	}
+
+	/** Destroys the items that were not taken. */
+	~SPSCQueue() {
+		size_t end = this->push_position.load(std::memory_order_acquire);
+		for (size_t i = this->pop_position.load(std::memory_order_relaxed); i != end; i++) {
+			this->item(i)->~T();
+		}
+	}
+
+	SPSCQueue(const SPSCQueue &) = delete;
+	SPSCQueue &operator =(const SPSCQueue &) = delete;
+
+	/**
+	 * Appends the item, returns false if the queue is full.
+	 * Only the producer may call this.
+	 */
+	template <typename U>
+	bool try_push(U &&item) {
+		static_assert(std::is_nothrow_constructible<T, U &&>::value,
+		              "queued items must be created without exceptions");
+
+		size_t position = this->push_position.load(std::memory_order_relaxed);
+		if (position - this->cached_pop_position > this->mask) {
+			this->cached_pop_position = this->pop_position.load(std::memory_order_acquire);
+			if (position - this->cached_pop_position > this->mask) {
+				return false;
+			}
+		}
+
+		new (this->item(position)) T(std::forward<U>(item));
+		this->push_position.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Appends the item, waits while the queue is full. */
+	template <typename U>
+	void push(U &&item) {
+		Backoff backoff;
+		while (not this->try_push(std::forward<U>(item))) {
+			backoff.wait();
+		}
+	}
+
+	/**
+	 * Appends the item, waits at most the given time while the queue is
+	 * full. Returns false if it is still full.
+	 */
+	template <typename U, typename Rep, typename Period>
+	bool try_push_for(U &&item, const std::chrono::duration<Rep, Period> &timeout) {
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		Backoff backoff;
+		while (not this->try_push(std::forward<U>(item))) {
+			if (not backoff.wait_until(deadline)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Moves the oldest item to result, returns false if the queue is empty.
+	 * Only the consumer may call this.
+	 */
+	bool try_pop(T &result) {
+		size_t position;
+		if (not this->ready(position)) {
+			return false;
+		}
+		result = std::move(*this->item(position));
+		this->release(position);
+		return true;
+	}
+
+	/** Removes the oldest item and returns it, waits while the queue is empty. */
+	T pop() {
+		size_t position;
+		Backoff backoff;
+		while (not this->ready(position)) {
+			backoff.wait();
+		}
+		T result{std::move(*this->item(position))};
+		this->release(position);
+		return result;
+	}
+
+	/**
+	 * Moves the oldest item to result, waits at most the given time while
+	 * the queue is empty. Returns false if it is still empty.
+	 */
+	template <typename Rep, typename Period>
+	bool try_pop_for(T &result, const std::chrono::duration<Rep, Period> &timeout) {
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		Backoff backoff;
+		while (not this->try_pop(result)) {
+			if (not backoff.wait_until(deadline)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Whether the queue looked empty, which may have changed when this returns.
+	 */
+	bool empty() const {
+		return (this->pop_position.load(std::memory_order_relaxed)
+		        == this->push_position.load(std::memory_order_acquire));
+	}
+
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+
+private:
+	T *item(size_t position) {
+		return reinterpret_cast<T *>(&this->slots[position & this->mask]);
+	}
+
+	/** Whether an item is at the pop position, which is returned. */
+	bool ready(size_t &position) {
+		position = this->pop_position.load(std::memory_order_relaxed);
+		if (position == this->cached_push_position) {
+			this->cached_push_position = this->push_position.load(std::memory_order_acquire);
+			if (position == this->cached_push_position) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Destroys the taken item and frees its slot for the producer. */
+	void release(size_t position) {
+		this->item(position)->~T();
+		this->pop_position.store(position + 1, std::memory_order_release);
+	}
+
+	size_t mask;
+
+	std::unique_ptr<storage_t[]> slots;
+
+	/** Position of the next push, only the producer writes it. */
+	std::atomic<size_t> push_position;
+
+	/** The pop position the producer saw last. */
+	size_t cached_pop_position;
+
+	/**
+	 * keeps the producer's and the consumer's positions
+	 * on different cache lines.
+	 */
+	struct {
+		char bytes[64];
+	} padding;
+
+	/** Position of the next pop, only the consumer writes it. */
+	std::atomic<size_t> pop_position;
+
+	/** The push position the consumer saw last. */
+	size_t cached_push_position;
+};
+
+}} // namespace openage::datastructure
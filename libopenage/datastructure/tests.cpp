@@ -2,12 +2,24 @@
 
 #include "tests.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <utility>
+#include <vector>
 
+#include "../log/log.h"
 #include "../testing/testing.h"
+#include "../util/timing.h"
 
+#include "concurrent_queue.h"
 #include "constexpr_map.h"
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
 #include "pairing_heap.h"
+#include "spsc_queue.h"
+#include "timer_wheel.h"
 
 
 namespace openage {
@@ -162,4 +174,222 @@ void constexpr_map() {
 	cmap.get(42) == 9001 or TESTFAIL;
 }
 
+
+
+void mpsc_queue() {
+	constexpr int producers = 4;
+	constexpr int per_producer = 20000;
+
+	MPSCQueue<std::pair<int, int>> queue;
+	queue.empty() or TESTFAIL;
+
+	// the items of one producer must be taken in the order it pushed them
+	std::vector<int> next(producers, 0);
+	int taken = 0;
+	auto take = [&](std::pair<int, int> &item) {
+		(item.second == next[item.first]) or TESTFAIL;
+		next[item.first] += 1;
+		taken += 1;
+	};
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&queue, p] {
+			for (int i = 0; i < per_producer; i++) {
+				queue.push(std::make_pair(p, i));
+			}
+		});
+	}
+
+	while (taken < producers * per_producer) {
+		queue.take_all(take);
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	queue.empty() or TESTFAIL;
+	for (int p = 0; p < producers; p++) {
+		(next[p] == per_producer) or TESTFAIL;
+	}
+
+	// items that aren't taken are freed with the queue
+	queue.push(std::make_pair(0, 0));
+	not queue.empty() or TESTFAIL;
+}
+
+
+
+/**
+ * Fills and empties a bounded queue of move-only items on one thread,
+ * then passes numbered items from producer to consumer threads. Each
+ * consumer must see the items of each producer in the order they were
+ * pushed.
+ */
+template <template <typename> class Queue>
+void test_bounded_queue(int producers, int consumers) {
+	Queue<std::unique_ptr<int>> queue{8};
+	queue.empty() or TESTFAIL;
+
+	for (int i = 0; i < 8; i++) {
+		queue.try_push(std::unique_ptr<int>{new int{i}}) or TESTFAIL;
+	}
+	std::unique_ptr<int> rejected{new int{8}};
+	queue.try_push(std::move(rejected)) and TESTFAIL;
+	(rejected and *rejected == 8) or TESTFAIL;
+	queue.try_push_for(std::move(rejected), std::chrono::milliseconds{1}) and TESTFAIL;
+
+	std::unique_ptr<int> item;
+	for (int i = 0; i < 8; i++) {
+		queue.try_pop(item) or TESTFAIL;
+		(*item == i) or TESTFAIL;
+	}
+	queue.try_pop(item) and TESTFAIL;
+	queue.try_pop_for(item, std::chrono::milliseconds{1}) and TESTFAIL;
+
+	// items that aren't taken are destroyed with the queue
+	queue.push(std::unique_ptr<int>{new int{0}});
+	(*queue.pop() == 0) or TESTFAIL;
+	queue.push(std::unique_ptr<int>{new int{1}});
+
+	using numbered = std::pair<int, int>;
+	constexpr int per_producer = 20000;
+	int total = producers * per_producer;
+	std::vector<std::vector<int>> last_seen(consumers, std::vector<int>(producers, -1));
+	std::atomic<int> taken{0};
+	std::atomic<int> unordered{0};
+
+	auto channel = std::make_shared<Queue<numbered>>(64);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([channel, p] {
+			for (int i = 0; i < per_producer; i++) {
+				channel->push(numbered{p, i});
+			}
+		});
+	}
+	for (int c = 0; c < consumers; c++) {
+		threads.emplace_back([&, channel, c] {
+			numbered next;
+			while (taken.load() < total) {
+				if (not channel->try_pop_for(next, std::chrono::milliseconds{1})) {
+					continue;
+				}
+				if (next.second <= last_seen[c][next.first]) {
+					unordered++;
+				}
+				last_seen[c][next.first] = next.second;
+				taken++;
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	(taken.load() == total) or TESTFAIL;
+	(unordered.load() == 0) or TESTFAIL;
+	channel->empty() or TESTFAIL;
+}
+
+
+void mpmc_queue() {
+	test_bounded_queue<MPMCQueue>(4, 4);
+}
+
+
+void spsc_queue() {
+	test_bounded_queue<SPSCQueue>(1, 1);
+}
+
+
+/**
+ * Passes integers through the given queue from producer to consumer
+ * threads and logs how long it took.
+ */
+template <typename Queue>
+void measure_queue(const char *name, int producers, int consumers) {
+	constexpr int items = 1000000;
+	Queue queue;
+
+	time_nsec_t start = timing::get_monotonic_time();
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&queue, producers] {
+			for (int i = 0; i < items / producers; i++) {
+				queue.push(i);
+			}
+		});
+	}
+	for (int c = 0; c < consumers; c++) {
+		threads.emplace_back([&queue, consumers] {
+			for (int i = 0; i < items / consumers; i++) {
+				queue.pop();
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	time_nsec_t duration = timing::get_monotonic_time() - start;
+
+	log::log(MSG(info) << name << " with " << producers << " producers and "
+	         << consumers << " consumers: " << duration / 1000000 << " ms");
+}
+
+
+void benchmark_queues() {
+	for (int threads : {1, 2, 4}) {
+		measure_queue<ConcurrentQueue<int>>("ConcurrentQueue", threads, threads);
+		measure_queue<MPMCQueue<int>>("MPMCQueue", threads, threads);
+	}
+	measure_queue<SPSCQueue<int>>("SPSCQueue", 1, 1);
+}
+
+
+
+void timer_wheel() {
+	constexpr time_nsec_t ms = 1000 * 1000;
+	TimerWheel<size_t> wheel{ms};
+
+	// spread over all levels and beyond, some on the same tick
+	std::vector<time_nsec_t> deadlines;
+	for (size_t i = 0; i < 400; i++) {
+		deadlines.push_back((i * i * i * 7919 % 20000000) * ms / 3);
+	}
+	deadlines.push_back(0);
+	deadlines.push_back(5 * ms);
+	deadlines.push_back(5 * ms);
+	for (size_t i = 0; i < deadlines.size(); i++) {
+		wheel.add(deadlines[i], i);
+	}
+	(wheel.size() == deadlines.size()) or TESTFAIL;
+
+	// timers expire at the first step that reaches them
+	std::vector<int> delivered(deadlines.size(), 0);
+	time_nsec_t previous = 0;
+	for (time_nsec_t now = 0; now <= 5000000 * ms; now += 37 * ms + now / 64) {
+		wheel.advance(now, [&](size_t i) {
+			(deadlines[i] <= now and deadlines[i] + ms > previous) or TESTFAIL;
+			delivered[i] += 1;
+		});
+		previous = now;
+	}
+
+	for (size_t i = 0; i < deadlines.size(); i++) {
+		(delivered[i] == (deadlines[i] <= previous ? 1 : 0)) or TESTFAIL;
+	}
+	size_t waiting = wheel.size();
+	(waiting > 0) or TESTFAIL;
+
+	// timers in the past expire at the next step
+	wheel.add(previous - 10 * ms, deadlines.size());
+	int late = 0;
+	wheel.advance(previous, [&](size_t i) {
+		(i == deadlines.size()) or TESTFAIL;
+		late += 1;
+	});
+	(late == 1 and wheel.size() == waiting) or TESTFAIL;
+}
+
 }}} // openage::datastructure::tests
@@ -0,0 +1,174 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../util/timing.h"
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Hierarchical timer wheel: timers that expire at a given time.
+ *
+ * Time is split into ticks of a fixed resolution. Timers closer than
+ * 64 ticks are in the slot of their tick on the first level, timers
+ * further away in coarser slots of the upper levels. When the time
+ * reaches the start of a coarse slot, its timers are moved down to the
+ * finer levels. Adding a timer and advancing by a tick take constant time,
+ * independent of the number of timers.
+ *
+ * Timers never expire early, but up to one resolution late.
+ */
+template <typename T>
+class TimerWheel {
+public:
+	explicit TimerWheel(time_nsec_t resolution)
+		:
+		resolution{resolution},
+		current_tick{0},
+		count{0} {}
+
+	/**
+	 * Adds a timer that expires at the given time. Timers that
+	 * expired already are delivered by the next call of advance.
+	 */
+	void add(time_nsec_t time, T item) {
+		timer added{(time + this->resolution - 1) / this->resolution, std::move(item)};
+		if (added.tick <= this->current_tick) {
+			this->expired.push_back(std::move(added));
+		}
+		else {
+			this->place(std::move(added));
+		}
+		this->count += 1;
+	}
+
+	/**
+	 * Advances to the given time and calls f for each expired timer.
+	 * f may add new timers.
+	 */
+	template <typename F>
+	void advance(time_nsec_t time, F f) {
+		uint64_t target = time / this->resolution;
+
+		this->deliver(this->expired, f);
+
+		if (this->count == 0) {
+			this->current_tick = std::max(this->current_tick, target);
+			return;
+		}
+
+		while (this->current_tick < target) {
+			this->current_tick += 1;
+
+			// move the timers of the coarse slots that begin now to the finer levels
+			for (size_t level = levels - 1; level > 0; level--) {
+				if ((this->current_tick & ((uint64_t{1} << (level_bits * level)) - 1)) == 0) {
+					size_t slot = (this->current_tick >> (level_bits * level)) & slot_mask;
+					std::vector<timer> moved;
+					moved.swap(this->wheel[level][slot]);
+					for (auto &entry : moved) {
+						this->place(std::move(entry));
+					}
+				}
+			}
+
+			this->deliver(this->wheel[0][this->current_tick & slot_mask], f);
+
+			if (this->count == 0) {
+				this->current_tick = target;
+			}
+		}
+	}
+
+	/** Number of timers that have not been delivered yet. */
+	size_t size() const {
+		return this->count;
+	}
+
+	/** Removes all timers. */
+	void clear() {
+		for (auto &level : this->wheel) {
+			for (auto &slot : level) {
+				slot.clear();
+			}
+		}
+		this->expired.clear();
+		this->count = 0;
+	}
+
+private:
+	static constexpr size_t level_bits = 6;
+	static constexpr size_t slot_count = size_t{1} << level_bits;
+	static constexpr uint64_t slot_mask = slot_count - 1;
+	static constexpr size_t levels = 4;
+
+	struct timer {
+		uint64_t tick;
+		T item;
+	};
+
+	/**
+	 * Puts a timer into the slot it is moved down or delivered from.
+	 */
+	void place(timer &&entry) {
+		if (entry.tick <= this->current_tick) {
+			// moved down just now, delivered in this tick
+			this->wheel[0][this->current_tick & slot_mask].push_back(std::move(entry));
+			return;
+		}
+
+		uint64_t delta = entry.tick - this->current_tick;
+		for (size_t level = 0; level < levels; level++) {
+			if (delta < (uint64_t{1} << (level_bits * (level + 1)))) {
+				size_t slot = (entry.tick >> (level_bits * level)) & slot_mask;
+				this->wheel[level][slot].push_back(std::move(entry));
+				return;
+			}
+		}
+
+		// too far away for the wheel: wait in the furthest slot
+		// of the top level, which is looked at again before expiring
+		constexpr size_t top = levels - 1;
+		uint64_t furthest = this->current_tick + (slot_mask << (level_bits * top));
+		size_t slot = (furthest >> (level_bits * top)) & slot_mask;
+		this->wheel[top][slot].push_back(std::move(entry));
+	}
+
+	template <typename F>
+	void deliver(std::vector<timer> &slot, F &f) {
+		std::vector<timer> due;
+		due.swap(slot);
+		this->count -= due.size();
+		for (auto &entry : due) {
+			f(entry.item);
+		}
+	}
+
+	/**
+	 * Length of a tick.
+	 */
+	time_nsec_t resolution;
+
+	/**
+	 * The last tick whose timers were delivered.
+	 */
+	uint64_t current_tick;
+
+	size_t count;
+
+	std::array<std::array<std::vector<timer>, slot_count>, levels> wheel;
+
+	/**
+	 * Timers that were added after they expired.
+	 */
+	std::vector<timer> expired;
+};
+
+}} // namespace openage::datastructure
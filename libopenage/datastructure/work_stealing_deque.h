@@ -0,0 +1,185 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * A deque of pointers that one thread owns and other threads steal from.
+ *
+ * The owner pushes and takes at the bottom, like a stack, without
+ * locking; only taking the last item competes with thieves. Other threads
+ * steal the oldest items from the top with a compare and swap.
+ * This is the deque of Chase and Lev, with the memory orderings of
+ * Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+ *
+ * The items are not owned by the deque. When the ring buffer is full, it
+ * is replaced by one of twice the size; the old ones are kept until the
+ * deque is destroyed, as thieves may still read from them.
+ */
+template <typename T>
+class WorkStealingDeque {
+	class ring {
+	public:
+		explicit ring(size_t capacity)
+			:
+			mask{capacity - 1},
+			items{new std::atomic<T *>[capacity]} {}
+
+		size_t capacity() const {
+			return this->mask + 1;
+		}
+
+		T *get(int64_t index) const {
+			return this->items[index & this->mask].load(std::memory_order_relaxed);
+		}
+
+		void put(int64_t index, T *item) {
+			this->items[index & this->mask].store(item, std::memory_order_relaxed);
+		}
+
+	private:
+		size_t mask;
+		std::unique_ptr<std::atomic<T *>[]> items;
+	};
+
+public:
+	/**
+	 * Creates an empty deque, the capacity must be a power of two.
+	 */
+	explicit WorkStealingDeque(size_t capacity=256)
+		:
+		top{0},
+		bottom{0} {
+
+		this->rings.emplace_back(new ring{capacity});
+		this->current.store(this->rings.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	WorkStealingDeque &operator =(const WorkStealingDeque &) = delete;
+
+	/** Adds an item at the bottom. Only the owner may call this. */
+	void push(T *item) {
+		int64_t b = this->bottom.load(std::memory_order_relaxed);
+		int64_t t = this->top.load(std::memory_order_acquire);
+		ring *items = this->current.load(std::memory_order_relaxed);
+
+		if (b - t > static_cast<int64_t>(items->capacity()) - 1) {
+			items = this->grow(items, t, b);
+		}
+
+		// publishes the item to the thieves that read the new bottom
+		items->put(b, item);
+		this->bottom.store(b + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Removes the newest item, nullptr if there is none.
+	 * Only the owner may call this.
+	 */
+	T *take() {
+		int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+		ring *items = this->current.load(std::memory_order_relaxed);
+		this->bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = this->top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// was empty
+			this->bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T *item = items->get(b);
+		if (t == b) {
+			// the last item, which a thief may take at the same time
+			if (not this->top.compare_exchange_strong(t, t + 1,
+			                                          std::memory_order_seq_cst,
+			                                          std::memory_order_relaxed)) {
+				item = nullptr;
+			}
+			this->bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	/**
+	 * Removes the oldest item, nullptr if there is none or another
+	 * thread took it first. Can be called from any thread.
+	 */
+	T *steal() {
+		int64_t t = this->top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = this->bottom.load(std::memory_order_acquire);
+
+		if (t >= b) {
+			return nullptr;
+		}
+
+		// the ring may be replaced meanwhile, the old one stays readable
+		T *item = this->current.load(std::memory_order_acquire)->get(t);
+		if (not this->top.compare_exchange_strong(t, t + 1,
+		                                          std::memory_order_seq_cst,
+		                                          std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return item;
+	}
+
+	/**
+	 * Whether the deque looked empty, which may have changed when this returns.
+	 */
+	bool empty() const {
+		int64_t b = this->bottom.load(std::memory_order_relaxed);
+		int64_t t = this->top.load(std::memory_order_relaxed);
+		return b <= t;
+	}
+
+private:
+	/**
+	 * Copies the items to a ring of twice the size. Only the owner grows.
+	 */
+	ring *grow(ring *old, int64_t t, int64_t b) {
+		this->rings.emplace_back(new ring{old->capacity() * 2});
+		ring *grown = this->rings.back().get();
+		for (int64_t i = t; i < b; i++) {
+			grown->put(i, old->get(i));
+		}
+		this->current.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+	/**
+	 * Index of the oldest item, thieves increment it.
+	 */
+	std::atomic<int64_t> top;
+
+	/**
+	 * keeps top and bottom, which are written by different threads,
+	 * on different cache lines.
+	 */
+	struct {
+		char bytes[64];
+	} padding;
+
+	/**
+	 * Index past the newest item, only the owner writes it.
+	 */
+	std::atomic<int64_t> bottom;
+
+	std::atomic<ring *> current;
+
+	/**
+	 * all rings the deque had, the current one last.
+	 */
+	std::vector<std::unique_ptr<ring>> rings;
+};
+
+}} // namespace openage::datastructure
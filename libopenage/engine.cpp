@@ -2,9 +2,12 @@
 
 #include "engine.h"
 
+#include <cerrno>
 #include <cstdint>
+#include <limits>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
 #include <time.h>
 #include <epoxy/gl.h>
 #include <SDL2/SDL.h>
@@ -17,6 +20,7 @@
 #include "gamestate/generator.h"
 #include "gui/gui.h"
 #include "log/log.h"
+#include "pathfinding/path_service.h"
 #include "renderer/font/font.h"
 #include "renderer/font/font_manager.h"
 #include "renderer/text.h"
@@ -43,6 +47,39 @@ namespace openage {
 coord_data coord_global_tmp_TODO;
 
 
+namespace {
+
+/**
+ * parse the value given to a numeric console variable.
+ *
+ * @returns false and logs the reason if the value is
+ *          no number from min to max.
+ */
+bool parse_cvar_number(const std::string &name, const std::string &value,
+                       unsigned int min, unsigned int max, unsigned int *result) {
+	bool valid = (not value.empty() and
+	              value.find_first_not_of("0123456789") == std::string::npos);
+
+	unsigned long long number = 0;
+	if (valid) {
+		errno = 0;
+		number = strtoull(value.c_str(), nullptr, 10);
+		valid = (errno != ERANGE and number >= min and number <= max);
+	}
+
+	if (not valid) {
+		log::log(MSG(warn) << "ignoring " << name << " = '" << value << "', "
+		                   << "it must be a number from " << min << " to " << max);
+		return false;
+	}
+
+	*result = static_cast<unsigned int>(number);
+	return true;
+}
+
+} // anonymous namespace
+
+
 Engine::Engine(const util::Path &root_dir,
                int32_t fps_limit,
                bool gl_debug,
@@ -70,6 +107,37 @@ Engine::Engine(const util::Path &root_dir,
 		this->ns_per_frame = 0;
 	}
 
+	// the simulation runs in fixed steps, independent of the fps
+	this->cvar_manager.create("SIM_TICK_RATE", std::make_pair(
+		[this]() {
+			return std::to_string(this->simulation_settings.get_tick_rate());
+		},
+		[this](std::string value) {
+			unsigned int tick_rate;
+			if (not parse_cvar_number("SIM_TICK_RATE", value, 1, max_tick_rate, &tick_rate)) {
+				return;
+			}
+			this->simulation_settings.set_tick_rate(tick_rate);
+			if (this->game) {
+				this->game->clock.set_tick_rate(this->simulation_settings.get_tick_rate());
+			}
+		}));
+	this->cvar_manager.create("SIM_MAX_CATCH_UP", std::make_pair(
+		[this]() {
+			return std::to_string(this->simulation_settings.get_max_catch_up());
+		},
+		[this](std::string value) {
+			unsigned int max_catch_up;
+			if (not parse_cvar_number("SIM_MAX_CATCH_UP", value, 1,
+			                          std::numeric_limits<unsigned int>::max(), &max_catch_up)) {
+				return;
+			}
+			this->simulation_settings.set_max_catch_up(max_catch_up);
+			if (this->game) {
+				this->game->clock.set_max_catch_up(this->simulation_settings.get_max_catch_up());
+			}
+		}));
+
 	this->font_manager = std::make_unique<renderer::FontManager>();
 	for (uint32_t size : {12, 20}) {
 		fonts[size] = this->font_manager->get_font("DejaVu Serif", "Book", size);
@@ -400,6 +468,9 @@ void Engine::loop() {
 				mov_x, mov_y,
 				static_cast<float>(this->lastframe_duration_nsec()) / 1e6);
 
+			// path searches near the camera are served first
+			this->game->placed_units.get_path_service()->set_focus(this->coord.camgame_phys);
+
 			// update the currently running game
 			this->game->update(this->lastframe_duration_nsec());
 		}
@@ -590,11 +661,17 @@ void Engine::start_game(std::unique_ptr<GameMain> &&game) {
 
 	this->game = std::move(game);
 	this->game->set_parent(this);
+	this->game->placed_units.set_job_manager(&this->job_manager);
+	this->game->clock.set_tick_rate(this->simulation_settings.get_tick_rate());
+	this->game->clock.set_max_catch_up(this->simulation_settings.get_max_catch_up());
 }
 
 void Engine::start_game(const Generator &generator) {
 	this->game = std::make_unique<GameMain>(generator);
 	this->game->set_parent(this);
+	this->game->placed_units.set_job_manager(&this->job_manager);
+	this->game->clock.set_tick_rate(this->simulation_settings.get_tick_rate());
+	this->game->clock.set_max_catch_up(this->simulation_settings.get_max_catch_up());
 }
 
 void Engine::end_game() {
@@ -18,6 +18,7 @@
 #include "coord/window.h"
 // pxd: from libopenage.cvar cimport CVarManager
 #include "cvar/cvar.h"
+#include "gamestate/simulation_clock.h"
 #include "gui/engine_info.h"
 #include "handlers.h"
 #include "job/job_manager.h"
@@ -332,6 +333,12 @@ private:
 	 */
 	time_nsec_t ns_per_frame;
 
+	/**
+	 * tick rate and catch up limit of the simulation,
+	 * set by cvars and applied to each started game.
+	 */
+	SimulationClock simulation_settings;
+
 	/**
 	 * input event processor objects.
 	 * called for each captured sdl input event.
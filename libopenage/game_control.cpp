@@ -593,7 +593,7 @@ void EditorMode::paint_terrain_at(const coord::window &point) {
 	auto mousepos_tile = mousepos_phys3.to_tile3().to_tile();
 
 	TerrainChunk *chunk = terrain->get_create_chunk(mousepos_tile);
-	chunk->get_data(mousepos_tile)->terrain_id = editor_current_terrain;
+	chunk->get_data(mousepos_tile).set_terrain_id(editor_current_terrain);
 }
 
 void EditorMode::paint_entity_at(const coord::window &point, const bool del) {
@@ -606,10 +606,10 @@ void EditorMode::paint_entity_at(const coord::window &point, const bool del) {
 
 	TerrainChunk *chunk = terrain->get_create_chunk(mousepos_tile);
 	// TODO : better detection of presence of unit
-	if (!chunk->get_data(mousepos_tile)->obj.empty()) {
+	if (!chunk->get_data(mousepos_tile).obj.empty()) {
 		if (del) {
 			// delete first object currently standing at the clicked position
-			TerrainObject *obj = chunk->get_data(mousepos_tile)->obj[0];
+			TerrainObject *obj = chunk->get_data(mousepos_tile).obj[0];
 			obj->remove();
 		}
 	} else if (!del && this->current_type_id != -1) {
@@ -61,7 +61,17 @@ GameSpec *GameMain::get_spec() {
 }
 
 void GameMain::update(time_nsec_t lastframe_duration) {
-	this->placed_units.update_all(lastframe_duration);
+	unsigned int ticks = this->clock.advance(lastframe_duration);
+	for (unsigned int i = 0; i < ticks; i++) {
+		this->tick();
+	}
+
+	// the units are drawn between the last two steps
+	this->placed_units.set_interpolation(this->clock.interpolation());
+}
+
+void GameMain::tick() {
+	this->placed_units.update_all(this->clock.tick_duration());
 }
 
 Civilisation *GameMain::add_civ(int civ_id) {
@@ -10,6 +10,7 @@
 
 #include "market.h"
 #include "player.h"
+#include "simulation_clock.h"
 #include "team.h"
 #include "../options.h"
 #include "../unit/unit_container.h"
@@ -61,10 +62,21 @@ public:
 	GameSpec *get_spec();
 
 	/**
-	 * updates the game by one frame
+	 * updates the game for the real time of one frame,
+	 * which runs as many fixed steps as the clock allows
 	 */
 	void update(time_nsec_t lastframe_duration);
 
+	/**
+	 * simulates one fixed step, independent of the real time
+	 */
+	void tick();
+
+	/**
+	 * splits the real time into the fixed steps of the simulation
+	 */
+	SimulationClock clock;
+
 	/**
 	 * map information
 	 */
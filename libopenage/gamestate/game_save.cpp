@@ -53,18 +53,34 @@ void load_unit(std::ifstream &file, openage::GameMain *game) {
 	}
 }
 
-void save_tile_content(std::ofstream &file, openage::TileContent *content) {
-	file << content->terrain_id << std::endl;
-	file << content->obj.size() << std::endl;
+void save_tile_content(std::ofstream &file, openage::TileContent content) {
+	file << content.get_terrain_id() << std::endl;
+	file << content.obj.size() << std::endl;
 }
 
-TileContent load_tile_content(std::ifstream &file) {
-	openage::TileContent content;
-	file >> content.terrain_id;
+void load_tile_content(std::istream &file, openage::TileContent content) {
+	openage::terrain_t terrain_id;
+	file >> terrain_id;
+	content.set_terrain_id(terrain_id);
 
 	unsigned int o_size;
 	file >> o_size;
-	return content;
+}
+
+void load_chunks(std::istream &file, openage::Terrain *terrain) {
+	unsigned int num_chunks;
+	file >> num_chunks;
+	for (unsigned int c = 0; c < num_chunks; ++c) {
+		coord::chunk_t ne, se;
+		size_t tile_count;
+		file >> ne;
+		file >> se;
+		file >> tile_count;
+		openage::TerrainChunk *chunk = terrain->get_create_chunk(coord::chunk{ne, se});
+		for (size_t p = 0; p < tile_count; ++p) {
+			load_tile_content( file, chunk->get_data(p) );
+		}
+	}
 }
 
 void save(openage::GameMain *game, std::string fname) {
@@ -123,19 +139,7 @@ void load(openage::GameMain *game, std::string fname) {
 	file >> build;
 
 	// read terrain chunks
-	unsigned int num_chunks;
-	file >> num_chunks;
-	for (unsigned int c = 0; c < num_chunks; ++c) {
-		coord::chunk_t ne, se;
-		size_t tile_count;
-		file >> ne;
-		file >> se;
-		file >> tile_count;
-		openage::TerrainChunk *chunk = game->terrain->get_create_chunk(coord::chunk{ne, se});
-		for (size_t p = 0; p < tile_count; ++p) {
-			*chunk->get_data(p) = load_tile_content( file );
-		}
-	}
+	load_chunks(file, game->terrain.get());
 
 	game->placed_units.reset();
 	unsigned int num_units;
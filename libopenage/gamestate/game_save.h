@@ -1,7 +1,8 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <istream>
 #include <string>
 
 namespace openage {
@@ -24,4 +25,10 @@ void save(openage::GameMain *, std::string fname);
  */
 void load(openage::GameMain *, std::string fname);
 
+/**
+ * read the saved terrain chunks into the terrain,
+ * creating the chunks that don't exist yet.
+ */
+void load_chunks(std::istream &file, openage::Terrain *terrain);
+
 }} // openage::gameio
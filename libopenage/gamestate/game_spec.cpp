@@ -11,6 +11,7 @@
 #include "../gamedata/blending_mode.gen.h"
 #include "../gamedata/string_resource.gen.h"
 #include "../gamedata/terrain.gen.h"
+#include "../job/parallel.h"
 #include "../log/log.h"
 #include "../rng/global_rng.h"
 #include "../unit/producer.h"
@@ -208,8 +209,26 @@ void GameSpec::on_gamedata_loaded(const gamedata::empiresdat &gamedata) {
 
 	log::log(INFO << "Loading sounds...");
 
+	// paths of the single sound files, and whether they exist
+	std::vector<util::Path> sound_paths;
+	for (const gamedata::sound &sound : gamedata.sounds.data) {
+		for (const gamedata::sound_item &item : sound.sound_items.data) {
+			sound_paths.push_back(sound_dir[util::sformat("%d.opus", item.resource_id)]);
+		}
+	}
+
+	// the lookups may wait for the disk, so they are done by the workers
+	std::vector<char> sound_exists(sound_paths.size(), false);
+	job::JobManager *job_manager = this->assetmanager->get_engine()->get_job_manager();
+	job::parallel_for(job_manager, 0, sound_paths.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			sound_exists[i] = sound_paths[i].is_file();
+		}
+	});
+
 	// playable sound files for the audio manager
 	std::vector<audio::resource_def> load_sound_files;
+	size_t sound_index = 0;
 
 	// all sounds defined in the game specification
 	for (const gamedata::sound &sound : gamedata.sounds.data) {
@@ -219,16 +238,16 @@ void GameSpec::on_gamedata_loaded(const gamedata::empiresdat &gamedata) {
 		// processed in this loop
 		// these are the single sound files.
 		for (const gamedata::sound_item &item : sound.sound_items.data) {
+			const util::Path &snd_path = sound_paths[sound_index];
+			bool exists = sound_exists[sound_index];
+			sound_index += 1;
 
 			if (item.resource_id < 0) {
 				log::log(SPAM << "   Invalid sound resource id < 0");
 				continue;
 			}
 
-			std::string snd_filename = util::sformat("%d.opus", item.resource_id);
-			util::Path snd_path = sound_dir[snd_filename];
-
-			if (not snd_path.is_file()) {
+			if (not exists) {
 				continue;
 			}
 
@@ -540,8 +559,12 @@ void GameSpecHandle::start_load_job() {
 
 	job::JobManager *job_mgr = this->asset_manager->get_engine()->get_job_manager();
 
+	// loading takes many frames, which should not wait for it
+	job::job_options options;
+	options.priority = job::job_priority::background;
+
 	std::get<job::Job<bool>>(*spec_and_job_ptr) = job_mgr->enqueue<bool>(
-		perform_load, load_finished
+		perform_load, load_finished, options
 	);
 }
 
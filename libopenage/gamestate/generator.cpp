@@ -2,6 +2,8 @@
 
 #include "generator.h"
 
+#include <algorithm>
+
 #include "../log/log.h"
 #include "../rng/rng.h"
 #include "../terrain/terrain_chunk.h"
@@ -234,17 +236,42 @@ void Generator::create_regions() {
 }
 
 
-std::shared_ptr<Terrain> Generator::terrain() const {
-	auto terrain = std::make_shared<Terrain>(this->spec->get_terrain_meta(), true);
-	for (auto &r : this->regions) {
+std::shared_ptr<Terrain> region_terrain(terrain_meta *meta, const std::vector<Region> &regions) {
+	// the generated chunks are kept in a grid,
+	// the editor and loaded games may still add chunks around it
+	coord::tile min{0, 0};
+	coord::tile max{0, 0};
+	bool first = true;
+	for (auto &r : regions) {
+		for (auto &tile : r.get_tiles()) {
+			if (first) {
+				min = max = tile;
+				first = false;
+			}
+			min.ne = std::min(min.ne, tile.ne);
+			min.se = std::min(min.se, tile.se);
+			max.ne = std::max(max.ne, tile.ne);
+			max.se = std::max(max.se, tile.se);
+		}
+	}
+
+	auto terrain = std::make_shared<Terrain>(meta, true);
+	if (not first) {
+		terrain->reserve_chunks(min, max);
+	}
+	for (auto &r : regions) {
 		for (auto &tile : r.get_tiles()) {
 			TerrainChunk *chunk = terrain->get_create_chunk(tile);
-			chunk->get_data(tile)->terrain_id = r.terrain_id;
+			chunk->get_data(tile).set_terrain_id(r.terrain_id);
 		}
 	}
 	return terrain;
 }
 
+std::shared_ptr<Terrain> Generator::terrain() const {
+	return region_terrain(this->spec->get_terrain_meta(), this->regions);
+}
+
 void Generator::add_units(GameMain &m) const {
 	for (auto &r : this->regions) {
 
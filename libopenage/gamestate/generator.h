@@ -1,8 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "../coord/tile.h"
 #include "../gui/guisys/public/gui_property_map.h"
@@ -16,6 +18,7 @@ namespace openage {
 class GameSpec;
 class Terrain;
 class GameMain;
+struct terrain_meta;
 
 namespace rng {
 class RNG;
@@ -121,6 +124,13 @@ private:
 };
 
 
+/**
+ * create a terrain covered by the given regions.
+ * their chunks are kept in a grid, but the terrain can grow beyond it.
+ */
+std::shared_ptr<Terrain> region_terrain(terrain_meta *meta, const std::vector<Region> &regions);
+
+
 /**
  * Manages creation and setup of new games
  *
@@ -0,0 +1,287 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "headless_game.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#include "../job/job_manager.h"
+#include "../rng/rng.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../unit/ability.h"
+#include "../unit/command.h"
+#include "../unit/unit.h"
+#include "../unit/unit_type.h"
+#include "../util/os.h"
+#include "player.h"
+
+
+namespace openage {
+
+/**
+ * Side length of the map along the way between the players, in tiles.
+ */
+constexpr coord::tile_t map_length = 64;
+
+/**
+ * Villagers and soldiers stand in blocks this many tiles deep.
+ */
+constexpr coord::tile_t block_depth = 4;
+
+/**
+ * A town center for every this many tiles along the forest.
+ */
+constexpr coord::tile_t town_center_spacing = 16;
+
+
+namespace {
+
+/**
+ * Places units like the converted game data would, but without the
+ * outline textures of their locations, which need a graphics context.
+ */
+class HeadlessType : public NyanType {
+public:
+	using NyanType::NyanType;
+
+	TerrainObject *place(Unit *unit, std::shared_ptr<Terrain> terrain, coord::phys3 init_pos) const override {
+		// units that move are round, the others cover their tile
+		if (this->default_attributes.has(attr_type::speed)) {
+			unit->make_location<RadialObject>(0.25f, nullptr);
+		}
+		else {
+			unit->make_location<SquareObject>(coord::tile_delta{1, 1}, nullptr);
+		}
+
+		TerrainObject *location = unit->location.get();
+		location->allowed_terrain = ~terrain_mask_t{0};
+
+		// the terrain outlives the units of the game
+		location->passable = collision_passable(location, terrain.get());
+
+		if (location->place(terrain, init_pos, object_state::placed)) {
+			return location;
+		}
+		return nullptr;
+	}
+};
+
+} // anonymous namespace
+
+
+double headless_report::ticks_per_second() const {
+	if (this->duration == 0) {
+		return 0;
+	}
+	return this->ticks * 1e9 / this->duration;
+}
+
+std::ostream &operator <<(std::ostream &os, const headless_report &report) {
+	auto ms = [](time_nsec_t time) {
+		return time / 1e6;
+	};
+
+	os << std::fixed << std::setprecision(1)
+	   << report.ticks << " ticks in " << ms(report.duration) << " ms"
+	   << " (" << report.ticks_per_second() << " ticks/s)" << std::endl
+	   << "  wake: " << ms(report.steps.wake) << " ms"
+	   << ", think: " << ms(report.steps.think) << " ms"
+	   << ", update: " << ms(report.steps.update) << " ms"
+	   << ", removal: " << ms(report.steps.removal) << " ms"
+	   << ", path search: " << ms(report.steps.path_search) << " ms" << std::endl
+	   << "  " << report.units << " units, " << report.awake << " awake"
+	   << ", " << report.gathered << " wood gathered" << std::endl
+	   << "  peak memory: " << report.peak_memory / (1024 * 1024) << " MiB";
+	return os;
+}
+
+
+HeadlessGame::HeadlessGame(const headless_settings &settings)
+	:
+	settings(settings),
+	clock{settings.tick_rate} {
+
+	// the players are far enough apart to place all units
+	coord::tile_t width = std::max(settings.villagers, settings.soldiers) / block_depth + 1;
+	width = std::max(width, 2 * town_center_spacing);
+
+	this->terrain = std::make_shared<Terrain>(nullptr, coord::tile{0, 0}, coord::tile{map_length - 1, width - 1});
+	std::vector<int> data(map_length * width, 0);
+	this->terrain->fill(data.data(), coord::tile_delta{map_length, width});
+
+	// without workers, the units search their paths synchronously
+	this->units.set_terrain(this->terrain);
+	if (settings.workers) {
+		this->units.set_job_manager(settings.workers);
+	}
+
+	this->players.push_back(std::make_unique<Player>(nullptr, 0, "gaia"));
+	this->players.push_back(std::make_unique<Player>(nullptr, 1, "west"));
+	this->players.push_back(std::make_unique<Player>(nullptr, 2, "east"));
+
+	this->place_units();
+}
+
+HeadlessGame::~HeadlessGame() {
+	// the units refer to the types and players
+	this->units.reset();
+}
+
+headless_report HeadlessGame::run(unsigned int ticks) {
+	update_timing before = this->units.get_timing();
+	double wood_before = 0;
+	for (auto &player : this->players) {
+		wood_before += player->amount(game_resource::wood);
+	}
+
+	time_nsec_t start = timing::get_monotonic_time();
+	for (unsigned int i = 0; i < ticks; i++) {
+		// deliver the paths found by the workers
+		if (this->settings.workers) {
+			this->settings.workers->execute_callbacks();
+		}
+		this->units.update_all(this->clock.tick_duration());
+	}
+
+	headless_report report;
+	report.ticks = ticks;
+	report.duration = timing::get_monotonic_time() - start;
+
+	const update_timing &after = this->units.get_timing();
+	report.steps.wake = after.wake - before.wake;
+	report.steps.think = after.think - before.think;
+	report.steps.update = after.update - before.update;
+	report.steps.removal = after.removal - before.removal;
+	report.steps.path_search = after.path_search - before.path_search;
+
+	report.units = this->units.size();
+	report.awake = this->units.awake_count();
+
+	report.gathered = -wood_before;
+	for (auto &player : this->players) {
+		report.gathered += player->amount(game_resource::wood);
+	}
+
+	report.peak_memory = os::peak_memory_usage();
+	return report;
+}
+
+const UnitContainer &HeadlessGame::get_units() const {
+	return this->units;
+}
+
+UnitContainer &HeadlessGame::get_units() {
+	return this->units;
+}
+
+NyanType &HeadlessGame::new_type(const Player &owner) {
+	this->types.push_back(std::make_unique<HeadlessType>(owner));
+	return *this->types.back();
+}
+
+void HeadlessGame::place_units() {
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+
+	rng::RNG rng{this->settings.seed};
+	Player &gaia = *this->players[0];
+
+	NyanType &tree = this->new_type(gaia);
+	tree.unit_class = gamedata::unit_classes::TREES;
+	tree.default_attributes.add(std::make_shared<Attribute<attr_type::resource>>(game_resource::wood, 100));
+
+	coord::tile_t width = this->terrain->limit_positive.se + 1;
+	std::vector<UnitReference> soldiers[2];
+
+	for (int side = 0; side < 2; side++) {
+		Player &player = *this->players[side + 1];
+
+		// the east player's half is mirrored
+		auto position = [side](coord::tile_t ne, coord::tile_t se) {
+			if (side == 1) {
+				ne = map_length - 1 - ne;
+			}
+			return coord::tile{ne, se}.to_tile3().to_phys3();
+		};
+
+		NyanType &town_center = this->new_type(player);
+		town_center.unit_class = gamedata::unit_classes::BUILDING;
+		town_center.default_attributes.add(std::make_shared<Attribute<attr_type::owner>>(player));
+		town_center.default_attributes.add(std::make_shared<Attribute<attr_type::dropsite>>(
+			std::vector<game_resource>{game_resource::wood}));
+		auto building = std::make_shared<Attribute<attr_type::building>>();
+		building->completed = 1.0f;
+		town_center.default_attributes.add(building);
+
+		NyanType &villager = this->new_type(player);
+		villager.unit_class = gamedata::unit_classes::CIVILIAN;
+		villager.type_abilities.push_back(std::make_shared<MoveAbility>());
+		villager.type_abilities.push_back(std::make_shared<GatherAbility>());
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::owner>>(player));
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::hitpoints>>(25));
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::damaged>>(25));
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::speed>>(tile / 666));
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{1, 0, 0}));
+		villager.default_attributes.add(std::make_shared<Attribute<attr_type::resource>>());
+		auto worker = std::make_shared<Attribute<attr_type::worker>>();
+		worker->capacity = 10.0;
+		worker->gather_rate[game_resource::wood] = 0.002;
+		villager.default_attributes.add(worker);
+
+		NyanType &soldier = this->new_type(player);
+		soldier.unit_class = gamedata::unit_classes::TWO_HANDED_SWORD;
+		soldier.type_abilities.push_back(std::make_shared<MoveAbility>());
+		soldier.type_abilities.push_back(std::make_shared<AttackAbility>());
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::owner>>(player));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::hitpoints>>(60));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::damaged>>(60));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::speed>>(tile / 666));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{1, 0, 0}));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::attack>>(nullptr, 0, 0, 4));
+		soldier.default_attributes.add(std::make_shared<Attribute<attr_type::formation>>(attack_stance::aggresive));
+
+		// a forest at the edge of the map, with town centers next to it
+		std::vector<UnitReference> trees;
+		for (coord::tile_t se = 0; se < width; se++) {
+			for (coord::tile_t ne = 0; ne < block_depth; ne++) {
+				if (rng.probability(0.6)) {
+					trees.push_back(this->units.new_unit(tree, gaia, position(ne, se)));
+				}
+			}
+		}
+		for (coord::tile_t se = town_center_spacing / 2; se < width; se += town_center_spacing) {
+			this->units.new_unit(town_center, player, position(block_depth + 2, se));
+		}
+
+		// the villagers gather from random trees
+		for (unsigned int i = 0; i < this->settings.villagers; i++) {
+			coord::tile_t ne = block_depth + 4 + i / width;
+			Unit *unit = this->units.new_unit(villager, player, position(ne, i % width)).get();
+			if (not trees.empty()) {
+				Unit *target = trees[rng.random_range(0, trees.size())].get();
+				unit->queue_cmd(Command{player, target});
+			}
+		}
+
+		for (unsigned int i = 0; i < this->settings.soldiers; i++) {
+			coord::tile_t ne = map_length / 2 - 8 + i / width;
+			soldiers[side].push_back(this->units.new_unit(soldier, player, position(ne, i % width)));
+		}
+	}
+
+	// the soldiers attack random enemies
+	for (int side = 0; side < 2; side++) {
+		Player &player = *this->players[side + 1];
+		auto &enemies = soldiers[1 - side];
+		if (enemies.empty()) {
+			continue;
+		}
+		for (auto &ref : soldiers[side]) {
+			Unit *target = enemies[rng.random_range(0, enemies.size())].get();
+			ref.get()->queue_cmd(Command{player, target});
+		}
+	}
+}
+
+} // openage
@@ -0,0 +1,154 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "../unit/unit_container.h"
+#include "../util/timing.h"
+#include "simulation_clock.h"
+
+
+namespace openage {
+
+class NyanType;
+class Player;
+class Terrain;
+
+namespace job {
+class JobManager;
+} // namespace job
+
+
+/**
+ * Scenario of a headless game.
+ */
+struct headless_settings {
+	/**
+	 * seed for the placement of the trees and the scripted commands
+	 */
+	uint64_t seed = 0;
+
+	/**
+	 * villagers of each player, they gather wood
+	 */
+	unsigned int villagers = 100;
+
+	/**
+	 * soldiers of each player, they fight the ones of the other player
+	 */
+	unsigned int soldiers = 50;
+
+	/**
+	 * simulation steps per second
+	 */
+	unsigned int tick_rate = default_tick_rate;
+
+	/**
+	 * workers for path searches and thinking, nullptr to use none
+	 */
+	job::JobManager *workers = nullptr;
+};
+
+
+/**
+ * Measurements of a headless game run.
+ */
+struct headless_report {
+	unsigned int ticks;
+
+	/**
+	 * real time all ticks took
+	 */
+	time_nsec_t duration;
+
+	/**
+	 * real time by step of the unit updates
+	 */
+	update_timing steps;
+
+	/**
+	 * units left at the end, and how many of them were awake
+	 */
+	size_t units;
+	size_t awake;
+
+	/**
+	 * wood the players received from their villagers
+	 */
+	double gathered;
+
+	/**
+	 * most memory the process used, in bytes
+	 */
+	size_t peak_memory;
+
+	double ticks_per_second() const;
+};
+
+std::ostream &operator <<(std::ostream &os, const headless_report &report);
+
+
+/**
+ * A game without graphics, sound or input, to measure the simulation.
+ *
+ * Instead of the converted game data, the players get a few unit types
+ * with fixed attributes. The units are placed from a seed and given
+ * the commands a player would give them, then the game is stepped with
+ * the fixed tick duration as fast as possible.
+ */
+class HeadlessGame {
+public:
+	HeadlessGame(const headless_settings &settings);
+	~HeadlessGame();
+
+	/**
+	 * simulate the given number of steps
+	 */
+	headless_report run(unsigned int ticks);
+
+	const UnitContainer &get_units() const;
+
+	/**
+	 * the units, to give them further commands
+	 */
+	UnitContainer &get_units();
+
+private:
+	/**
+	 * a type without attributes, kept as long as the game
+	 */
+	NyanType &new_type(const Player &owner);
+
+	/**
+	 * place the units of both sides and give them their commands
+	 */
+	void place_units();
+
+	headless_settings settings;
+
+	SimulationClock clock;
+
+	std::shared_ptr<Terrain> terrain;
+
+	/**
+	 * gaia, which owns the trees, and the two fighting players
+	 */
+	std::vector<std::unique_ptr<Player>> players;
+
+	/**
+	 * the trees of gaia, the town centers, villagers
+	 * and soldiers of the players
+	 */
+	std::vector<std::unique_ptr<NyanType>> types;
+
+	/**
+	 * destroyed before the types and players the units refer to
+	 */
+	UnitContainer units;
+};
+
+} // openage
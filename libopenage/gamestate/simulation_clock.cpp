@@ -0,0 +1,65 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "simulation_clock.h"
+
+#include "../error/error.h"
+
+
+namespace openage {
+
+SimulationClock::SimulationClock(unsigned int tick_rate, unsigned int max_catch_up)
+	:
+	tick_rate{default_tick_rate},
+	max_catch_up{default_max_catch_up},
+	accumulated{0} {
+
+	this->set_tick_rate(tick_rate);
+	this->set_max_catch_up(max_catch_up);
+}
+
+void SimulationClock::set_tick_rate(unsigned int tick_rate) {
+	if (tick_rate == 0 or tick_rate > max_tick_rate) {
+		throw Error{MSG(err) << "invalid simulation tick rate: " << tick_rate};
+	}
+	this->tick_rate = tick_rate;
+}
+
+unsigned int SimulationClock::get_tick_rate() const {
+	return this->tick_rate;
+}
+
+void SimulationClock::set_max_catch_up(unsigned int max_catch_up) {
+	if (max_catch_up == 0) {
+		throw Error{MSG(err) << "at least one simulation step is needed per frame"};
+	}
+	this->max_catch_up = max_catch_up;
+}
+
+unsigned int SimulationClock::get_max_catch_up() const {
+	return this->max_catch_up;
+}
+
+time_nsec_t SimulationClock::tick_duration() const {
+	return 1000 * 1000 * 1000 / this->tick_rate;
+}
+
+unsigned int SimulationClock::advance(time_nsec_t real_duration) {
+	time_nsec_t step = this->tick_duration();
+	this->accumulated += real_duration;
+
+	time_nsec_t ticks = this->accumulated / step;
+	if (ticks > this->max_catch_up) {
+		// drop the time that can't be caught up with
+		ticks = this->max_catch_up;
+		this->accumulated = ticks * step;
+	}
+
+	this->accumulated -= ticks * step;
+	return ticks;
+}
+
+float SimulationClock::interpolation() const {
+	return static_cast<float>(this->accumulated) / this->tick_duration();
+}
+
+} // openage
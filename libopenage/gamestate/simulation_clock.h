@@ -0,0 +1,77 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include "../util/timing.h"
+
+
+namespace openage {
+
+/**
+ * Simulation steps per second, unless configured otherwise.
+ */
+constexpr unsigned int default_tick_rate = 50;
+
+/**
+ * Most simulation steps per second, so that a step takes at least a nanosecond.
+ */
+constexpr unsigned int max_tick_rate = 1000 * 1000 * 1000;
+
+/**
+ * Most steps simulated for one frame, unless configured otherwise.
+ */
+constexpr unsigned int default_max_catch_up = 5;
+
+
+/**
+ * Splits the real time that passes into steps of a fixed length,
+ * so that the simulation does not depend on the frame rate.
+ *
+ * If frames take longer than max_catch_up steps, the remaining time
+ * is dropped: the game slows down instead of falling further behind.
+ */
+class SimulationClock {
+public:
+	SimulationClock(unsigned int tick_rate=default_tick_rate,
+	                unsigned int max_catch_up=default_max_catch_up);
+
+	/**
+	 * set the number of steps per second
+	 */
+	void set_tick_rate(unsigned int tick_rate);
+	unsigned int get_tick_rate() const;
+
+	/**
+	 * set the most steps simulated for one frame
+	 */
+	void set_max_catch_up(unsigned int max_catch_up);
+	unsigned int get_max_catch_up() const;
+
+	/**
+	 * the simulated time of one step
+	 */
+	time_nsec_t tick_duration() const;
+
+	/**
+	 * add the real time of a frame
+	 * @returns the number of steps to simulate for it
+	 */
+	unsigned int advance(time_nsec_t real_duration);
+
+	/**
+	 * how far the real time is into the next step, from 0 to 1.
+	 * drawing can interpolate between the last two steps with it.
+	 */
+	float interpolation() const;
+
+private:
+	unsigned int tick_rate;
+	unsigned int max_catch_up;
+
+	/**
+	 * real time that was not simulated yet
+	 */
+	time_nsec_t accumulated;
+};
+
+} // openage
@@ -0,0 +1,174 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "../job/job_manager.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_chunk.h"
+#include "../testing/testing.h"
+#include "../unit/command.h"
+#include "../unit/unit.h"
+#include "game_save.h"
+#include "generator.h"
+#include "headless_game.h"
+#include "simulation_clock.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+/**
+ * The clock runs fixed steps for the real time, but no more than it can catch up with.
+ */
+void simulation_clock() {
+	constexpr time_nsec_t ms = 1000 * 1000;
+	SimulationClock clock{50, 4};
+	TESTEQUALS(clock.tick_duration(), 20 * ms);
+
+	// frames shorter than a step are summed up
+	TESTEQUALS(clock.advance(15 * ms), 0u);
+	TESTEQUALS(clock.interpolation(), 0.75f);
+	TESTEQUALS(clock.advance(15 * ms), 1u);
+	TESTEQUALS(clock.advance(30 * ms), 2u);
+	TESTEQUALS(clock.interpolation(), 0.0f);
+
+	// the time of long frames is dropped
+	TESTEQUALS(clock.advance(1000 * ms), 4u);
+	TESTEQUALS(clock.interpolation(), 0.0f);
+
+	clock.set_tick_rate(100);
+	TESTEQUALS(clock.advance(35 * ms), 3u);
+	TESTEQUALS(clock.interpolation(), 0.5f);
+
+	TESTTHROWS(clock.set_tick_rate(0));
+	TESTTHROWS(clock.set_max_catch_up(0));
+}
+
+/**
+ * Saved chunks outside of the generated regions are loaded
+ * next to the chunk grid of the generated terrain.
+ */
+void load_terrain() {
+	constexpr terrain_t ground = 3, water = 7;
+	constexpr size_t tile_count = chunk_size * chunk_size;
+
+	Region base{16};
+	base.terrain_id = ground;
+	auto terrain = region_terrain(nullptr, {base});
+	TESTEQUALS(terrain->get_data(coord::tile{-16, 15}).get_terrain_id(), ground);
+
+	// one chunk inside of the regions, two far outside
+	std::vector<coord::chunk> saved{{0, -1}, {5, -3}, {-40, 12}};
+	std::stringstream file;
+	file << saved.size() << std::endl;
+	for (auto &position : saved) {
+		file << position.ne << " " << position.se << std::endl;
+		file << tile_count << std::endl;
+		for (size_t p = 0; p < tile_count; p++) {
+			file << water << std::endl << 0 << std::endl;
+		}
+	}
+	gameio::load_chunks(file, terrain.get());
+
+	for (auto &position : saved) {
+		coord::tile tile = position.to_tile(coord::tile_delta{3, 4});
+		TESTEQUALS(terrain->get_data(tile).get_terrain_id(), water);
+	}
+	TESTEQUALS(terrain->get_data(coord::tile{-16, 15}).get_terrain_id(), ground);
+	TESTEQUALS(terrain->used_chunks().size(), 6u);
+
+	// the loaded chunks know their neighbors in the grid
+	TerrainChunk *outside = terrain->get_chunk(coord::chunk{1, 0});
+	(outside == nullptr) or TESTFAIL;
+	outside = terrain->get_create_chunk(coord::chunk{1, 0});
+	TESTEQUALS(outside->neighbors.neighbor[5], terrain->get_chunk(coord::chunk{0, 0}));
+}
+
+/**
+ * Villagers gather and soldiers fight in a headless game,
+ * which plays the same for the same seed.
+ */
+void headless_game() {
+	headless_settings settings;
+	settings.seed = 42;
+	settings.villagers = 10;
+	settings.soldiers = 10;
+
+	HeadlessGame game{settings};
+	size_t placed = game.get_units().size();
+	headless_report report = game.run(50 * 30);
+
+	TESTEQUALS(report.ticks, 50u * 30);
+	(report.gathered > 0) or TESTFAIL;
+	(report.units < placed) or TESTFAIL;
+
+	HeadlessGame again{settings};
+	headless_report same = again.run(50 * 30);
+	TESTEQUALS(same.units, report.units);
+	TESTEQUALS(same.gathered, report.gathered);
+}
+
+/**
+ * With workers, the paths to points are searched on them
+ * and delivered to the units in the game loop.
+ */
+void headless_game_workers() {
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+
+	job::JobManager manager{2};
+	manager.start();
+
+	headless_settings settings;
+	settings.seed = 42;
+	settings.villagers = 1;
+	settings.soldiers = 0;
+	settings.workers = &manager;
+
+	HeadlessGame game{settings};
+	Unit *walker = nullptr;
+	for (Unit *unit : game.get_units().all_units()) {
+		if (unit->has_attribute(attr_type::worker)) {
+			walker = unit;
+			break;
+		}
+	}
+	(walker != nullptr) or TESTFAIL;
+
+	coord::phys3 target = coord::tile{30, 12}.to_tile3().to_phys3();
+	walker->queue_cmd(Command{walker->get_attribute<attr_type::owner>().player, target});
+
+	bool arrived = false;
+	for (int i = 0; i < 50 * 60 and not arrived; i++) {
+		game.run(1);
+		coord::phys3_delta left = walker->location->pos.draw - target;
+		arrived = (std::abs(left.ne) < tile / 2 and std::abs(left.se) < tile / 2);
+	}
+	manager.stop();
+
+	arrived or TESTFAIL;
+}
+
+void benchmark_headless_game() {
+	headless_settings settings;
+	HeadlessGame game{settings};
+	game.run(250);
+}
+
+/**
+ * Plays a minute of a headless game on four workers and shows where the time goes.
+ */
+void headless_game_demo() {
+	job::JobManager manager{4};
+	manager.start();
+
+	headless_settings settings;
+	settings.workers = &manager;
+
+	HeadlessGame game{settings};
+	std::cout << game.run(50 * 60) << std::endl;
+	manager.stop();
+}
+
+}}} // openage::gamestate::tests
@@ -1,8 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <utility>
 
 #include "job_aborted_exception.h"
 #include "typed_job_state_base.h"
@@ -27,8 +28,8 @@ public:
 	AbortableJobState(abortable_function_t<T> function,
                       callback_function_t<T> callback)
 		:
-		TypedJobStateBase<T>{callback},
-		function{function} {
+		TypedJobStateBase<T>{std::move(callback)},
+		function{std::move(function)} {
 	}
 
 	/** Default destructor. */
@@ -0,0 +1,98 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "job_state_base.h"
+
+namespace openage {
+namespace job {
+
+/**
+ * The finished jobs of one thread, which runs their callbacks.
+ *
+ * The workers push the jobs without locking, they are linked through
+ * their states, so no memory is allocated. Only the thread that owns the
+ * queue takes the jobs.
+ */
+class CompletionQueue {
+public:
+	CompletionQueue()
+		:
+		newest{nullptr} {}
+
+	CompletionQueue(const CompletionQueue &) = delete;
+	CompletionQueue &operator =(const CompletionQueue &) = delete;
+
+	/** Releases the jobs whose callbacks did not run. */
+	~CompletionQueue() {
+		this->take_all([](std::shared_ptr<JobStateBase> &) {});
+	}
+
+	/** Adds a finished job, can be called from any thread. */
+	void push(std::shared_ptr<JobStateBase> job) {
+		JobStateBase *state = job.get();
+		state->keep_alive = std::move(job);
+
+		JobStateBase *next = this->newest.load(std::memory_order_relaxed);
+		do {
+			state->next_finished = next;
+		} while (not this->newest.compare_exchange_weak(next, state,
+		                                                std::memory_order_release,
+		                                                std::memory_order_relaxed));
+	}
+
+	/**
+	 * Removes all jobs and calls f(job) for each of them, in the order they
+	 * finished.
+	 */
+	template<class F>
+	void take_all(F f) {
+		JobStateBase *state = this->newest.exchange(nullptr, std::memory_order_acquire);
+
+		// the jobs are linked from the newest one
+		JobStateBase *oldest = nullptr;
+		while (state != nullptr) {
+			JobStateBase *next = state->next_finished;
+			state->next_finished = oldest;
+			oldest = state;
+			state = next;
+		}
+
+		while (oldest != nullptr) {
+			std::shared_ptr<JobStateBase> job = std::move(oldest->keep_alive);
+			oldest = oldest->next_finished;
+			job->next_finished = nullptr;
+			try {
+				f(job);
+			}
+			catch (...) {
+				// like the jobs of a dropped list, the later ones are released
+				CompletionQueue::release(oldest);
+				throw;
+			}
+		}
+	}
+
+	/** Whether no finished job was pushed, which may have changed already. */
+	bool empty() const {
+		return this->newest.load(std::memory_order_relaxed) == nullptr;
+	}
+
+private:
+	static void release(JobStateBase *state) {
+		while (state != nullptr) {
+			JobStateBase *next = state->next_finished;
+			state->next_finished = nullptr;
+			state->keep_alive.reset();
+			state = next;
+		}
+	}
+
+	/** The last job that was pushed. */
+	std::atomic<JobStateBase *> newest;
+};
+
+}} // namespace openage::job
@@ -0,0 +1,56 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "event_count.h"
+
+
+namespace openage {
+namespace job {
+
+
+EventCount::EventCount()
+	:
+	epoch{0},
+	waiters{0} {
+}
+
+
+uint64_t EventCount::prepare_wait() {
+	this->waiters.fetch_add(1);
+	return this->epoch.load();
+}
+
+
+void EventCount::cancel_wait() {
+	this->waiters.fetch_sub(1);
+}
+
+
+void EventCount::wait(uint64_t key) {
+	std::unique_lock<std::mutex> lock{this->mutex};
+	while (this->epoch.load() == key) {
+		this->wakeup.wait(lock);
+	}
+	this->waiters.fetch_sub(1);
+}
+
+
+void EventCount::notify_one() {
+	this->epoch.fetch_add(1);
+	if (this->waiters.load() > 0) {
+		// the waiter is either before its check or inside the wait
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->wakeup.notify_one();
+	}
+}
+
+
+void EventCount::notify_all() {
+	this->epoch.fetch_add(1);
+	if (this->waiters.load() > 0) {
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->wakeup.notify_all();
+	}
+}
+
+
+}} // namespace openage::job
@@ -0,0 +1,51 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace openage {
+namespace job {
+
+/**
+ * Lets threads sleep until an event, without locking when nobody sleeps.
+ *
+ * A thread that runs out of work calls prepare_wait, looks for work once
+ * more, and then either calls cancel_wait or waits with the key it got.
+ * An event notified after prepare_wait ends that wait at once, so no
+ * wakeup is lost between looking for work and falling asleep.
+ */
+class EventCount {
+public:
+	EventCount();
+
+	/** Announces a wait, returns the key to wait with. */
+	uint64_t prepare_wait();
+
+	/** Withdraws the announced wait. */
+	void cancel_wait();
+
+	/** Sleeps until an event was notified after the key was taken. */
+	void wait(uint64_t key);
+
+	/** Wakes one waiting thread. */
+	void notify_one();
+
+	/** Wakes all waiting threads. */
+	void notify_all();
+
+private:
+	/** Number of notified events. */
+	std::atomic<uint64_t> epoch;
+
+	/** Number of threads that announced a wait. */
+	std::atomic<int> waiters;
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+};
+
+}} // namespace openage::job
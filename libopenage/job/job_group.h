@@ -1,13 +1,17 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 #include "../error/error.h"
 #include "abortable_job_state.h"
 #include "job.h"
+#include "job_options.h"
 #include "job_state.h"
+#include "state_pool.h"
 #include "types.h"
 #include "worker.h"
 
@@ -41,12 +45,16 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param options the job's priority class, deadline and cancellation
 	 */
-	template<class T>
-	Job<T> enqueue(job_function_t<T> function,
-	               callback_function_t<T> callback={}) {
+	template<class T, class F, class=decltype(std::declval<F &>()())>
+	Job<T> enqueue(F &&function,
+	               callback_function_t<T> callback={},
+	               const job_options &options={}) {
 		ENSURE(this->parent_worker, "job group has no worker thread associated");
-		auto state = std::make_shared<JobState<T>>(function, callback);
+		using state_t = JobState<T, typename std::decay<F>::type>;
+		auto state = make_pooled<state_t>(std::forward<F>(function), std::move(callback));
+		state->options = options;
 		this->parent_worker->enqueue(state);
 		return Job<T>{state};
 	}
@@ -62,12 +70,16 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param options the job's priority class, deadline and cancellation,
+	 *        the function should abort when the job is cancelled
 	 */
 	template<class T>
 	Job<T> enqueue(abortable_function_t<T> function,
-	               callback_function_t<T> callback={}) {
+	               callback_function_t<T> callback={},
+	               const job_options &options={}) {
 		ENSURE(this->parent_worker, "job group has no worker thread associated");
-		auto state = std::make_shared<AbortableJobState<T>>(function, callback);
+		auto state = make_pooled<AbortableJobState<T>>(std::move(function), std::move(callback));
+		state->options = options;
 		this->parent_worker->enqueue(state);
 		return Job<T>{state};
 	}
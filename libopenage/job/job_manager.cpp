@@ -2,6 +2,9 @@
 
 #include "job_manager.h"
 
+#include <atomic>
+#include <cstdint>
+
 #include "../log/log.h"
 #include "../util/thread_id.h"
 #include "worker.h"
@@ -11,14 +14,37 @@ namespace openage {
 namespace job {
 
 
+namespace {
+
+/** Source of the job manager ids. */
+std::atomic<uint64_t> next_manager_id{1};
+
+/** The completion queue of this thread that was used last. */
+thread_local struct {
+	uint64_t manager_id;
+	CompletionQueue *queue;
+} cached_completions{0, nullptr};
+
+} // anonymous namespace
+
+
 JobManager::JobManager(int number_of_workers)
 	:
 	number_of_workers{number_of_workers},
 	group_index{0},
+	pending_count{0},
+	pending_realtime{0},
+	id{next_manager_id++},
 	is_running{false} {
 
+	for (auto &dropped : this->dropped_jobs) {
+		dropped = 0;
+	}
+
 	for (int i = 0; i < number_of_workers; i++) {
-		this->workers.emplace_back(new Worker{this});
+		// the workers start stealing from different ones
+		uint64_t seed = (i + 1) * UINT64_C(0x9e3779b97f4a7c15);
+		this->workers.emplace_back(new Worker{this, seed});
 	}
 }
 
@@ -47,6 +73,7 @@ void JobManager::stop() {
 		for (auto &worker : this->workers) {
 			worker->stop();
 		}
+		this->idle_workers.notify_all();
 		for (auto &worker : this->workers) {
 			worker->join();
 		}
@@ -57,26 +84,61 @@ void JobManager::stop() {
 
 
 void JobManager::execute_callbacks() {
-	// run callbacks for finished jobs on this thread id.
-	size_t id = util::get_current_thread_id();
+	CompletionQueue *finished = this->completion_queue();
+	finished->take_all([](std::shared_ptr<JobStateBase> &job) {
+		// the job may throw an exception here
+		job->execute_callback();
+	});
+}
 
-	std::unique_lock<std::mutex> lock{this->finished_jobs_mutex};
-	auto it = this->finished_jobs.find(id);
 
-	if (it != std::end(this->finished_jobs)) {
-		// move the  the finished job list here so we can disable the lock
-		std::vector<std::shared_ptr<JobStateBase>> jobs;
-		std::swap(jobs, it->second);
+bool JobManager::execute_pending_job() {
+	// workers look where they would look for their next job
+	Worker *worker = Worker::current();
+	if (worker != nullptr and worker->manager == this) {
+		auto job = worker->find_job();
+		if (not job) {
+			return false;
+		}
+		worker->execute_job(job);
+		return true;
+	}
 
-		// clear the worker's old finished job list
-		it->second.clear();
-		lock.unlock();
+	auto job = this->fetch_job();
+	for (size_t i = 0; not job and i < this->workers.size(); i++) {
+		job = this->workers[i]->steal();
+	}
+	if (not job) {
+		return false;
+	}
 
-		for (auto &job : jobs) {
-			// the job may throw an exception here
-			job->execute_callback();
-		}
+	if (this->drop_expired(job)) {
+		return true;
+	}
+
+	auto &state = *job;
+	job->execute([&state]() {
+		return state.expired();
+	});
+	if (job->has_callback()) {
+		this->finish_job(job);
 	}
+	return true;
+}
+
+
+queue_stats JobManager::get_queue_stats(job_priority priority) {
+	queue_stats stats;
+	{
+		std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
+		stats += this->pending_jobs.get_stats(priority);
+	}
+	for (auto &worker : this->workers) {
+		std::lock_guard<std::mutex> lock{worker->pending_jobs_mutex};
+		stats += worker->pending_jobs.get_stats(priority);
+	}
+	stats.dropped = this->dropped_jobs[static_cast<size_t>(priority)].load();
+	return stats;
 }
 
 
@@ -88,43 +150,88 @@ JobGroup JobManager::create_job_group() {
 
 
 void JobManager::enqueue_state(std::shared_ptr<JobStateBase> state) {
-	std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
-	this->pending_jobs.push(state);
-	for (auto &worker : this->workers) {
-		worker->notify();
+	this->track_completion(*state);
+
+	// jobs of jobs are kept by their worker, where they can be stolen,
+	// unless their class has to be ordered with the queued jobs
+	Worker *worker = Worker::current();
+	if (worker != nullptr and worker->manager == this
+	    and state->options.priority == job_priority::frame) {
+		worker->push_local(std::move(state));
+	}
+	else {
+		bool realtime = (state->options.priority == job_priority::realtime);
+		std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
+		this->pending_jobs.push(std::move(state));
+		if (realtime) {
+			this->pending_realtime += 1;
+		}
+		this->pending_count += 1;
 	}
+	this->idle_workers.notify_one();
 }
 
 
-std::shared_ptr<JobStateBase> JobManager::fetch_job() {
-	std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
-	if (this->pending_jobs.empty()) {
+std::shared_ptr<JobStateBase> JobManager::fetch_job(job_priority lowest) {
+	auto &queued = (lowest == job_priority::realtime) ? this->pending_realtime : this->pending_count;
+	if (queued.load() == 0) {
 		return std::shared_ptr<JobStateBase>{};
 	}
 
-	auto job = this->pending_jobs.front();
-	this->pending_jobs.pop();
+	std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
+	auto job = this->pending_jobs.pop(lowest);
+	if (job) {
+		if (job->options.priority == job_priority::realtime) {
+			this->pending_realtime -= 1;
+		}
+		this->pending_count -= 1;
+	}
 	return job;
 }
 
 
-bool JobManager::has_job() {
-	std::lock_guard<std::mutex> lock(this->pending_jobs_mutex);
-	return not this->pending_jobs.empty();
+bool JobManager::drop_expired(std::shared_ptr<JobStateBase> &job) {
+	if (not job->expired()) {
+		return false;
+	}
+	this->dropped_jobs[static_cast<size_t>(job->options.priority)] += 1;
+
+	job->abort();
+	if (job->has_callback()) {
+		this->finish_job(std::move(job));
+	}
+	return true;
 }
 
 
-void JobManager::finish_job(std::shared_ptr<JobStateBase> job) {
-	std::lock_guard<std::mutex> lock{this->finished_jobs_mutex};
-	auto it = this->finished_jobs.find(job->get_thread_id());
-	// if there hasn't been a finished job for the thread_id, create a new
-	// entry
-	if (it == std::end(this->finished_jobs)) {
-		this->finished_jobs.insert({job->get_thread_id(), {job}});
-	// otherwise, we append the job to the existing entry
-	} else {
-		it->second.push_back(job);
+CompletionQueue *JobManager::completion_queue() {
+	if (cached_completions.manager_id == this->id) {
+		return cached_completions.queue;
 	}
+
+	size_t thread = util::get_current_thread_id();
+	std::lock_guard<std::mutex> lock{this->completions_mutex};
+	auto &queue = this->completions[thread];
+	if (not queue) {
+		queue.reset(new CompletionQueue);
+	}
+
+	cached_completions.manager_id = this->id;
+	cached_completions.queue = queue.get();
+	return queue.get();
+}
+
+
+void JobManager::track_completion(JobStateBase &job) {
+	if (job.has_callback()) {
+		job.completions = this->completion_queue();
+	}
+}
+
+
+void JobManager::finish_job(std::shared_ptr<JobStateBase> job) {
+	CompletionQueue *finished = job->completions;
+	finished->push(std::move(job));
 }
 
 
@@ -1,20 +1,29 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 #include "abortable_job_state.h"
+#include "completion_queue.h"
+#include "event_count.h"
 #include "job.h"
 #include "job_group.h"
+#include "job_options.h"
+#include "job_queue.h"
 #include "job_state.h"
 #include "job_state_base.h"
+#include "state_pool.h"
 #include "types.h"
 
 namespace openage {
@@ -25,6 +34,11 @@ class Worker;
 /**
  * A job manager can be used to execute functions within separate worker
  * threads.
+ *
+ * Jobs enqueued from other threads wait in a queue of the job manager,
+ * ordered by their priority class. Jobs of the frame class that are
+ * enqueued by jobs stay with the worker that runs them, until an idle
+ * worker steals them. Workers without jobs sleep until a job is enqueued.
  */
 class JobManager {
 private:
@@ -43,17 +57,33 @@ private:
 	/** A mutex to synchronize accesses to the internal job queue. */
 	std::mutex pending_jobs_mutex;
 
-	/** A queue of jobs that are to be executed. */
-	std::queue<std::shared_ptr<JobStateBase>> pending_jobs;
+	/** A queue of jobs from threads that are not workers. */
+	JobQueue pending_jobs;
 
-	/** A mutex to synchronize the finished job map. */
-	std::mutex finished_jobs_mutex;
+	/** Number of jobs in the queue, to check it without locking. */
+	std::atomic<size_t> pending_count;
+
+	/** Number of realtime jobs in the queue, which workers look for first. */
+	std::atomic<size_t> pending_realtime;
+
+	/** Wakes the workers that ran out of jobs. */
+	EventCount idle_workers;
+
+	/** Jobs of each priority class that expired before they ran. */
+	std::array<std::atomic<size_t>, job_priority_count> dropped_jobs;
+
+	/** Distinguishes the job managers in the threads' cached queues. */
+	const uint64_t id;
+
+	/** A mutex to synchronize adding completion queues. */
+	std::mutex completions_mutex;
 
 	/**
-	 * Mapping from thread id's to a list of jobs, that have been created by the
-	 * corresponding thread and have finished.
+	 * Mapping from thread id's to the finished jobs that have been created
+	 * by the corresponding thread. The queues are kept until the job
+	 * manager is destroyed, so the jobs can point to them.
 	 */
-	std::unordered_map<size_t, std::vector<std::shared_ptr<JobStateBase>>> finished_jobs;
+	std::unordered_map<size_t, std::unique_ptr<CompletionQueue>> completions;
 
 	/** Whether the job manager is currently running. */
 	std::atomic_bool is_running;
@@ -74,6 +104,11 @@ public:
 	/** Start the job manager's worker threads. */
 	void start();
 
+	/** Returns the number of worker threads. */
+	int get_number_of_workers() const {
+		return this->number_of_workers;
+	}
+
 	/**
 	 * Stop the job manager's worker threads. This method blocks until all
 	 * currently working threads have finished.
@@ -88,11 +123,15 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param options the job's priority class, deadline and cancellation
 	 */
-	template<class T>
-	Job<T> enqueue(job_function_t<T> function,
-	               callback_function_t<T> callback={}) {
-		auto state = std::make_shared<JobState<T>>(function, callback);
+	template<class T, class F, class=decltype(std::declval<F &>()())>
+	Job<T> enqueue(F &&function,
+	               callback_function_t<T> callback={},
+	               const job_options &options={}) {
+		using state_t = JobState<T, typename std::decay<F>::type>;
+		auto state = make_pooled<state_t>(std::forward<F>(function), std::move(callback));
+		state->options = options;
 		this->enqueue_state(state);
 		return Job<T>{state};
 	}
@@ -108,11 +147,15 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param options the job's priority class, deadline and cancellation,
+	 *        the function should abort when the job is cancelled
 	 */
 	template<class T>
 	Job<T> enqueue(abortable_function_t<T> function,
-	               callback_function_t<T> callback={}) {
-		auto state = std::make_shared<AbortableJobState<T>>(function, callback);
+	               callback_function_t<T> callback={},
+	               const job_options &options={}) {
+		auto state = make_pooled<AbortableJobState<T>>(std::move(function), std::move(callback));
+		state->options = options;
 		this->enqueue_state(state);
 		return Job<T>{state};
 	}
@@ -129,25 +172,67 @@ public:
 	 */
 	void execute_callbacks();
 
+	/**
+	 * Executes pending jobs on the calling thread until the given condition
+	 * is true, instead of blocking while waiting for other jobs. Can be called
+	 * from jobs and from other threads, also when the workers are stopped.
+	 */
+	template<class F>
+	void help_until(F done) {
+		while (not done()) {
+			if (not this->execute_pending_job()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/**
+	 * Executes one pending job on the calling thread. Returns false if no
+	 * job was found.
+	 */
+	bool execute_pending_job();
+
+	/**
+	 * Returns how long the queued jobs of a priority class waited, in the
+	 * job manager's queue and the queues of the job groups.
+	 */
+	queue_stats get_queue_stats(job_priority priority);
+
 private:
 	/** Enqueues the given job into the internal job queue. */
 	void enqueue_state(std::shared_ptr<JobStateBase> state);
 
 	/**
-	 * Returns a job from the internal job queue. If the queue is empty, a
-	 * nullptr is returned.
+	 * Returns a job from the internal job queue that is at least as urgent
+	 * as the given class. If there is none, a nullptr is returned.
 	 */
-	std::shared_ptr<JobStateBase> fetch_job();
+	std::shared_ptr<JobStateBase> fetch_job(job_priority lowest=job_priority::background);
 
-	/** Returns whether there are jobs to be executed. */
-	bool has_job();
+	/**
+	 * Whether a job that is about to run was cancelled or missed its
+	 * deadline, then it is counted and finished as aborted instead.
+	 */
+	bool drop_expired(std::shared_ptr<JobStateBase> &job);
+
+	/**
+	 * Returns the queue of finished jobs of the current thread, which is
+	 * created on first use.
+	 */
+	CompletionQueue *completion_queue();
+
+	/**
+	 * Remembers where a job with a callback is reported to, must be called
+	 * by the thread that created it.
+	 */
+	void track_completion(JobStateBase &job);
 
-	/** Adds a finished job to the internal finished job map. */
+	/** Reports a finished job to the thread that created it. */
 	void finish_job(std::shared_ptr<JobStateBase> job);
 
 	/**
 	 * A worker has to be a friend of the job manager in order to call the
-	 * private finish_job method.
+	 * private fetch_job, drop_expired and finish_job methods, to steal from
+	 * the other workers and to wait for jobs.
 	 */
 	friend class Worker;
 };
@@ -0,0 +1,116 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+namespace openage {
+namespace job {
+
+/** The clock of job deadlines and queue latencies. */
+using job_clock = std::chrono::steady_clock;
+
+/**
+ * Classes of jobs, the queued jobs of a more urgent class run first.
+ */
+enum class job_priority {
+	/** jobs that a realtime thread waits for, like audio chunks */
+	realtime,
+	/** jobs that the current frame needs */
+	frame,
+	/** loading that may take several frames */
+	background,
+};
+
+/** Number of priority classes. */
+constexpr size_t job_priority_count = 3;
+
+
+/**
+ * Lets a thread cancel jobs that it passed the token to. Copies of a
+ * token share the cancellation, the default token can't be cancelled.
+ */
+class CancellationToken {
+public:
+	/** Creates a token that can't be cancelled. */
+	CancellationToken() = default;
+
+	/** Creates a token that can be cancelled. */
+	static CancellationToken create() {
+		CancellationToken token;
+		token.flag = std::make_shared<std::atomic<bool>>(false);
+		return token;
+	}
+
+	/**
+	 * Cancels the jobs with this token. Jobs that did not start are
+	 * dropped, abortable jobs that run see that they should abort.
+	 */
+	void cancel() {
+		if (this->flag) {
+			this->flag->store(true);
+		}
+	}
+
+	bool is_cancelled() const {
+		return this->flag and this->flag->load(std::memory_order_relaxed);
+	}
+
+private:
+	std::shared_ptr<std::atomic<bool>> flag;
+};
+
+
+/**
+ * How a job is scheduled.
+ */
+struct job_options {
+	job_priority priority = job_priority::frame;
+
+	/**
+	 * The job is dropped if it did not start by then, abortable jobs should
+	 * abort after it. No deadline when it is the maximum.
+	 */
+	job_clock::time_point deadline = job_clock::time_point::max();
+
+	CancellationToken token;
+};
+
+
+/**
+ * The latencies of the queued jobs of one priority class, from their
+ * enqueueing until they were taken from their queue.
+ */
+struct queue_stats {
+	/** Jobs taken from the queues. */
+	size_t taken = 0;
+
+	/** Taken jobs whose latency was measured. */
+	size_t timed = 0;
+
+	/**
+	 * Taken jobs that were cancelled or missed their deadline before they
+	 * could run.
+	 */
+	size_t dropped = 0;
+
+	/** Sum of the measured latencies. */
+	job_clock::duration total_wait{0};
+
+	/** Longest of the measured latencies. */
+	job_clock::duration longest_wait{0};
+
+	job_clock::duration mean_wait() const {
+		if (this->timed == 0) {
+			return job_clock::duration{0};
+		}
+		return this->total_wait / static_cast<job_clock::rep>(this->timed);
+	}
+
+	queue_stats &operator +=(const queue_stats &other);
+};
+
+}} // namespace openage::job
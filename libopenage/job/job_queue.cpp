@@ -0,0 +1,113 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "job_queue.h"
+
+#include <algorithm>
+
+
+namespace openage {
+namespace job {
+
+
+queue_stats &queue_stats::operator +=(const queue_stats &other) {
+	this->taken += other.taken;
+	this->timed += other.timed;
+	this->dropped += other.dropped;
+	this->total_wait += other.total_wait;
+	this->longest_wait = std::max(this->longest_wait, other.longest_wait);
+	return *this;
+}
+
+
+const std::array<size_t, job_priority_count> JobQueue::starvation_limits{{
+	0,
+	32,
+	128,
+}};
+
+
+JobQueue::JobQueue()
+	:
+	count{0} {}
+
+
+void JobQueue::push(std::shared_ptr<JobStateBase> job) {
+	job_class &queued = this->classes[static_cast<size_t>(job->options.priority)];
+
+	job_clock::time_point enqueued{};
+	if (queued.pushed % JobQueue::timing_interval == 0) {
+		enqueued = job_clock::now();
+	}
+	queued.pushed += 1;
+
+	queued.jobs.push(entry{std::move(job), enqueued});
+	this->count += 1;
+}
+
+
+std::shared_ptr<JobStateBase> JobQueue::pop(job_priority lowest) {
+	if (this->count == 0) {
+		return std::shared_ptr<JobStateBase>{};
+	}
+
+	// the most urgent class that has jobs, or the most urgent starving one
+	size_t last = static_cast<size_t>(lowest);
+	size_t chosen = job_priority_count;
+	for (size_t i = 0; i <= last; i++) {
+		if (this->classes[i].jobs.empty()) {
+			continue;
+		}
+		if (chosen == job_priority_count) {
+			chosen = i;
+		}
+		else if (this->classes[i].passed >= JobQueue::starvation_limits[i]) {
+			chosen = i;
+			break;
+		}
+	}
+
+	if (chosen == job_priority_count) {
+		return std::shared_ptr<JobStateBase>{};
+	}
+
+	// the waiting less urgent classes were passed over once more
+	for (size_t i = chosen + 1; i < job_priority_count; i++) {
+		if (not this->classes[i].jobs.empty()) {
+			this->classes[i].passed += 1;
+		}
+	}
+
+	job_class &served = this->classes[chosen];
+	entry next = std::move(served.jobs.front());
+	served.jobs.pop();
+	served.passed = 0;
+	this->count -= 1;
+
+	queue_stats &stats = served.stats;
+	stats.taken += 1;
+	if (next.enqueued != job_clock::time_point{}) {
+		job_clock::duration wait = job_clock::now() - next.enqueued;
+		stats.timed += 1;
+		stats.total_wait += wait;
+		stats.longest_wait = std::max(stats.longest_wait, wait);
+	}
+	return std::move(next.job);
+}
+
+
+bool JobQueue::empty() const {
+	return this->count == 0;
+}
+
+
+size_t JobQueue::size() const {
+	return this->count;
+}
+
+
+const queue_stats &JobQueue::get_stats(job_priority priority) const {
+	return this->classes[static_cast<size_t>(priority)].stats;
+}
+
+
+}} // namespace openage::job
@@ -0,0 +1,83 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <queue>
+
+#include "job_options.h"
+#include "job_state_base.h"
+
+namespace openage {
+namespace job {
+
+/**
+ * Queued jobs, in one queue for each priority class.
+ *
+ * The oldest job of the most urgent class is taken first. A class whose
+ * jobs were passed over by too many more urgent ones is starving, then its
+ * oldest job is taken next. So each class keeps a share of the workers,
+ * however many urgent jobs are enqueued.
+ *
+ * Reading the clock costs as much as running a small job, so only every
+ * timing_interval-th job of a class is timed for the latency stats.
+ *
+ * The queue is not synchronized, its owner locks it.
+ */
+class JobQueue {
+public:
+	JobQueue();
+
+	void push(std::shared_ptr<JobStateBase> job);
+
+	/**
+	 * Takes the next job that is at least as urgent as the given class,
+	 * nullptr if there is none.
+	 */
+	std::shared_ptr<JobStateBase> pop(job_priority lowest=job_priority::background);
+
+	/** Whether no job is queued. */
+	bool empty() const;
+
+	/** Number of queued jobs. */
+	size_t size() const;
+
+	/** Latencies of the jobs that were taken. */
+	const queue_stats &get_stats(job_priority priority) const;
+
+	/**
+	 * How many more urgent jobs may be taken while a class waits, before
+	 * it is starving.
+	 */
+	static const std::array<size_t, job_priority_count> starvation_limits;
+
+	/** Every this many jobs of a class, one is timed. */
+	static constexpr size_t timing_interval = 16;
+
+private:
+	struct entry {
+		std::shared_ptr<JobStateBase> job;
+
+		/** When it was pushed, the clock's epoch if it is not timed. */
+		job_clock::time_point enqueued;
+	};
+
+	struct job_class {
+		std::queue<entry> jobs;
+
+		/** More urgent jobs that were taken since this class was served. */
+		size_t passed = 0;
+
+		/** Jobs pushed, to pick the timed ones. */
+		size_t pushed = 0;
+
+		queue_stats stats;
+	};
+
+	std::array<job_class, job_priority_count> classes;
+
+	size_t count;
+};
+
+}} // namespace openage::job
@@ -1,8 +1,9 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <utility>
 
 #include "typed_job_state_base.h"
 #include "types.h"
@@ -13,18 +14,22 @@ namespace job {
 /**
  * A job state supports simple job's with functions that return a single
  * result. While executing the job, it cannot be aborted safely.
+ *
+ * The function object is stored in the state itself, so lambdas do not
+ * need an allocation of their own like in a std::function.
  */
-template<class T>
+template<class T, class F=job_function_t<T>>
 class JobState : public TypedJobStateBase<T> {
 public:
 	/** A function object which is executed by the JobManager. */
-	job_function_t<T> function;
+	F function;
 
 	/** Creates a new JobState with the given function, that is to be executed. */
-	JobState(job_function_t<T> function, callback_function_t<T> callback)
+	template<class G>
+	JobState(G &&function, callback_function_t<T> callback)
 		:
-		TypedJobStateBase<T>{callback},
-		function{function} {
+		TypedJobStateBase<T>{std::move(callback)},
+		function(std::forward<G>(function)) {
 	}
 
 	/** Default destructor. */
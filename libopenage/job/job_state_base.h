@@ -1,14 +1,18 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <memory>
 
+#include "job_options.h"
 #include "types.h"
 
 namespace openage {
 namespace job {
 
+class CompletionQueue;
+
 /**
  * An abstract base class for a shared state of a job. A job state keeps track
  * of its execution state and store's the job's result. Further it keeps track
@@ -27,6 +31,12 @@ public:
 	 */
 	virtual bool execute(should_abort_t should_abort) = 0;
 
+	/**
+	 * Finishes the job without executing it, its result is a
+	 * JobAbortedException.
+	 */
+	virtual void abort() = 0;
+
 	/**
 	 * Executes the job's callback, if a callback function has been provided
 	 * while constructing this job. This function may only be called if the job
@@ -34,8 +44,39 @@ public:
 	 */
 	virtual void execute_callback() = 0;
 
+	/**
+	 * Returns whether a callback function has been provided, only then the
+	 * job has to be reported back to the thread that created it.
+	 */
+	virtual bool has_callback() const = 0;
+
 	/** Returns the id of the thread that has created this job. */
 	virtual size_t get_thread_id() = 0;
+
+	/** Whether the job was cancelled or its deadline has passed. */
+	bool expired() const {
+		return this->options.token.is_cancelled()
+		       or (this->options.deadline != job_clock::time_point::max()
+		           and job_clock::now() > this->options.deadline);
+	}
+
+	/** How the job is scheduled. */
+	job_options options;
+
+	/**
+	 * The state itself, while it waits in a worker's deque, which only
+	 * holds plain pointers. Moved out by the worker that takes it.
+	 */
+	std::shared_ptr<JobStateBase> keep_alive;
+
+	/**
+	 * The finished jobs of the thread that created this job, where it is
+	 * reported to if it has a callback.
+	 */
+	CompletionQueue *completions = nullptr;
+
+	/** The job that finished before this one in the completion queue. */
+	JobStateBase *next_finished = nullptr;
 };
 
 }
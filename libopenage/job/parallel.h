@@ -0,0 +1,128 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../error/error.h"
+#include "job_manager.h"
+
+namespace openage {
+namespace job {
+
+/**
+ * Calls body(chunk_begin, chunk_end) for consecutive chunks of at most
+ * grain indices, which together cover [begin, end). The chunks are claimed
+ * one after another by the calling thread and by jobs on the workers of the
+ * job manager. The calling thread runs no other jobs, when no chunk is left
+ * it waits for the ones that are still running.
+ *
+ * If a chunk throws, the first exception is rethrown after all chunks
+ * have finished. Without a job manager, the chunks run in order on the
+ * calling thread.
+ */
+template<class F>
+void parallel_for(JobManager *manager, size_t begin, size_t end, size_t grain, F &&body) {
+	ENSURE(grain > 0, "the chunks of a parallel loop must not be empty");
+	if (begin >= end) {
+		return;
+	}
+
+	size_t chunks = (end - begin + grain - 1) / grain;
+	auto chunk_end = [end, grain](size_t chunk_begin) {
+		return (end - chunk_begin > grain) ? chunk_begin + grain : end;
+	};
+
+	if (manager == nullptr or chunks == 1) {
+		for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain) {
+			body(chunk_begin, chunk_end(chunk_begin));
+		}
+		return;
+	}
+
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	auto run = [&](size_t chunk) {
+		size_t chunk_begin = begin + chunk * grain;
+		try {
+			body(chunk_begin, chunk_end(chunk_begin));
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock{error_mutex};
+			if (not error) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	/**
+	 * Jobs that start after all chunks were claimed still look at the
+	 * next chunk, so it outlives this frame. Everything else is only
+	 * used for a claimed chunk, which this frame waits for.
+	 */
+	struct loop_state {
+		std::atomic<size_t> next{0};
+		std::atomic<size_t> remaining;
+	};
+	auto state = std::make_shared<loop_state>();
+	state->remaining = chunks;
+
+	auto claim_chunks = [chunks](loop_state &loop, decltype(run) &run_chunk) {
+		for (size_t chunk = loop.next++; chunk < chunks; chunk = loop.next++) {
+			run_chunk(chunk);
+			loop.remaining -= 1;
+		}
+	};
+
+	size_t helpers = std::min<size_t>(chunks - 1, manager->get_number_of_workers());
+	for (size_t i = 0; i < helpers; i++) {
+		manager->enqueue<bool>([state, &run, claim_chunks]() {
+			claim_chunks(*state, run);
+			return true;
+		});
+	}
+
+	claim_chunks(*state, run);
+	while (state->remaining.load() != 0) {
+		std::this_thread::yield();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+
+/**
+ * Maps the chunks of [begin, end) to values with map(chunk_begin, chunk_end)
+ * like parallel_for, and combines the values with reduce(left, right),
+ * starting with the identity. The values are combined in the order of the
+ * chunks, so the result does not depend on the workers that mapped them.
+ */
+template<class T, class Map, class Reduce>
+T parallel_reduce(JobManager *manager, size_t begin, size_t end, size_t grain,
+                  T identity, Map &&map, Reduce &&reduce) {
+	ENSURE(grain > 0, "the chunks of a parallel loop must not be empty");
+	if (begin >= end) {
+		return identity;
+	}
+
+	std::vector<T> values((end - begin + grain - 1) / grain, identity);
+	parallel_for(manager, begin, end, grain, [&](size_t chunk_begin, size_t chunk_end) {
+		values[(chunk_begin - begin) / grain] = map(chunk_begin, chunk_end);
+	});
+
+	T result = identity;
+	for (auto &value : values) {
+		result = reduce(result, value);
+	}
+	return result;
+}
+
+}} // namespace openage::job
@@ -0,0 +1,188 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace openage {
+namespace job {
+
+/**
+ * Memory blocks of one size, which are reused instead of being returned to
+ * the global allocator.
+ *
+ * Every thread keeps the blocks it freed in a list of its own, which it
+ * takes new blocks from without locking. Threads that free more blocks
+ * than they allocate hand batches of them to a shared list, where the
+ * threads that ran out of blocks take them from. The blocks are never
+ * freed, a pool only grows to the most blocks in use at the same time.
+ */
+template<size_t block_size>
+class BlockPool {
+	struct block {
+		block *next;
+	};
+
+	static_assert(block_size >= sizeof(block), "pool blocks can't be linked");
+
+	/** Number of blocks that move between a thread and the shared list. */
+	static constexpr size_t batch_size = 64;
+
+	/** A linked list of free blocks. */
+	struct batch {
+		block *first;
+		size_t count;
+	};
+
+	struct shared_blocks {
+		std::mutex mutex;
+		std::vector<batch> batches;
+	};
+
+	/** The free blocks of one thread, which are shared when it exits. */
+	struct local_blocks {
+		batch free{nullptr, 0};
+
+		~local_blocks() {
+			if (this->free.count > 0) {
+				BlockPool::give(this->free);
+			}
+		}
+	};
+
+public:
+	static void *allocate() {
+		local_blocks &local = BlockPool::local();
+		if (local.free.first == nullptr) {
+			if (not BlockPool::take(local.free)) {
+				return ::operator new(block_size);
+			}
+		}
+
+		block *result = local.free.first;
+		local.free.first = result->next;
+		local.free.count -= 1;
+		return result;
+	}
+
+	static void deallocate(void *memory) {
+		local_blocks &local = BlockPool::local();
+		block *freed = static_cast<block *>(memory);
+		freed->next = local.free.first;
+		local.free.first = freed;
+		local.free.count += 1;
+
+		// keep the recently freed batch for the next allocations,
+		// share the older one
+		if (local.free.count >= 2 * batch_size) {
+			block *last = local.free.first;
+			for (size_t i = 1; i < batch_size; i++) {
+				last = last->next;
+			}
+			batch older{last->next, local.free.count - batch_size};
+			last->next = nullptr;
+			local.free.count = batch_size;
+			BlockPool::give(older);
+		}
+	}
+
+private:
+	static local_blocks &local() {
+		thread_local local_blocks blocks;
+		return blocks;
+	}
+
+	/**
+	 * Not destroyed, as threads may still free blocks after the static
+	 * objects were destroyed.
+	 */
+	static shared_blocks &shared() {
+		static shared_blocks *blocks = new shared_blocks;
+		return *blocks;
+	}
+
+	static void give(batch blocks) {
+		shared_blocks &pool = BlockPool::shared();
+		std::lock_guard<std::mutex> lock{pool.mutex};
+		pool.batches.push_back(blocks);
+	}
+
+	static bool take(batch &blocks) {
+		shared_blocks &pool = BlockPool::shared();
+		std::lock_guard<std::mutex> lock{pool.mutex};
+		if (pool.batches.empty()) {
+			return false;
+		}
+		blocks = pool.batches.back();
+		pool.batches.pop_back();
+		return true;
+	}
+};
+
+
+/**
+ * Allocator that takes single objects from the block pool of their size,
+ * arrays are allocated globally.
+ */
+template<class T>
+class PoolAllocator {
+	static_assert(alignof(T) <= alignof(std::max_align_t),
+	              "pool blocks are not aligned for this type");
+
+	/** Sizes are rounded, so types of similar size share their blocks. */
+	static constexpr size_t block_size = (
+		(sizeof(T) + alignof(std::max_align_t) - 1)
+		/ alignof(std::max_align_t) * alignof(std::max_align_t)
+	);
+
+public:
+	using value_type = T;
+
+	PoolAllocator() = default;
+
+	template<class U>
+	PoolAllocator(const PoolAllocator<U> &) {}
+
+	T *allocate(size_t count) {
+		if (count != 1) {
+			return static_cast<T *>(::operator new(count * sizeof(T)));
+		}
+		return static_cast<T *>(BlockPool<block_size>::allocate());
+	}
+
+	void deallocate(T *memory, size_t count) {
+		if (count != 1) {
+			::operator delete(memory);
+		}
+		else {
+			BlockPool<block_size>::deallocate(memory);
+		}
+	}
+
+	template<class U>
+	bool operator ==(const PoolAllocator<U> &) const {
+		return true;
+	}
+
+	template<class U>
+	bool operator !=(const PoolAllocator<U> &) const {
+		return false;
+	}
+};
+
+
+/**
+ * Creates a job state whose reference counts are stored in the same pool
+ * block as the state itself.
+ */
+template<class S, class... Args>
+std::shared_ptr<S> make_pooled(Args &&... args) {
+	return std::allocate_shared<S>(PoolAllocator<S>{}, std::forward<Args>(args)...);
+}
+
+}} // namespace openage::job
@@ -0,0 +1,141 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "task_graph.h"
+
+#include "../error/error.h"
+#include "job_manager.h"
+
+
+namespace openage {
+namespace job {
+
+
+TaskGraph::TaskGraph(JobManager *manager)
+	:
+	manager{manager},
+	remaining{0},
+	failed{false} {
+}
+
+
+TaskGraph::task_id TaskGraph::add(std::function<void()> function, const std::vector<task_id> &predecessors) {
+	task_id id = this->tasks.size();
+	for (task_id predecessor : predecessors) {
+		ENSURE(predecessor < id, "task " << id << " depends on task "
+		       << predecessor << ", which was not added before");
+	}
+
+	this->tasks.emplace_back(new task);
+	task &added = *this->tasks.back();
+	added.function = std::move(function);
+	added.predecessor_count = predecessors.size();
+	added.waiting = 0;
+
+	for (task_id predecessor : predecessors) {
+		this->tasks[predecessor]->successors.push_back(id);
+	}
+	return id;
+}
+
+
+void TaskGraph::run() {
+	this->failed = false;
+	this->error = nullptr;
+
+	// the tasks were added after their predecessors, so this order fits
+	if (this->manager == nullptr) {
+		for (auto &current : this->tasks) {
+			if (this->failed) {
+				break;
+			}
+			try {
+				current->function();
+			}
+			catch (...) {
+				this->fail(std::current_exception());
+			}
+		}
+	}
+	else {
+		this->remaining = this->tasks.size();
+		for (auto &current : this->tasks) {
+			current->waiting = current->predecessor_count;
+		}
+
+		for (task_id id = 0; id < this->tasks.size(); id++) {
+			if (this->tasks[id]->predecessor_count == 0) {
+				this->start(id);
+			}
+		}
+
+		this->manager->help_until([this]() {
+			return this->remaining.load() == 0;
+		});
+	}
+
+	if (this->error) {
+		std::rethrow_exception(this->error);
+	}
+}
+
+
+size_t TaskGraph::size() const {
+	return this->tasks.size();
+}
+
+
+void TaskGraph::execute(task_id id) {
+	while (true) {
+		task &current = *this->tasks[id];
+		if (not this->failed) {
+			try {
+				current.function();
+			}
+			catch (...) {
+				this->fail(std::current_exception());
+			}
+		}
+
+		// continue with the first successor that waited only for this task
+		bool continued = false;
+		task_id next = 0;
+		for (task_id successor : current.successors) {
+			if (this->tasks[successor]->waiting.fetch_sub(1) == 1) {
+				if (not continued) {
+					next = successor;
+					continued = true;
+				}
+				else {
+					this->start(successor);
+				}
+			}
+		}
+
+		// run may return after this, unless the next task is left
+		this->remaining -= 1;
+		if (not continued) {
+			return;
+		}
+		id = next;
+	}
+}
+
+
+void TaskGraph::start(task_id id) {
+	this->manager->enqueue<bool>([this, id]() {
+		this->execute(id);
+		return true;
+	});
+}
+
+
+void TaskGraph::fail(std::exception_ptr exception) {
+	std::lock_guard<std::mutex> lock{this->error_mutex};
+	if (not this->error) {
+		this->error = exception;
+	}
+	this->failed = true;
+}
+
+
+}} // namespace openage::job
@@ -0,0 +1,93 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace openage {
+namespace job {
+
+class JobManager;
+
+/**
+ * Tasks that start when the tasks they depend on have finished.
+ *
+ * A task can only depend on tasks that were added before it, so the graph
+ * has no cycles. When a task finishes, the worker that ran it continues
+ * with one of the tasks that waited only for it, the others are enqueued.
+ * The thread that runs the graph helps with pending jobs until all tasks
+ * have finished. The graph can be run again.
+ */
+class TaskGraph {
+public:
+	using task_id = size_t;
+
+	/**
+	 * Creates an empty graph, whose tasks run on the workers of the job
+	 * manager. Without a job manager, they run on the calling thread.
+	 */
+	TaskGraph(JobManager *manager);
+
+	TaskGraph(const TaskGraph &) = delete;
+	TaskGraph &operator =(const TaskGraph &) = delete;
+
+	/**
+	 * Adds a task that starts after the given tasks have finished.
+	 */
+	task_id add(std::function<void()> function, const std::vector<task_id> &predecessors={});
+
+	/**
+	 * Runs all tasks and returns when they have finished. If a task throws,
+	 * the tasks that did not start yet are skipped, and the exception is
+	 * rethrown.
+	 */
+	void run();
+
+	/** Number of tasks in the graph. */
+	size_t size() const;
+
+private:
+	struct task {
+		std::function<void()> function;
+
+		/** the tasks that depend on this one */
+		std::vector<task_id> successors;
+
+		size_t predecessor_count;
+
+		/** predecessors that have not finished yet in the current run */
+		std::atomic<size_t> waiting;
+	};
+
+	/**
+	 * Runs a task and the ones that become ready by it, which are not
+	 * enqueued.
+	 */
+	void execute(task_id id);
+
+	/** Enqueues a task whose predecessors have finished. */
+	void start(task_id id);
+
+	/** Remembers the first exception of a run, the other tasks are skipped. */
+	void fail(std::exception_ptr exception);
+
+	JobManager *manager;
+
+	std::vector<std::unique_ptr<task>> tasks;
+
+	/** Tasks of the current run that have not finished. */
+	std::atomic<size_t> remaining;
+
+	/** Whether a task of the current run threw. */
+	std::atomic<bool> failed;
+
+	std::mutex error_mutex;
+	std::exception_ptr error;
+};
+
+}} // namespace openage::job
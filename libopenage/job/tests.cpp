@@ -1,11 +1,22 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "../log/log.h"
 #include "../testing/testing.h"
+#include "../util/timing.h"
 
 #include "job_manager.h"
+#include "job_queue.h"
+#include "parallel.h"
+#include "task_graph.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 namespace openage {
 namespace job {
@@ -90,9 +101,425 @@ void test_simple_job_with_exception() {
 }
 
 
+/**
+ * Jobs that enqueue jobs, which the other workers steal, and jobs of a
+ * job group, which all run on the same thread.
+ */
+void test_nested_jobs() {
+	JobManager manager{4};
+	manager.start();
+
+	constexpr int parents = 100;
+	constexpr int children = 100;
+	std::atomic<int> finished{0};
+
+	auto child = [&finished]() -> int {
+		finished++;
+		return 0;
+	};
+
+	for (int i = 0; i < parents; i++) {
+		manager.enqueue<int>([&manager, &child]() -> int {
+			for (int j = 0; j < children; j++) {
+				manager.enqueue<int>(child);
+			}
+			return 0;
+		});
+	}
+
+	JobGroup group = manager.create_job_group();
+	std::mutex threads_mutex;
+	std::set<std::thread::id> threads;
+	std::atomic<int> group_finished{0};
+	for (int i = 0; i < parents; i++) {
+		group.enqueue<int>([&]() -> int {
+			std::lock_guard<std::mutex> lock{threads_mutex};
+			threads.insert(std::this_thread::get_id());
+			group_finished++;
+			return 0;
+		});
+	}
+
+	while (finished.load() < parents * children or group_finished.load() < parents) {
+		std::this_thread::yield();
+	}
+	manager.stop();
+
+	TESTEQUALS(threads.size(), 1u);
+}
+
+
+/**
+ * Callbacks run on the thread that enqueued their job, also when several
+ * threads enqueue jobs, whose functions are too large for a std::function.
+ */
+void test_thread_callbacks() {
+	JobManager manager{4};
+	manager.start();
+
+	constexpr int threads = 3;
+	constexpr int jobs = 500;
+	std::atomic<int> wrong_threads{0};
+	std::atomic<int> wrong_results{0};
+
+	auto enqueue_and_wait = [&](int offset) {
+		std::thread::id creator = std::this_thread::get_id();
+		int finished = 0;
+
+		for (int i = 0; i < jobs; i++) {
+			std::array<int, 16> values;
+			values.fill(offset + i);
+			manager.enqueue<int>([values]() -> int {
+				return values[0] + values[15];
+			}, [&, i](result_function_t<int> get_result) {
+				if (std::this_thread::get_id() != creator) {
+					wrong_threads++;
+				}
+				if (get_result() != 2 * (offset + i)) {
+					wrong_results++;
+				}
+				finished++;
+			});
+		}
+
+		while (finished < jobs) {
+			manager.execute_callbacks();
+		}
+	};
+
+	std::vector<std::thread> creators;
+	for (int i = 0; i < threads; i++) {
+		creators.emplace_back(enqueue_and_wait, i * jobs);
+	}
+	for (auto &creator : creators) {
+		creator.join();
+	}
+	manager.stop();
+
+	TESTEQUALS(wrong_threads.load(), 0);
+	TESTEQUALS(wrong_results.load(), 0);
+}
+
+
+/**
+ * Queued jobs run by their priority class, unless one starves, and
+ * expired jobs are dropped.
+ */
+void test_priorities() {
+	auto queued = [](int id, job_priority priority) {
+		auto state = std::make_shared<JobState<int>>([id]() {
+			return id;
+		}, callback_function_t<int>{});
+		state->options.priority = priority;
+		return state;
+	};
+
+	JobQueue queue;
+	queue.push(queued(0, job_priority::background));
+	queue.push(queued(1, job_priority::frame));
+	queue.push(queued(2, job_priority::realtime));
+	queue.push(queued(3, job_priority::frame));
+	TESTEQUALS(queue.size(), 4u);
+	(queue.pop(job_priority::realtime)->options.priority == job_priority::realtime) or TESTFAIL;
+	queue.pop(job_priority::realtime) and TESTFAIL;
+
+	std::vector<job_priority> popped;
+	while (auto job = queue.pop()) {
+		popped.push_back(job->options.priority);
+	}
+	TESTEQUALS(popped.size(), 3u);
+	(popped[0] == job_priority::frame) or TESTFAIL;
+	(popped[2] == job_priority::background) or TESTFAIL;
+	TESTEQUALS(queue.get_stats(job_priority::frame).taken, 2u);
+
+	// a class that was passed over too often is taken before more urgent ones
+	size_t limit = JobQueue::starvation_limits[static_cast<size_t>(job_priority::background)];
+	queue.push(queued(4, job_priority::background));
+	for (size_t i = 0; i < limit + 1; i++) {
+		queue.push(queued(5, job_priority::frame));
+	}
+	for (size_t i = 0; i < limit; i++) {
+		(queue.pop()->options.priority == job_priority::frame) or TESTFAIL;
+	}
+	(queue.pop()->options.priority == job_priority::background) or TESTFAIL;
+	(queue.pop()->options.priority == job_priority::frame) or TESTFAIL;
+	queue.empty() or TESTFAIL;
+	(queue.get_stats(job_priority::background).timed > 0) or TESTFAIL;
+
+	// without workers, the calling thread runs or drops the jobs
+	JobManager manager{1};
+	auto token = CancellationToken::create();
+	job_options cancelled;
+	cancelled.token = token;
+	job_options late;
+	late.priority = job_priority::background;
+	late.deadline = job_clock::now() - std::chrono::seconds{1};
+
+	// dropped jobs finish and report that they were aborted
+	int aborted_callbacks = 0;
+	auto count_aborted = [&aborted_callbacks](result_function_t<int> get_result) {
+		try {
+			get_result();
+		}
+		catch (JobAbortedException &) {
+			aborted_callbacks += 1;
+		}
+	};
+
+	auto dropped = manager.enqueue<int>([]() { return 0; }, count_aborted, cancelled);
+	manager.enqueue<int>([]() { return 0; }, {}, late);
+	auto done = manager.enqueue<int>([]() { return 0; });
+	token.cancel();
+	while (manager.execute_pending_job()) {}
+
+	done.is_finished() or TESTFAIL;
+	dropped.is_finished() or TESTFAIL;
+	count_aborted([&dropped]() { return dropped.get_result(); });
+	TESTEQUALS(manager.get_queue_stats(job_priority::frame).taken, 2u);
+	TESTEQUALS(manager.get_queue_stats(job_priority::frame).dropped, 1u);
+	TESTEQUALS(manager.get_queue_stats(job_priority::background).dropped, 1u);
+	TESTEQUALS(aborted_callbacks, 1);
+	manager.execute_callbacks();
+	TESTEQUALS(aborted_callbacks, 2);
+
+	// a running abortable job sees its cancellation
+	manager.start();
+	auto abortable = CancellationToken::create();
+	job_options running;
+	running.token = abortable;
+	std::atomic<bool> started{false};
+	auto stopped = manager.enqueue<int>([&](should_abort_t should_abort, abort_t abort) -> int {
+		started = true;
+		while (not should_abort()) {
+			std::this_thread::yield();
+		}
+		abort();
+		return 0;
+	}, count_aborted, running);
+
+	while (not started.load()) {
+		std::this_thread::yield();
+	}
+	abortable.cancel();
+	while (not stopped.is_finished()) {
+		std::this_thread::yield();
+	}
+	manager.stop();
+	manager.execute_callbacks();
+	TESTEQUALS(aborted_callbacks, 3);
+}
+
+
 void test_job_manager() {
 	test_simple_job();
 	test_simple_job_with_exception();
+	test_nested_jobs();
+	test_thread_callbacks();
+	test_priorities();
+}
+
+
+/**
+ * Parallel loops cover their range once, also when nested in jobs,
+ * and pass on the exceptions of their chunks.
+ */
+void test_parallel_loops(JobManager *manager) {
+	constexpr size_t count = 10000;
+	std::vector<int> visits(count, 0);
+	parallel_for(manager, 0, count, 37, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			visits[i] += 1;
+		}
+	});
+	for (size_t i = 0; i < count; i++) {
+		TESTEQUALS(visits[i], 1);
+	}
+
+	auto sum = [](size_t begin, size_t end) {
+		size_t result = 0;
+		for (size_t i = begin; i < end; i++) {
+			result += i;
+		}
+		return result;
+	};
+	auto add = [](size_t a, size_t b) {
+		return a + b;
+	};
+	TESTEQUALS(parallel_reduce(manager, 0, count, 100, size_t{0}, sum, add), count * (count - 1) / 2);
+	TESTEQUALS(parallel_reduce(manager, 5, 5, 100, size_t{3}, sum, add), 3u);
+
+	// the inner loops claim their own chunks, so they can't block each other
+	std::atomic<size_t> inner{0};
+	parallel_for(manager, 0, 16, 1, [&](size_t, size_t) {
+		parallel_for(manager, 0, 100, 10, [&](size_t begin, size_t end) {
+			inner += end - begin;
+		});
+	});
+	TESTEQUALS(inner.load(), 1600u);
+
+	TESTTHROWS(parallel_for(manager, 0, 100, 10, [](size_t begin, size_t) {
+		if (begin == 50) {
+			throw Error{MSG(err) << "chunk failed"};
+		}
+	}));
+
+	// the calling thread runs only the chunks of its loop
+	JobManager stopped{2};
+	bool unrelated = false;
+	stopped.enqueue<bool>([&unrelated]() {
+		unrelated = true;
+		return true;
+	});
+	size_t covered = 0;
+	parallel_for(&stopped, 0, 100, 10, [&](size_t begin, size_t end) {
+		covered += end - begin;
+	});
+	TESTEQUALS(covered, 100u);
+	(not unrelated) or TESTFAIL;
+}
+
+
+/**
+ * Tasks start after their predecessors, and a failed task
+ * skips the ones that did not start yet.
+ */
+void test_task_graph(JobManager *manager) {
+	constexpr size_t layers = 20;
+	constexpr size_t width = 8;
+
+	TaskGraph graph{manager};
+	std::atomic<int> clock{0};
+	std::vector<int> finished(layers * width, -1);
+	std::vector<std::vector<TaskGraph::task_id>> predecessors(layers * width);
+
+	// each task depends on two of the previous layer
+	for (size_t layer = 0; layer < layers; layer++) {
+		for (size_t i = 0; i < width; i++) {
+			size_t index = layer * width + i;
+			if (layer > 0) {
+				predecessors[index] = {(layer - 1) * width + i, (layer - 1) * width + (i + 3) % width};
+			}
+			TaskGraph::task_id id = graph.add([&finished, &clock, index]() {
+				finished[index] = clock++;
+			}, predecessors[index]);
+			TESTEQUALS(id, index);
+		}
+	}
+	TESTEQUALS(graph.size(), layers * width);
+	TESTTHROWS(graph.add([]() {}, {layers * width}));
+
+	for (int round = 0; round < 2; round++) {
+		graph.run();
+		for (size_t index = 0; index < layers * width; index++) {
+			(finished[index] >= 0) or TESTFAIL;
+			for (auto predecessor : predecessors[index]) {
+				(finished[predecessor] < finished[index]) or TESTFAIL;
+			}
+		}
+	}
+
+	TaskGraph failing{manager};
+	bool skipped = true;
+	auto first = failing.add([]() {
+		throw Error{MSG(err) << "task failed"};
+	});
+	failing.add([&skipped]() {
+		skipped = false;
+	}, {first});
+	TESTTHROWS(failing.run());
+	skipped or TESTFAIL;
+}
+
+
+void test_parallel() {
+	test_parallel_loops(nullptr);
+	test_task_graph(nullptr);
+
+	JobManager manager{4};
+	manager.start();
+	test_parallel_loops(&manager);
+	test_task_graph(&manager);
+	manager.stop();
+
+	// without running workers, the calling thread does all jobs
+	JobManager stopped{2};
+	test_parallel_loops(&stopped);
+	test_task_graph(&stopped);
+}
+
+
+/**
+ * Runs the given pattern of jobs with one to all hardware threads as
+ * workers and logs how long it took, the pattern must wait for its jobs.
+ */
+template <typename F>
+void measure_workers(const char *pattern, F run) {
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	for (int workers = 1; workers <= threads; workers++) {
+		JobManager manager{workers};
+		manager.start();
+
+		time_nsec_t start = timing::get_monotonic_time();
+		run(manager);
+		time_nsec_t duration = timing::get_monotonic_time() - start;
+		manager.stop();
+
+		log::log(MSG(info) << pattern << " with " << workers << " workers: "
+		         << duration / 1000000 << " ms");
+	}
+}
+
+
+/**
+ * Enqueues a million jobs that do nearly nothing from one thread.
+ */
+void benchmark_tiny_jobs() {
+	constexpr int jobs = 1000000;
+
+	measure_workers("tiny jobs", [](JobManager &manager) {
+		std::atomic<int> finished{0};
+		auto job = [&finished]() -> int {
+			finished++;
+			return 0;
+		};
+
+		for (int i = 0; i < jobs; i++) {
+			manager.enqueue<int>(job);
+		}
+		while (finished.load() < jobs) {
+			std::this_thread::yield();
+		}
+	});
+}
+
+
+/**
+ * Enqueues jobs that each fork a thousand tiny jobs,
+ * which the workers steal from each other.
+ */
+void benchmark_fork_join() {
+	constexpr int parents = 1000;
+	constexpr int children = 1000;
+
+	measure_workers("fork join", [](JobManager &manager) {
+		std::atomic<int> finished{0};
+		auto child = [&finished]() -> int {
+			finished++;
+			return 0;
+		};
+
+		for (int i = 0; i < parents; i++) {
+			manager.enqueue<int>([&manager, &child]() -> int {
+				for (int j = 0; j < children; j++) {
+					manager.enqueue<int>(child);
+				}
+				return 0;
+			});
+		}
+		while (finished.load() < parents * children) {
+			std::this_thread::yield();
+		}
+	});
 }
 
 
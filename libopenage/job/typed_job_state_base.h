@@ -5,6 +5,7 @@
 #include <atomic>
 #include <exception>
 #include <functional>
+#include <utility>
 
 #include "../util/thread_id.h"
 #include "../error/error.h"
@@ -51,7 +52,7 @@ public:
 	TypedJobStateBase(callback_function_t<T> callback)
 		:
 		thread_id{openage::util::get_current_thread_id()},
-		callback{callback},
+		callback{std::move(callback)},
 		finished{false} {
 	}
 
@@ -67,6 +68,8 @@ public:
 		try {
 			this->result = this->execute_and_get(should_abort);
 		} catch (JobAbortedException &e) {
+			this->exception = std::current_exception();
+			this->finished.store(true);
 			return true;
 		} catch (...) {
 			this->exception = std::current_exception();
@@ -75,6 +78,11 @@ public:
 		return false;
 	}
 
+	void abort() override {
+		this->exception = std::make_exception_ptr(JobAbortedException{});
+		this->finished.store(true);
+	}
+
 	/**
 	 * Called when the job was finished.
 	 * This is the result notification for the place where the job was constructed.
@@ -93,6 +101,10 @@ public:
 		}
 	}
 
+	bool has_callback() const override {
+		return static_cast<bool>(this->callback);
+	}
+
 	size_t get_thread_id() override {
 		return this->thread_id;
 	}
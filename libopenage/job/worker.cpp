@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "job_aborted_exception.h"
 #include "job_manager.h"
@@ -9,10 +9,28 @@ namespace openage {
 namespace job {
 
 
-Worker::Worker(JobManager *manager)
+namespace {
+
+/** The worker that runs on this thread. */
+thread_local Worker *current_worker = nullptr;
+
+} // anonymous namespace
+
+
+Worker::Worker(JobManager *manager, uint64_t seed)
 	:
 	manager{manager},
-	is_running{false} {
+	is_running{false},
+	pending_count{0},
+	victim_seed{seed | 1} {
+}
+
+
+Worker::~Worker() {
+	// the worker thread has been joined, so the deque can be emptied from here
+	while (JobStateBase *job = this->local_jobs.take()) {
+		job->keep_alive.reset();
+	}
 }
 
 
@@ -23,23 +41,20 @@ void Worker::start() {
 
 
 void Worker::stop() {
-	std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
 	this->is_running = false;
-	lock.unlock();
-	this->notify();
 }
 
 
 void Worker::enqueue(std::shared_ptr<JobStateBase> job) {
+	this->manager->track_completion(*job);
+
 	std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
 	this->pending_jobs.push(job);
+	this->pending_count += 1;
 	lock.unlock();
-	this->notify();
-}
 
-
-void Worker::notify() {
-	this->jobs_available.notify_all();
+	// the waking worker may not be this one, so all have to look
+	this->manager->idle_workers.notify_all();
 }
 
 
@@ -48,70 +63,113 @@ void Worker::join() {
 }
 
 
-void Worker::execute_job(std::shared_ptr<JobStateBase> &job) {
-	auto should_abort = [this]() {
-		return not this->is_running;
-	};
+Worker *Worker::current() {
+	return current_worker;
+}
 
-	bool aborted = job->execute(should_abort);
-	// if the job was not aborted, tell the job manager, that the job has
-	// finished
-	if (not aborted) {
-		this->manager->finish_job(job);
+
+void Worker::push_local(std::shared_ptr<JobStateBase> job) {
+	JobStateBase *state = job.get();
+	state->keep_alive = std::move(job);
+	this->local_jobs.push(state);
+}
+
+
+std::shared_ptr<JobStateBase> Worker::steal() {
+	JobStateBase *state = this->local_jobs.steal();
+	if (state == nullptr) {
+		return std::shared_ptr<JobStateBase>{};
 	}
+	return std::move(state->keep_alive);
 }
 
 
-void Worker::process() {
-	// as long as this worker thread is running repeat all steps
-	while (true) {
-		// lock the local thread queue
-		std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
-
-		// if this thread shall not run any longer, exit the loop
-		if (not this->is_running) {
-			return;
+std::shared_ptr<JobStateBase> Worker::find_job() {
+	if (this->pending_count.load() > 0) {
+		std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
+		auto job = this->pending_jobs.pop();
+		if (job) {
+			this->pending_count -= 1;
+			return job;
 		}
+	}
 
-		// as long as there are no jobs from the local queue or the job manager
-		while (this->pending_jobs.empty() and not this->manager->has_job()) {
-			// the thread should wait
-			this->jobs_available.wait(lock);
+	auto job = this->manager->fetch_job(job_priority::realtime);
+	if (job) {
+		return job;
+	}
+
+	if (JobStateBase *state = this->local_jobs.take()) {
+		return std::move(state->keep_alive);
+	}
 
-			// when the thread is notified, first check if the thread should be
-			// stopped
-			if (not this->is_running) {
-				return;
+	job = this->manager->fetch_job();
+	if (job) {
+		return job;
+	}
+
+	// steal from the others, beginning at a random one
+	auto &workers = this->manager->workers;
+	this->victim_seed ^= this->victim_seed << 13;
+	this->victim_seed ^= this->victim_seed >> 7;
+	this->victim_seed ^= this->victim_seed << 17;
+	size_t first = this->victim_seed % workers.size();
+	for (size_t i = 0; i < workers.size(); i++) {
+		Worker *victim = workers[(first + i) % workers.size()].get();
+		if (victim != this) {
+			job = victim->steal();
+			if (job) {
+				return job;
 			}
 		}
+	}
+	return job;
+}
 
-		// check if there are jobs in the local queue
-		if (not this->pending_jobs.empty()) {
-			// fetch the job
-			auto job = this->pending_jobs.front();
-			this->pending_jobs.pop();
-			// release the local queue lock
-			lock.unlock();
-			// and execute the job
-			this->execute_job(job);
-		} else {
-			// otherwise just unlock the local queue
-			lock.unlock();
-		}
 
-		// after possibly executing a job from the local queue, check again if
-		// the thread should still continue running
-		if (not this->is_running) {
-			return;
+void Worker::execute_job(std::shared_ptr<JobStateBase> &job) {
+	if (this->manager->drop_expired(job)) {
+		return;
+	}
+
+	auto &state = *job;
+	auto should_abort = [this, &state]() {
+		return not this->is_running or state.expired();
+	};
+
+	// aborted jobs are finished with a JobAbortedException. if someone
+	// waits for the callback, tell the job manager that the job has finished
+	job->execute(should_abort);
+	if (job->has_callback()) {
+		this->manager->finish_job(job);
+	}
+}
+
+
+void Worker::process() {
+	current_worker = this;
+
+	while (this->is_running) {
+		auto job = this->find_job();
+
+		if (not job) {
+			// look once more after announcing the wait, so that no job
+			// enqueued meanwhile is missed, then sleep until a new one
+			uint64_t key = this->manager->idle_workers.prepare_wait();
+			job = this->find_job();
+			if (not job and this->is_running) {
+				this->manager->idle_workers.wait(key);
+				continue;
+			}
+			this->manager->idle_workers.cancel_wait();
 		}
 
-		// now try to fetch a job from the job manager
-		auto manager_job = this->manager->fetch_job();
-		if (manager_job.get() != nullptr) {
-			// and execute it
-			this->execute_job(manager_job);
+		if (job) {
+			this->execute_job(job);
 		}
 	}
+
+	current_worker = nullptr;
 }
 
 
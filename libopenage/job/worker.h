@@ -1,13 +1,16 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <atomic>
-#include <condition_variable>
+#include <cstdint>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <thread>
 
+#include "../datastructure/work_stealing_deque.h"
+#include "job_options.h"
+#include "job_queue.h"
 #include "job_state_base.h"
 
 namespace openage {
@@ -18,6 +21,11 @@ class JobManager;
 /**
  * A worker encapsulates the execution of multiple jobs in a single background
  * thread.
+ *
+ * Jobs that are enqueued by a job of the worker are pushed to its own deque.
+ * The worker executes the newest of them first, idle workers steal the
+ * oldest ones. Jobs from other threads are taken from the job manager's
+ * queue, jobs of a job group only by the worker of the group.
  */
 class Worker {
 private:
@@ -25,58 +33,86 @@ private:
 	JobManager *manager;
 
 	/** Whether this worker thread is still running. */
-	bool is_running;
+	std::atomic_bool is_running;
 
 	/** The executing thread. */
 	std::unique_ptr<std::thread> executor;
 
-	/** A mutex to synchronize the internal pending jobs queue. */
+	/** Jobs enqueued by this worker's jobs, which other workers may steal. */
+	datastructure::WorkStealingDeque<JobStateBase> local_jobs;
+
+	/** A mutex to synchronize the queue of job group jobs. */
 	std::mutex pending_jobs_mutex;
 
-	/** A queue of jobs that are to be executed. */
-	std::queue<std::shared_ptr<JobStateBase>> pending_jobs;
+	/** A queue of job group jobs that only this worker executes. */
+	JobQueue pending_jobs;
+
+	/** Number of jobs in the pending job queue, to check it without locking. */
+	std::atomic<size_t> pending_count;
 
-	/** A condition variable to wait for new jobs. */
-	std::condition_variable jobs_available;
+	/** State of the generator that picks the workers to steal from. */
+	uint64_t victim_seed;
 
 public:
 	/** Constructs a new worker with the parent job manager. */
-	Worker(JobManager *manager);
+	Worker(JobManager *manager, uint64_t seed);
 
-	/** Default destructor. */
-	~Worker() = default;
+	/** Drops the jobs that were not executed. */
+	~Worker();
 
 	/** Starts this worker. */
 	void start();
 
-	/** Stops this worker. */
+	/** Stops this worker, the job manager wakes it afterwards. */
 	void stop();
 
 	/** Joins the internal executing thread. */
 	void join();
 
-	/** Adds the given job to the internal pending job queue. */
+	/** Adds the given job to the job group queue of this worker. */
 	void enqueue(std::shared_ptr<JobStateBase> job);
 
 	/**
-	 * Notifies this worker, that new jobs are available. This method is
-	 * although called from the parent job manager.
+	 * Returns the worker that runs on the current thread,
+	 * nullptr if it is not a worker thread.
 	 */
-	void notify();
+	static Worker *current();
 
 private:
+	/**
+	 * Pushes a job to the own deque. May only be called
+	 * on the worker's thread.
+	 */
+	void push_local(std::shared_ptr<JobStateBase> job);
+
+	/** Takes the oldest job of the own deque, from any thread. */
+	std::shared_ptr<JobStateBase> steal();
+
+	/**
+	 * Looks for a job in the job group queue, the realtime jobs of the job
+	 * manager, the own deque, the other jobs of the job manager and the
+	 * deques of the other workers, in this order.
+	 * Returns a nullptr if none was found.
+	 */
+	std::shared_ptr<JobStateBase> find_job();
+
 	/**
 	 * Executes the given job and tells the parent job manager, when it has
-	 * finished.
+	 * finished. Jobs that expired before are dropped.
 	 */
 	void execute_job(std::shared_ptr<JobStateBase> &job);
 
 	/**
-	 * Fetches pending jobs from the parent job manager and from the internal
-	 * pending job queue and executes them. If no jobs are available the
-	 * internal execution thread is wait using a condition variable.
+	 * Executes jobs as long as the worker runs. If no jobs are available,
+	 * the thread waits until the job manager is notified of new ones.
 	 */
 	void process();
+
+	/**
+	 * The job manager pushes jobs of workers to their deques
+	 * and lets the workers steal from each other.
+	 */
+	friend class JobManager;
 };
 
 }
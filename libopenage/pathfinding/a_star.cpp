@@ -12,130 +12,321 @@
 
 #include "a_star.h"
 
+#include <algorithm>
 #include <cmath>
 
-#include "../datastructure/pairing_heap.h"
 #include "../log/log.h"
 #include "../terrain/terrain.h"
 #include "../terrain/terrain_object.h"
 #include "../util/strings.h"
 #include "path.h"
 #include "heuristics.h"
+#include "hierarchy.h"
+#include "path_cache.h"
+#include "search_context.h"
 
 
 namespace openage {
 namespace path {
 
+namespace {
+
+/**
+ * Use the cached path of the key, or search it with hierarchical().
+ * Found paths are smoothed, complete ones are stored in the cache.
+ */
+Path cached(openage::TerrainObject *to_move,
+            const path_key &key,
+            coord::phys3 end,
+            std::function<bool(const coord::phys3 &)> valid_end,
+            std::function<cost_t(const coord::phys3 &)> heuristic) {
+	auto terrain = to_move->get_terrain();
+	if (not terrain) {
+		return hierarchical(to_move, end, valid_end, heuristic);
+	}
+
+	PathCache &cache = terrain->get_path_cache();
+	Path result;
+	if (cache.lookup(key, result)) {
+		return result;
+	}
+
+	result = smooth(hierarchical(to_move, end, valid_end, heuristic), to_move->passable);
+	if (not result.waypoints.empty() and valid_end(result.waypoints.front().position)) {
+		cache.store(key, result);
+	}
+	return result;
+}
+
+} // anonymous namespace
+
 
 Path to_point(coord::phys3 start,
               coord::phys3 end,
-              std::function<bool(const coord::phys3 &)> passable) {
+              std::function<bool(const coord::phys3 &)> passable,
+              search_method method) {
 	auto valid_end = [&](const coord::phys3 &point) -> bool {
 		return euclidean_squared_cost(point, end) < path_grid_size_squared;
 	};
 	auto heuristic = [&](const coord::phys3 &point) -> cost_t {
 		return euclidean_cost(point, end);
 	};
+	if (method == search_method::jump_point) {
+		return jump_point_search(start, valid_end, heuristic, passable);
+	}
 	return a_star(start, valid_end, heuristic, passable);
 }
 
 
+Path to_point(openage::TerrainObject *to_move,
+              coord::phys3 end) {
+	auto valid_end = [end](const coord::phys3 &point) -> bool {
+		return euclidean_squared_cost(point, end) < path_grid_size_squared;
+	};
+	auto heuristic = [end](const coord::phys3 &point) -> cost_t {
+		return euclidean_cost(point, end);
+	};
+
+	path_key key{
+		to_move->pos.draw.to_tile3().to_tile(),
+		nullptr,
+		end.to_tile3().to_tile(),
+		0,
+		to_move->min_axis(),
+		to_move->allowed_terrain
+	};
+	Path result = cached(to_move, key, end, valid_end, heuristic);
+
+	// the cached path may end elsewhere on the goal tile
+	if (not result.waypoints.empty()) {
+		result.waypoints.front().position = end;
+	}
+	return result;
+}
+
+
 Path to_object(openage::TerrainObject *to_move,
                openage::TerrainObject *end,
                coord::phys_t rad) {
-	coord::phys3 start = to_move->pos.draw;
-	auto valid_end = [&](const coord::phys3 &pos) -> bool {
+	auto valid_end = [end, rad](const coord::phys3 &pos) -> bool {
 		return end->from_edge(pos) < rad;
 	};
-	auto heuristic = [&](const coord::phys3 &pos) -> cost_t {
+	auto heuristic = [to_move, end](const coord::phys3 &pos) -> cost_t {
 		return end->from_edge(pos) - to_move->min_axis() / 2;
 	};
-	return a_star(start, valid_end, heuristic, to_move->passable);
+
+	// moving targets can't share paths
+	if (not end->covers_tiles()) {
+		return hierarchical(to_move, end->pos.draw, valid_end, heuristic);
+	}
+
+	path_key key{
+		to_move->pos.draw.to_tile3().to_tile(),
+		end,
+		end->pos.start,
+		rad,
+		to_move->min_axis(),
+		to_move->allowed_terrain
+	};
+	return cached(to_move, key, end->pos.draw, valid_end, heuristic);
+}
+
+
+Path hierarchical(openage::TerrainObject *to_move,
+                  coord::phys3 end,
+                  std::function<bool(const coord::phys3 &)> valid_end,
+                  std::function<cost_t(const coord::phys3 &)> heuristic) {
+	coord::phys3 start = to_move->pos.draw;
+	coord::tile start_tile = start.to_tile3().to_tile();
+	coord::tile end_tile = end.to_tile3().to_tile();
+
+	auto terrain = to_move->get_terrain();
+
+	// short distances are cheap enough for a plain search
+	std::vector<coord::tile> route;
+	if (not terrain or
+	    to_move->allowed_terrain == 0 or
+	    start_tile.to_chunk() == end_tile.to_chunk() or
+	    not terrain->get_path_hierarchy(to_move->allowed_terrain).find_route(start_tile, end_tile, route)) {
+		return a_star(start, valid_end, heuristic, to_move->passable);
+	}
+
+	return refine(start, route, valid_end, heuristic, to_move->passable);
+}
+
+
+Path refine(coord::phys3 start,
+            const std::vector<coord::tile> &route,
+            std::function<bool(const coord::phys3 &)> valid_end,
+            std::function<cost_t(const coord::phys3 &)> heuristic,
+            std::function<bool(const coord::phys3 &)> passable) {
+
+	// refine the route one portal after another,
+	// each search only spans the chunks around one border.
+	std::vector<Path> parts;
+	coord::phys3 part_start = start;
+	bool complete = true;
+	for (const coord::tile &portal : route) {
+		coord::phys3 portal_center = portal.to_tile3().to_phys3();
+		auto at_portal = [&portal](const coord::phys3 &pos) -> bool {
+			return pos.to_tile3().to_tile() == portal;
+		};
+		auto to_portal = [&portal_center](const coord::phys3 &pos) -> cost_t {
+			return euclidean_cost(pos, portal_center);
+		};
+
+		if (at_portal(part_start)) {
+			continue;
+		}
+
+		// the portal is reachable inside the chunks around both ends, but
+		// maybe only by a detour, so search there without giving up on far nodes.
+		coord::chunk from_chunk = part_start.to_tile3().to_tile().to_chunk();
+		coord::chunk to_chunk = portal.to_chunk();
+		auto in_chunks = [&](const coord::phys3 &pos) -> bool {
+			coord::chunk chunk = pos.to_tile3().to_tile().to_chunk();
+			return (chunk.ne >= std::min(from_chunk.ne, to_chunk.ne) and
+			        chunk.ne <= std::max(from_chunk.ne, to_chunk.ne) and
+			        chunk.se >= std::min(from_chunk.se, to_chunk.se) and
+			        chunk.se <= std::max(from_chunk.se, to_chunk.se) and
+			        passable(pos));
+		};
+
+		parts.push_back(a_star(part_start, at_portal, to_portal, in_chunks, false));
+		const Path &part = parts.back();
+		if (part.waypoints.empty() or not at_portal(part.waypoints.front().position)) {
+			// the portal can't be reached by this object,
+			// return the partial path, it will search again later.
+			complete = false;
+			break;
+		}
+		part_start = part.waypoints.front().position;
+	}
+
+	if (complete) {
+		parts.push_back(a_star(part_start, valid_end, heuristic, passable));
+	}
+
+	// waypoints are stored from the end to the start
+	Path result;
+	for (auto part = parts.rbegin(); part != parts.rend(); ++part) {
+		result.waypoints.insert(std::end(result.waypoints),
+		                        std::begin(part->waypoints),
+		                        std::end(part->waypoints));
+	}
+	return result;
 }
 
 
 Path find_nearest(coord::phys3 start,
                   std::function<bool(const coord::phys3 &)> valid_end,
-                  std::function<bool(const coord::phys3 &)> passable) {
+                  std::function<bool(const coord::phys3 &)> passable,
+                  search_method method) {
 	// Use Dijkstra (hueristic = 0)
 	auto zero = [](const coord::phys3 &) -> cost_t { return .0f; };
+	if (method == search_method::jump_point) {
+		return jump_point_search(start, valid_end, zero, passable);
+	}
 	return a_star(start, valid_end, zero, passable);
 }
 
 Path a_star(coord::phys3 start,
             std::function<bool(const coord::phys3 &)> valid_end,
             std::function<cost_t(const coord::phys3 &)> heuristic,
-            std::function<bool(const coord::phys3 &)> passable) {
-
-	// path node storage, always provides cheapest next node.
-	heap_t node_candidates;
+            std::function<bool(const coord::phys3 &)> passable,
+            bool bounded,
+            search_statistics *statistics) {
 
-	// list of known tiles and corresponding node.
-	nodemap_t visited_tiles;
+	// node storage, visited tiles and candidate heap,
+	// reused by all searches of this thread.
+	static thread_local SearchContext search;
+	search.reset(start);
 
 	// add starting node
-	node_pt start_node = std::make_shared<Node>(start, nullptr, .0f, heuristic(start));
-	visited_tiles[start_node->position] = start_node;
-	node_candidates.push(start_node);
-
-	start_node->heap_node = node_candidates.push(start_node);
+	search_node_id start_node = search.create(start, no_search_node);
+	{
+		SearchNode &node = search.get(start_node);
+		node.heuristic_cost = heuristic(start);
+		node.future_cost = node.heuristic_cost;
+	}
+	search.visit(start_node);
+	search.push(start_node);
 
 	// track the closest we can get to the end position
 	// used when no path is found
-	node_pt closest_node = start_node;
+	search_node_id closest_node = start_node;
 
 	// while there are candidates to visit
-	while (not node_candidates.empty()) {
-		node_pt best_candidate = node_candidates.pop();
+	while (not search.empty()) {
+		search_node_id best_candidate = search.pop();
 
-		best_candidate->was_best = true;
+		search.get(best_candidate).was_best = true;
+		if (statistics) {
+			statistics->expanded += 1;
+		}
 
 		// node to terminate the search was found
-		if (valid_end(best_candidate->position)) {
+		if (valid_end(search.get(best_candidate).position)) {
 			log::log(MSG(dbg) <<
 				"path cost is " <<
-				util::FloatFixed<3, 8>{closest_node->future_cost / coord::settings::phys_per_tile});
+				util::FloatFixed<3, 8>{search.get(closest_node).future_cost / coord::settings::phys_per_tile});
 
-			return best_candidate->generate_backtrace();
+			return search.generate_backtrace(best_candidate);
 		}
 
 		// closest node for cases when target cannot be reached
-		if (best_candidate->heuristic_cost < closest_node->heuristic_cost) {
+		if (search.get(best_candidate).heuristic_cost < search.get(closest_node).heuristic_cost) {
 			closest_node = best_candidate;
 		}
 
 		// evaluate all neighbors of the current candidate for further progress
-		for (node_pt neighbor : best_candidate->get_neighbors(visited_tiles)) {
-			if (neighbor->was_best) {
+		for (int n = 0; n < 8; ++n) {
+			coord::phys3 neighbor_pos = search.get(best_candidate).position + neigh_phys[n];
+
+			search_node_id neighbor = search.find(neighbor_pos);
+			bool not_visited = (neighbor == no_search_node);
+
+			if (not_visited) {
+				neighbor = search.create(neighbor_pos, best_candidate);
+			}
+			else if (search.get(neighbor).was_best) {
 				continue;
 			}
-			if (not passable_line(best_candidate, neighbor, passable)) {
+
+			if (not passable_line(search.get(best_candidate).position, neighbor_pos, passable)) {
+				if (not_visited) {
+					search.discard(neighbor);
+				}
 				continue;
 			}
 
-			bool not_visited = (visited_tiles.count(neighbor->position) == 0);
-			cost_t new_past_cost = best_candidate->past_cost + best_candidate->cost_to(*neighbor);
+			cost_t new_past_cost = search.get(best_candidate).past_cost + search.cost(best_candidate, neighbor);
+			SearchNode &neighbor_node = search.get(neighbor);
 
 			// if new cost is better than the previous path
-			if (not_visited or new_past_cost < neighbor->past_cost) {
+			if (not_visited or new_past_cost < neighbor_node.past_cost) {
 				if (not_visited) {
 					// calculate heuristic only once per node
-					neighbor->heuristic_cost = heuristic(neighbor->position);
+					neighbor_node.heuristic_cost = heuristic(neighbor_pos);
 				}
-				if (neighbor->heuristic_cost > closest_node->heuristic_cost * 3) {
+				if (bounded and
+				    neighbor_node.heuristic_cost > search.get(closest_node).heuristic_cost * 3) {
+					if (not_visited) {
+						search.discard(neighbor);
+					}
 					continue; // dont search forever...
 				}
 
 				// update new cost knowledge
-				neighbor->past_cost        = new_past_cost;
-				neighbor->future_cost      = neighbor->past_cost + neighbor->heuristic_cost;
-				neighbor->path_predecessor = best_candidate;
+				neighbor_node.past_cost   = new_past_cost;
+				neighbor_node.future_cost = neighbor_node.past_cost + neighbor_node.heuristic_cost;
+				neighbor_node.predecessor = best_candidate;
 
 				if (not_visited) {
-					neighbor->heap_node = node_candidates.push(neighbor);
-					visited_tiles[neighbor->position] = neighbor;
+					search.push(neighbor);
+					search.visit(neighbor);
 				} else {
-					node_candidates.update(neighbor->heap_node);
+					search.update(neighbor);
 				}
 			}
 		}
@@ -143,9 +334,9 @@ Path a_star(coord::phys3 start,
 
 	log::log(MSG(dbg) <<
 		"incomplete path cost is " <<
-		util::FloatFixed<3, 8>{closest_node->future_cost / coord::settings::phys_per_tile});
+		util::FloatFixed<3, 8>{search.get(closest_node).future_cost / coord::settings::phys_per_tile});
 
-	return closest_node->generate_backtrace();
+	return search.generate_backtrace(closest_node);
 }
 
 
@@ -1,8 +1,9 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "heuristics.h"
 #include "path.h"
@@ -13,12 +14,33 @@ class TerrainObject;
 
 namespace path {
 
+struct search_statistics;
+
+/**
+ * algorithm of a search on the path grid.
+ *
+ * jump point search expands far fewer nodes on open ground, but
+ * it ignores the turning factor: all moves have their euclidean cost.
+ */
+enum class search_method {
+	a_star,
+	jump_point,
+};
+
 /**
  * path between two static points
  */
 Path to_point(coord::phys3 start,
               coord::phys3 end,
-              std::function<bool(const coord::phys3 &)> passable);
+              std::function<bool(const coord::phys3 &)> passable,
+              search_method method=search_method::a_star);
+
+/**
+ * path of an object to a static point.
+ * uses the chunk graphs of the terrain for long distances.
+ */
+Path to_point(TerrainObject *to_move,
+              coord::phys3 end);
 
 /**
  * path between 2 objects, with how close to come to end point
@@ -32,7 +54,35 @@ Path to_object(TerrainObject *to_move,
  */
 Path find_nearest(coord::phys3 start,
                   std::function<bool(const coord::phys3 &)> valid_end,
-                  std::function<bool(const coord::phys3 &)> passable);
+                  std::function<bool(const coord::phys3 &)> passable,
+                  search_method method=search_method::a_star);
+
+/**
+ * path of an object across chunks.
+ *
+ * a route of chunk border portals is searched on the chunk graphs
+ * of the terrain first, then a_star refines it between the portals.
+ * the last part of the path is searched with the given end condition.
+ *
+ * falls back to a plain a_star when no route is found.
+ */
+Path hierarchical(TerrainObject *to_move,
+                  coord::phys3 end,
+                  std::function<bool(const coord::phys3 &)> valid_end,
+                  std::function<cost_t(const coord::phys3 &)> heuristic);
+
+/**
+ * refine a route of chunk border portals to a path.
+ * a_star searches from portal to portal, the last part
+ * is searched with the given end condition.
+ *
+ * if a portal can't be reached, the path ends there.
+ */
+Path refine(coord::phys3 start,
+            const std::vector<coord::tile> &route,
+            std::function<bool(const coord::phys3 &)> valid_end,
+            std::function<cost_t(const coord::phys3 &)> heuristic,
+            std::function<bool(const coord::phys3 &)> passable);
 
 /**
  * finds a path between two endpoints
@@ -40,12 +90,35 @@ Path find_nearest(coord::phys3 start,
  * @param end the ending tile coords
  * @param heuristic the heuristic for evaluating cost
  * @param passable lambda to decide which terrain is passable
+ * @param bounded skip nodes much farther from the end than the closest
+ *        one yet, so unreachable ends don't search forever. only disable
+ *        it if passable limits the searched area.
+ * @param statistics counters to fill, may be nullptr
  * @return path between the given tiles
  */
 Path a_star(coord::phys3 start,
             std::function<bool(const coord::phys3 &)> valid_end,
             std::function<cost_t(const coord::phys3 &)> heuristic,
-            std::function<bool(const coord::phys3 &)> passable);
+            std::function<bool(const coord::phys3 &)> passable,
+            bool bounded=true,
+            search_statistics *statistics=nullptr);
+
+/**
+ * finds a path with jump point search, parameters as in a_star.
+ *
+ * moves along straight lines are not expanded node by node, the search
+ * jumps ahead until a turn may be needed. diagonal moves are only taken
+ * if both adjacent straight moves are passable, so corners are not cut.
+ *
+ * the waypoints are the jump points, consecutive ones are connected
+ * by a straight or diagonal line on the path grid.
+ */
+Path jump_point_search(coord::phys3 start,
+                       std::function<bool(const coord::phys3 &)> valid_end,
+                       std::function<cost_t(const coord::phys3 &)> heuristic,
+                       std::function<bool(const coord::phys3 &)> passable,
+                       bool bounded=true,
+                       search_statistics *statistics=nullptr);
 
 } // namespace path
 } // namespace openage
@@ -0,0 +1,216 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "flow_field.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+#include "../coord/tile3.h"
+#include "../terrain/terrain_object.h"
+#include "hierarchy.h"
+
+
+namespace openage {
+namespace path {
+
+namespace {
+
+constexpr cost_t infinite_cost = std::numeric_limits<cost_t>::infinity();
+constexpr cost_t diagonal_cost = 1.41421356f;
+
+/**
+ * Number of tile neighbors, neigh_offsets[i] and
+ * neigh_offsets[(i + 4) % 8] point in opposite directions.
+ */
+constexpr int neigh_count = 8;
+
+/**
+ * Additional chunks around the group and target area,
+ * so the field also covers paths that need a detour.
+ */
+constexpr coord::chunk_t field_margin = 1;
+
+} // anonymous namespace
+
+
+FlowField::FlowField(const Hierarchy &hierarchy, const coord::tile &target,
+                     const coord::chunk &min, const coord::chunk &max)
+	:
+	target{target} {
+
+	coord::chunk first = min;
+	this->origin = first.to_tile(coord::tile_delta{0, 0});
+	this->width = (max.ne - min.ne + 1) * coord::settings::tiles_per_chunk;
+	this->height = (max.se - min.se + 1) * coord::settings::tiles_per_chunk;
+
+	size_t tile_count = this->width * this->height;
+	this->integration.assign(tile_count, infinite_cost);
+	this->directions.assign(tile_count, -1);
+
+	ENSURE(this->covers(target), "flow field does not contain its target");
+
+	std::vector<bool> passable(tile_count);
+	for (coord::tile_t se = 0; se < this->height; se++) {
+		for (coord::tile_t ne = 0; ne < this->width; ne++) {
+			passable[se * this->width + ne] = hierarchy.tile_passable(this->origin + coord::tile_delta{ne, se});
+		}
+	}
+
+	// dijkstra from the target, which may itself be blocked (e.g. by a building).
+	// the direction of each tile points back to the tile it was reached from.
+	using entry = std::pair<cost_t, size_t>;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+
+	size_t start = this->index(target);
+	this->integration[start] = 0;
+	open.emplace(0, start);
+
+	while (not open.empty()) {
+		entry current = open.top();
+		open.pop();
+		if (current.first > this->integration[current.second]) {
+			continue;
+		}
+
+		coord::tile_t ne = current.second % this->width;
+		coord::tile_t se = current.second / this->width;
+
+		for (int i = 0; i < neigh_count; i++) {
+			const coord::tile_delta &offset = neigh_offsets[i];
+			coord::tile_t n_ne = ne + offset.ne;
+			coord::tile_t n_se = se + offset.se;
+			if (n_ne < 0 or n_ne >= this->width or
+			    n_se < 0 or n_se >= this->height) {
+				continue;
+			}
+
+			size_t next = n_se * this->width + n_ne;
+			if (not passable[next]) {
+				continue;
+			}
+
+			cost_t step = 1;
+			if (offset.ne != 0 and offset.se != 0) {
+				if (not passable[se * this->width + n_ne] or
+				    not passable[n_se * this->width + ne]) {
+					continue;
+				}
+				step = diagonal_cost;
+			}
+
+			cost_t cost = current.first + step;
+			if (cost < this->integration[next]) {
+				this->integration[next] = cost;
+				this->directions[next] = (i + neigh_count / 2) % neigh_count;
+				open.emplace(cost, next);
+			}
+		}
+	}
+}
+
+
+size_t FlowField::index(const coord::tile &pos) const {
+	coord::tile_delta local = pos - this->origin;
+	return local.se * this->width + local.ne;
+}
+
+
+bool FlowField::covers(const coord::tile &pos) const {
+	coord::tile_delta local = pos - this->origin;
+	return (local.ne >= 0 and local.ne < this->width and
+	        local.se >= 0 and local.se < this->height);
+}
+
+
+bool FlowField::reachable(const coord::tile &pos) const {
+	return this->covers(pos) and this->integration[this->index(pos)] < infinite_cost;
+}
+
+
+cost_t FlowField::distance(const coord::tile &pos) const {
+	if (not this->covers(pos)) {
+		return infinite_cost;
+	}
+	return this->integration[this->index(pos)];
+}
+
+
+int FlowField::direction(const coord::tile &pos) const {
+	if (not this->covers(pos)) {
+		return -1;
+	}
+	return this->directions[this->index(pos)];
+}
+
+
+Path FlowField::follow(const coord::phys3 &start, const coord::phys3 &end) const {
+	coord::tile current = start.to_tile3().to_tile();
+	if (not this->reachable(current)) {
+		return {};
+	}
+
+	// collected from start to end, reversed at the end
+	std::vector<Node> waypoints;
+	int previous = -1;
+	for (int dir = this->direction(current); dir >= 0; dir = this->direction(current)) {
+		if (dir != previous and previous >= 0) {
+			coord::phys3 corner = current.to_tile3().to_phys3(phys_half_tile);
+			corner.up = start.up;
+			waypoints.emplace_back(corner, nullptr);
+		}
+		previous = dir;
+		current = current + neigh_offsets[dir];
+	}
+	waypoints.emplace_back(end, nullptr);
+
+	std::reverse(std::begin(waypoints), std::end(waypoints));
+	return {waypoints};
+}
+
+
+FlowFieldGroup::FlowFieldGroup(const coord::phys3 &target,
+                               const coord::tile &min, const coord::tile &max)
+	:
+	target(target),
+	min{min},
+	max{max} {}
+
+
+std::shared_ptr<FlowField> FlowFieldGroup::get(TerrainObject *to_move) {
+	auto terrain = to_move->get_terrain();
+	if (not terrain or to_move->allowed_terrain == 0) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> guard{this->lock};
+
+	std::weak_ptr<FlowField> &entry = this->fields[to_move->allowed_terrain];
+	std::shared_ptr<FlowField> field = entry.lock();
+	if (field) {
+		return field;
+	}
+
+	coord::tile target_tile = this->target.to_tile3().to_tile();
+	coord::chunk target_chunk = target_tile.to_chunk();
+	coord::chunk area_min = this->min.to_chunk();
+	coord::chunk area_max = this->max.to_chunk();
+
+	coord::chunk field_min{
+		static_cast<coord::chunk_t>(std::min(area_min.ne, target_chunk.ne) - field_margin),
+		static_cast<coord::chunk_t>(std::min(area_min.se, target_chunk.se) - field_margin)
+	};
+	coord::chunk field_max{
+		static_cast<coord::chunk_t>(std::max(area_max.ne, target_chunk.ne) + field_margin),
+		static_cast<coord::chunk_t>(std::max(area_max.se, target_chunk.se) + field_margin)
+	};
+
+	field = std::make_shared<FlowField>(
+		terrain->get_path_hierarchy(to_move->allowed_terrain),
+		target_tile, field_min, field_max
+	);
+	entry = field;
+	return field;
+}
+
+}} // namespace openage::path
@@ -0,0 +1,136 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+/** @file
+ *
+ * Flow fields for moving groups of objects to the same target.
+ *
+ * Instead of searching one path per object, the distance to the
+ * target is integrated once over the area of the group, and each
+ * tile stores the direction to its best neighbor. Every object of the
+ * group then only has to follow the directions from its own tile.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../terrain/terrain.h"
+#include "path.h"
+
+
+namespace openage {
+
+class TerrainObject;
+
+namespace path {
+
+class Hierarchy;
+
+
+/**
+ * Integration and direction field towards one target tile,
+ * covering a rectangle of chunks.
+ */
+class FlowField {
+public:
+	/**
+	 * Integrate the field over all chunks from min to max (inclusive).
+	 * Passability is taken from the given hierarchy.
+	 */
+	FlowField(const Hierarchy &hierarchy, const coord::tile &target,
+	          const coord::chunk &min, const coord::chunk &max);
+
+	/**
+	 * Is the tile inside the area of this field?
+	 */
+	bool covers(const coord::tile &pos) const;
+
+	/**
+	 * Can the target be reached from this tile?
+	 */
+	bool reachable(const coord::tile &pos) const;
+
+	/**
+	 * Integrated movement cost in tiles from this tile to the target.
+	 */
+	cost_t distance(const coord::tile &pos) const;
+
+	/**
+	 * Index into neigh_offsets of the next tile towards the target,
+	 * -1 at the target itself and for unreachable tiles.
+	 */
+	int direction(const coord::tile &pos) const;
+
+	/**
+	 * Follow the directions from a start position to the end position.
+	 * Waypoints are only set where the direction changes.
+	 *
+	 * @returns an empty path if the start tile can't reach the target.
+	 */
+	Path follow(const coord::phys3 &start, const coord::phys3 &end) const;
+
+	const coord::tile target;
+
+private:
+	size_t index(const coord::tile &pos) const;
+
+	/**
+	 * First tile of the area and its size in tiles.
+	 */
+	coord::tile origin;
+	coord::tile_t width;
+	coord::tile_t height;
+
+	/**
+	 * Integration field, infinity for unreachable tiles.
+	 */
+	std::vector<cost_t> integration;
+
+	/**
+	 * Direction field, see direction().
+	 */
+	std::vector<int8_t> directions;
+};
+
+
+/**
+ * Flow fields towards one target, shared by a group of objects
+ * which were commanded to move there together.
+ *
+ * A field is created on first use for each kind of terrain the
+ * group members may stand on. The objects which move along a field
+ * own it, it is freed when the last of them no longer needs it.
+ */
+class FlowFieldGroup {
+public:
+	/**
+	 * @param target the common target position
+	 * @param min, max: area in which the group members start
+	 */
+	FlowFieldGroup(const coord::phys3 &target,
+	               const coord::tile &min, const coord::tile &max);
+
+	/**
+	 * Get the field for an object of the group,
+	 * nullptr if the object can't use flow fields.
+	 */
+	std::shared_ptr<FlowField> get(TerrainObject *to_move);
+
+	const coord::phys3 target;
+
+private:
+	coord::tile min;
+	coord::tile max;
+
+	std::mutex lock;
+	std::unordered_map<terrain_mask_t, std::weak_ptr<FlowField>> fields;
+};
+
+}} // namespace openage::path
@@ -0,0 +1,462 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "hierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "../terrain/terrain_object.h"
+
+
+namespace openage {
+namespace path {
+
+namespace {
+
+constexpr coord::tile_t chunk_tiles = coord::settings::tiles_per_chunk;
+constexpr size_t chunk_tile_count = chunk_tiles * chunk_tiles;
+constexpr cost_t infinite_cost = std::numeric_limits<cost_t>::infinity();
+constexpr cost_t diagonal_cost = 1.41421356f;
+
+using chunk_costs_t = std::array<cost_t, chunk_tile_count>;
+
+
+/**
+ * Index of a tile in the arrays covering its chunk.
+ * Same layout as TerrainChunk::tile_position.
+ */
+size_t local_index(const coord::tile &pos) {
+	coord::tile_delta on_chunk = pos.get_pos_on_chunk();
+	return on_chunk.se * chunk_tiles + on_chunk.ne;
+}
+
+
+/**
+ * First tile of a chunk.
+ */
+coord::tile chunk_origin(coord::chunk position) {
+	return position.to_tile(coord::tile_delta{0, 0});
+}
+
+
+/**
+ * Movement cost estimation in tiles with diagonal steps.
+ */
+cost_t octile_cost(const coord::tile &a, const coord::tile &b) {
+	cost_t dne = std::abs(a.ne - b.ne);
+	cost_t dse = std::abs(a.se - b.se);
+	return std::max(dne, dse) + (diagonal_cost - 1) * std::min(dne, dse);
+}
+
+
+/**
+ * Dijkstra from one tile to all others, without leaving the chunk.
+ * Diagonal steps must not cut corners.
+ */
+void chunk_distances(size_t start, const chunk_bitmap_t &passable, chunk_costs_t &result) {
+	using entry = std::pair<cost_t, size_t>;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+
+	result.fill(infinite_cost);
+	result[start] = 0;
+	open.emplace(0, start);
+
+	while (not open.empty()) {
+		entry current = open.top();
+		open.pop();
+		if (current.first > result[current.second]) {
+			continue;
+		}
+
+		coord::tile_t ne = current.second % chunk_tiles;
+		coord::tile_t se = current.second / chunk_tiles;
+
+		for (const coord::tile_delta &offset : neigh_offsets) {
+			coord::tile_t n_ne = ne + offset.ne;
+			coord::tile_t n_se = se + offset.se;
+			if (n_ne < 0 or n_ne >= chunk_tiles or
+			    n_se < 0 or n_se >= chunk_tiles) {
+				continue;
+			}
+
+			size_t next = n_se * chunk_tiles + n_ne;
+			if (not passable[next]) {
+				continue;
+			}
+
+			cost_t step = 1;
+			if (offset.ne != 0 and offset.se != 0) {
+				if (not passable[se * chunk_tiles + n_ne] or
+				    not passable[n_se * chunk_tiles + ne]) {
+					continue;
+				}
+				step = diagonal_cost;
+			}
+
+			cost_t cost = current.first + step;
+			if (cost < result[next]) {
+				result[next] = cost;
+				open.emplace(cost, next);
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
+
+ChunkGraph::ChunkGraph()
+	:
+	dirty{true} {
+
+	this->portal_at.fill(-1);
+}
+
+
+int ChunkGraph::portal_index(const coord::tile &pos) const {
+	return this->portal_at[local_index(pos)];
+}
+
+
+Hierarchy::Hierarchy(Terrain *terrain, terrain_mask_t allowed_terrain)
+	:
+	rebuild_count{0},
+	terrain{terrain},
+	allowed_terrain{allowed_terrain} {
+
+	this->refresh_all();
+}
+
+
+void Hierarchy::refresh(const coord::chunk &position) {
+	ChunkPassability &bitmap = this->passability[position];
+	coord::tile origin = chunk_origin(position);
+	for (size_t i = 0; i < chunk_tile_count; i++) {
+		bitmap.tiles[i] = this->check_tile(origin + coord::tile_delta{
+			static_cast<coord::tile_t>(i % chunk_tiles),
+			static_cast<coord::tile_t>(i / chunk_tiles)
+		});
+	}
+
+	auto mark = [this](const coord::chunk &pos) {
+		auto it = this->graphs.find(pos);
+		if (it != this->graphs.end()) {
+			it->second.dirty = true;
+		}
+	};
+
+	mark(position);
+	for (const coord::tile_delta &offset : chunk_side_offsets) {
+		mark(coord::chunk{
+			static_cast<coord::chunk_t>(position.ne + offset.ne),
+			static_cast<coord::chunk_t>(position.se + offset.se)
+		});
+	}
+}
+
+
+void Hierarchy::refresh_all() {
+	this->graphs.clear();
+	for (const coord::chunk &position : this->terrain->used_chunks()) {
+		this->refresh(position);
+	}
+}
+
+
+bool Hierarchy::tile_passable(const coord::tile &pos, const TerrainObject *ignore) const {
+	auto bitmap = this->passability.find(pos.to_chunk());
+	if (bitmap == this->passability.end()) {
+		return false;
+	}
+	if (bitmap->second.tiles[local_index(pos)]) {
+		return true;
+	}
+
+	// the tile may only be blocked by the ignored building itself
+	if (ignore != nullptr and ignore->covers_tiles() and ignore->check_collisions()) {
+		return this->check_tile(pos, ignore);
+	}
+	return false;
+}
+
+
+const ChunkPassability &Hierarchy::get_passability(const coord::chunk &position) const {
+	static const ChunkPassability blocked{};
+
+	auto bitmap = this->passability.find(position);
+	if (bitmap == this->passability.end()) {
+		return blocked;
+	}
+	return bitmap->second;
+}
+
+
+bool Hierarchy::check_tile(const coord::tile &pos, const TerrainObject *ignore) const {
+	TileContent tc = this->terrain->get_data(pos);
+	if (tc == nullptr or
+	    not fits_terrain_mask(tc.get_terrain_id()) or
+	    not ((this->allowed_terrain >> tc.get_terrain_id()) & 1)) {
+		return false;
+	}
+
+	for (auto obj : tc.obj) {
+		if (obj != ignore and obj->covers_tiles() and obj->check_collisions()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+const ChunkGraph &Hierarchy::get_graph(const coord::chunk &position) {
+	ChunkGraph &graph = this->graphs[position];
+	if (graph.dirty) {
+		this->build(position, graph);
+	}
+	return graph;
+}
+
+
+void Hierarchy::build(const coord::chunk &position, ChunkGraph &graph) {
+	this->rebuild_count += 1;
+
+	graph.portals.clear();
+	graph.portal_at.fill(-1);
+
+	coord::tile origin = chunk_origin(position);
+
+	const chunk_bitmap_t &passable = this->get_passability(position).tiles;
+
+	auto add_portal = [&graph](const coord::tile &pos, int side) {
+		size_t idx = local_index(pos);
+		if (graph.portal_at[idx] < 0) {
+			graph.portal_at[idx] = graph.portals.size();
+			graph.portals.push_back(Portal{pos, 0});
+		}
+		graph.portals[graph.portal_at[idx]].sides |= (1 << side);
+	};
+
+	// entrances are maximal runs of border tiles that are passable
+	// on both sides. the adjacent chunk walks the same runs in the same
+	// order, so both choose matching portal tiles.
+	for (int side = 0; side < chunk_side_count; side++) {
+		const coord::tile_delta &across = chunk_side_offsets[side];
+
+		// side 0 and 2 are borders along se, 1 and 3 along ne
+		coord::tile_delta along = (side % 2 == 0) ? coord::tile_delta{0, 1} : coord::tile_delta{1, 0};
+		coord::tile first = origin;
+		if (across.ne > 0) {
+			first.ne += chunk_tiles - 1;
+		}
+		if (across.se > 0) {
+			first.se += chunk_tiles - 1;
+		}
+
+		auto border_tile = [&](coord::tile_t i) {
+			return first + coord::tile_delta{along.ne * i, along.se * i};
+		};
+
+		coord::tile_t run_start = -1;
+		for (coord::tile_t i = 0; i <= chunk_tiles; i++) {
+			bool open = false;
+			if (i < chunk_tiles) {
+				coord::tile pos = border_tile(i);
+				open = passable[local_index(pos)] and this->tile_passable(pos + across);
+			}
+
+			if (open and run_start < 0) {
+				run_start = i;
+			}
+			else if (not open and run_start >= 0) {
+				coord::tile_t run_end = i - 1;
+				if (run_end - run_start + 1 >= long_entrance_length) {
+					add_portal(border_tile(run_start), side);
+					add_portal(border_tile(run_end), side);
+				}
+				else {
+					add_portal(border_tile((run_start + run_end) / 2), side);
+				}
+				run_start = -1;
+			}
+		}
+	}
+
+	// cache the distances between all portals of the chunk
+	size_t count = graph.portals.size();
+	graph.distances.resize(count * count);
+
+	chunk_costs_t costs;
+	for (size_t from = 0; from < count; from++) {
+		chunk_distances(local_index(graph.portals[from].position), passable, costs);
+		for (size_t to = 0; to < count; to++) {
+			graph.distances[from * count + to] = costs[local_index(graph.portals[to].position)];
+		}
+	}
+
+	graph.dirty = false;
+}
+
+
+bool Hierarchy::find_route(const coord::tile &start, const coord::tile &goal,
+                           std::vector<coord::tile> &route) {
+	route.clear();
+
+	coord::chunk start_chunk = start.to_chunk();
+	coord::chunk goal_chunk = goal.to_chunk();
+
+	// connect the start to the portals of its chunk
+	chunk_costs_t start_costs;
+	chunk_distances(local_index(start), this->get_passability(start_chunk).tiles, start_costs);
+
+	// and the goal, if it can be reached at all
+	bool goal_open = this->tile_passable(goal);
+	chunk_costs_t goal_costs;
+	if (goal_open) {
+		if (start_chunk == goal_chunk and
+		    start_costs[local_index(goal)] < infinite_cost) {
+			return true;
+		}
+		chunk_distances(local_index(goal), this->get_passability(goal_chunk).tiles, goal_costs);
+	}
+
+	auto goal_cost = [&](const coord::tile &pos) -> cost_t {
+		if (not (pos.to_chunk() == goal_chunk)) {
+			return infinite_cost;
+		}
+		return goal_open ? goal_costs[local_index(pos)] : 0;
+	};
+
+	auto heuristic = [&](const coord::tile &pos) -> cost_t {
+		if (goal_open) {
+			return octile_cost(pos, goal);
+		}
+		// any portal of the goal chunk is fine, they are at most
+		// two chunk sizes closer than the goal tile.
+		return std::max<cost_t>(0, octile_cost(pos, goal) - 2 * chunk_tiles);
+	};
+
+	struct record {
+		cost_t cost;
+		coord::tile prev;
+		bool has_prev;
+		bool closed;
+	};
+
+	struct entry {
+		cost_t future_cost;
+		cost_t past_cost;
+		coord::tile pos;
+
+		bool operator <(const entry &other) const {
+			return this->future_cost > other.future_cost;
+		}
+	};
+
+	std::unordered_map<coord::tile, record> records;
+	std::priority_queue<entry> open;
+
+	auto relax = [&](const coord::tile &pos, cost_t cost, const coord::tile *prev) {
+		auto it = records.find(pos);
+		if (it != records.end() and it->second.cost <= cost) {
+			return;
+		}
+		record &rec = records[pos];
+		rec.cost = cost;
+		rec.has_prev = (prev != nullptr);
+		if (prev != nullptr) {
+			rec.prev = *prev;
+		}
+		rec.closed = false;
+		open.push(entry{cost + heuristic(pos), cost, pos});
+	};
+
+	for (const Portal &portal : this->get_graph(start_chunk).portals) {
+		cost_t cost = start_costs[local_index(portal.position)];
+		if (cost < infinite_cost) {
+			relax(portal.position, cost, nullptr);
+		}
+	}
+
+	cost_t best_goal = infinite_cost;
+	coord::tile goal_prev = start;
+
+	while (not open.empty()) {
+		entry current = open.top();
+		open.pop();
+
+		if (current.future_cost >= best_goal) {
+			break;
+		}
+
+		record &rec = records[current.pos];
+		if (rec.closed or current.past_cost > rec.cost) {
+			continue;
+		}
+		rec.closed = true;
+
+		cost_t to_goal = current.past_cost + goal_cost(current.pos);
+		if (to_goal < best_goal) {
+			best_goal = to_goal;
+			goal_prev = current.pos;
+		}
+
+		coord::chunk chunk = current.pos.to_chunk();
+		const ChunkGraph &graph = this->get_graph(chunk);
+		int from = graph.portal_index(current.pos);
+		if (from < 0) {
+			continue;
+		}
+
+		// edges to the other portals of this chunk
+		for (size_t to = 0; to < graph.portals.size(); to++) {
+			cost_t distance = graph.distance(from, to);
+			if (static_cast<int>(to) != from and distance < infinite_cost) {
+				relax(graph.portals[to].position, current.past_cost + distance, &current.pos);
+			}
+		}
+
+		// and across the chunk border
+		uint8_t sides = graph.portals[from].sides;
+		for (int side = 0; side < chunk_side_count; side++) {
+			if (not (sides & (1 << side))) {
+				continue;
+			}
+			coord::tile across = current.pos + chunk_side_offsets[side];
+			if (this->get_graph(across.to_chunk()).portal_index(across) >= 0) {
+				relax(across, current.past_cost + 1, &current.pos);
+			}
+		}
+	}
+
+	if (best_goal == infinite_cost) {
+		return false;
+	}
+
+	// collect the portals backwards
+	std::vector<coord::tile> portals;
+	for (coord::tile pos = goal_prev;;) {
+		portals.push_back(pos);
+		const record &rec = records[pos];
+		if (not rec.has_prev) {
+			break;
+		}
+		pos = rec.prev;
+	}
+	std::reverse(std::begin(portals), std::end(portals));
+
+	// a portal followed by its counterpart across the border
+	// is redundant, passing the second one crosses the border anyway.
+	for (size_t i = 0; i < portals.size(); i++) {
+		if (i + 1 < portals.size() and
+		    not (portals[i].to_chunk() == portals[i + 1].to_chunk())) {
+			continue;
+		}
+		route.push_back(portals[i]);
+	}
+
+	return true;
+}
+
+}} // namespace openage::path
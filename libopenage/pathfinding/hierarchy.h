@@ -0,0 +1,214 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+/** @file
+ *
+ * Hierarchical path planning (HPA*) on terrain chunks.
+ *
+ * Each chunk gets an abstract graph whose nodes are the entrance tiles
+ * (portals) on its border, connected by the cached shortest distances
+ * inside the chunk. Long routes are searched on these graphs first and
+ * then refined only in the chunks along the route.
+ *
+ * Literature:
+ * Botea, Adi, Martin Müller, and Jonathan Schaeffer. "Near optimal
+ * hierarchical path-finding." Journal of game development 1, no. 1
+ * (2004): 7-28.
+ */
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/tile.h"
+#include "../terrain/terrain.h"
+#include "path.h"
+
+
+namespace openage {
+namespace path {
+
+/**
+ * Number of chunk sides that can have portals.
+ * 0: ne+, 1: se+, 2: ne-, 3: se-
+ */
+constexpr int chunk_side_count = 4;
+
+/**
+ * Offset to the tile across the border for each chunk side.
+ */
+constexpr coord::tile_delta const chunk_side_offsets[chunk_side_count] = {
+	{ 1,  0},
+	{ 0,  1},
+	{-1,  0},
+	{ 0, -1}
+};
+
+/**
+ * Entrance runs at least this long get a portal at each end
+ * instead of one in the middle.
+ */
+constexpr int long_entrance_length = 6;
+
+
+/**
+ * An entrance tile on the border of a chunk.
+ */
+struct Portal {
+	coord::tile position;
+
+	/**
+	 * Bitmask of the chunk sides the portal leads through,
+	 * bit n = chunk_side_offsets[n].
+	 */
+	uint8_t sides;
+};
+
+
+/**
+ * Passability bitmap of one terrain chunk, bit n is the tile
+ * at the same index as in TerrainChunk::tile_position.
+ */
+using chunk_bitmap_t = std::bitset<coord::settings::tiles_per_chunk * coord::settings::tiles_per_chunk>;
+
+
+/**
+ * Tiles of one terrain chunk that can be passed.
+ */
+class ChunkPassability {
+public:
+	/**
+	 * Allowed terrain and not blocked by a building.
+	 */
+	chunk_bitmap_t tiles;
+};
+
+
+/**
+ * Abstract graph of one terrain chunk.
+ */
+class ChunkGraph {
+public:
+	ChunkGraph();
+
+	/**
+	 * Chunk has to be rebuilt before the next use.
+	 */
+	bool dirty;
+
+	std::vector<Portal> portals;
+
+	/**
+	 * Shortest distance in tiles between two portals
+	 * of this chunk, portals.size() squared entries.
+	 * Infinity if the chunk does not connect them.
+	 */
+	std::vector<cost_t> distances;
+
+	/**
+	 * Portal index for each tile of the chunk, -1 if it is none.
+	 */
+	std::array<int16_t, coord::settings::tiles_per_chunk * coord::settings::tiles_per_chunk> portal_at;
+
+	/**
+	 * Distance between the portals with the given indices.
+	 */
+	cost_t distance(size_t from, size_t to) const {
+		return this->distances[from * this->portals.size() + to];
+	}
+
+	/**
+	 * Portal index at a tile of this chunk, -1 if the tile is no portal.
+	 */
+	int portal_index(const coord::tile &pos) const;
+};
+
+
+/**
+ * Chunk graphs of a terrain for objects that may stand on the given
+ * terrain ids. Tiles blocked by placed buildings are impassable,
+ * moving units are ignored.
+ *
+ * The passability bitmaps are kept up to date by the game thread
+ * whenever the terrain reports changes to a chunk, so other threads
+ * may read them while no chunk changes. The graphs are built on
+ * first use and rebuilt lazily, only the game thread may get them.
+ */
+class Hierarchy {
+public:
+	Hierarchy(Terrain *terrain, terrain_mask_t allowed_terrain);
+
+	/**
+	 * Rebuild the passability bitmap of a chunk and mark its graph and
+	 * the graphs of its adjacent chunks as outdated. The adjacent ones
+	 * share the entrances on the common border.
+	 */
+	void refresh(const coord::chunk &position);
+
+	/**
+	 * Rebuild the bitmaps of all chunks of the terrain
+	 * and drop all graphs.
+	 */
+	void refresh_all();
+
+	/**
+	 * Can objects of this hierarchy stand on the given tile?
+	 * Looked up in the bitmap of the tile's chunk.
+	 *
+	 * @param ignore object whose own tiles don't block it, e.g. the
+	 *               building that tests whether it may stay.
+	 */
+	bool tile_passable(const coord::tile &pos, const TerrainObject *ignore=nullptr) const;
+
+	/**
+	 * Get the passability bitmap of a chunk,
+	 * nothing is passable on chunks that don't exist.
+	 */
+	const ChunkPassability &get_passability(const coord::chunk &position) const;
+
+	/**
+	 * Get the up to date graph of a chunk.
+	 */
+	const ChunkGraph &get_graph(const coord::chunk &position);
+
+	/**
+	 * Search a route on the chunk graphs.
+	 *
+	 * If the goal tile is impassable (e.g. the target building stands
+	 * there), reaching the chunk of the goal is sufficient.
+	 *
+	 * @param route filled with the portal tiles to pass in order.
+	 *              the goal itself is not included.
+	 * @returns false if there is no route.
+	 */
+	bool find_route(const coord::tile &start, const coord::tile &goal,
+	                std::vector<coord::tile> &route);
+
+	/**
+	 * Number of graph rebuilds, for statistics and tests.
+	 */
+	size_t rebuild_count;
+
+private:
+	/**
+	 * Recreate the portals and distances of a chunk.
+	 */
+	void build(const coord::chunk &position, ChunkGraph &graph);
+
+	/**
+	 * Test a tile on the terrain, for building the bitmaps.
+	 */
+	bool check_tile(const coord::tile &pos, const TerrainObject *ignore=nullptr) const;
+
+	Terrain *terrain;
+	terrain_mask_t allowed_terrain;
+
+	std::unordered_map<coord::chunk, ChunkPassability, coord_chunk_hash> passability;
+	std::unordered_map<coord::chunk, ChunkGraph, coord_chunk_hash> graphs;
+};
+
+}} // namespace openage::path
@@ -0,0 +1,295 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+/** @file
+ *
+ * This file implements jump point search on the path grid.
+ *
+ * Literature:
+ * Harabor, Daniel, and Alban Grastien. "Online graph pruning for pathfinding
+ * on grid maps." Proceedings of the Twenty-Fifth AAAI Conference on
+ * Artificial Intelligence (2011): 1114-1119.
+ */
+
+#include "a_star.h"
+
+#include "../log/log.h"
+#include "../util/strings.h"
+#include "heuristics.h"
+#include "path.h"
+#include "search_context.h"
+
+
+namespace openage {
+namespace path {
+
+namespace {
+
+/**
+ * Longest jump in path grid steps (8 tiles). Jumps on open
+ * or endless terrain stop there and continue from a new node.
+ */
+constexpr int max_jump = 64;
+
+using passable_t = std::function<bool(const coord::phys3 &)>;
+
+/**
+ * Outcome of a jump.
+ */
+enum class jump_result {
+	blocked, //!< no jump point in this direction
+	found,   //!< a jump point or an end
+	limit,   //!< max_jump was reached
+};
+
+
+coord::phys3_delta grid_step(int ne, int se) {
+	return coord::phys3_delta{ne * path_grid_size, se * path_grid_size, 0};
+}
+
+
+int sign(coord::phys_t value) {
+	return (value > 0) - (value < 0);
+}
+
+
+/**
+ * Can the step from pos in the direction be taken?
+ * Diagonal steps need both adjacent straight steps, so corners are not cut.
+ */
+bool can_step(const coord::phys3 &pos, int ne, int se, const passable_t &passable) {
+	if (not passable(pos + grid_step(ne, se))) {
+		return false;
+	}
+	if (ne != 0 and se != 0) {
+		return passable(pos + grid_step(ne, 0)) and passable(pos + grid_step(0, se));
+	}
+	return true;
+}
+
+
+/**
+ * Move pos along a straight direction until a neighbor is forced,
+ * i.e. an open side that was blocked one step back.
+ */
+jump_result jump_straight(coord::phys3 &pos, int ne, int se,
+                          const passable_t &valid_end, const passable_t &passable) {
+	for (int i = 0; i < max_jump; i++) {
+		if (not passable(pos + grid_step(ne, se))) {
+			return jump_result::blocked;
+		}
+		pos += grid_step(ne, se);
+
+		if (valid_end(pos)) {
+			return jump_result::found;
+		}
+
+		for (int side = -1; side <= 1; side += 2) {
+			if (ne != 0) {
+				if (passable(pos + grid_step(0, side)) and
+				    not passable(pos + grid_step(-ne, side))) {
+					return jump_result::found;
+				}
+			}
+			else {
+				if (passable(pos + grid_step(side, 0)) and
+				    not passable(pos + grid_step(side, -se))) {
+					return jump_result::found;
+				}
+			}
+		}
+	}
+	return jump_result::limit;
+}
+
+
+/**
+ * Move pos along a diagonal direction until one of
+ * the straight jumps from there finds a jump point.
+ */
+jump_result jump_diagonal(coord::phys3 &pos, int ne, int se,
+                          const passable_t &valid_end, const passable_t &passable) {
+	for (int i = 0; i < max_jump; i++) {
+		if (not can_step(pos, ne, se, passable)) {
+			return jump_result::blocked;
+		}
+		pos += grid_step(ne, se);
+
+		if (valid_end(pos)) {
+			return jump_result::found;
+		}
+
+		coord::phys3 probe = pos;
+		if (jump_straight(probe, ne, 0, valid_end, passable) == jump_result::found) {
+			return jump_result::found;
+		}
+		probe = pos;
+		if (jump_straight(probe, 0, se, valid_end, passable) == jump_result::found) {
+			return jump_result::found;
+		}
+	}
+	return jump_result::limit;
+}
+
+} // anonymous namespace
+
+
+Path jump_point_search(coord::phys3 start,
+                       std::function<bool(const coord::phys3 &)> valid_end,
+                       std::function<cost_t(const coord::phys3 &)> heuristic,
+                       std::function<bool(const coord::phys3 &)> passable,
+                       bool bounded,
+                       search_statistics *statistics) {
+
+	static thread_local SearchContext search;
+	search.reset(start);
+
+	search_node_id start_node = search.create(start, no_search_node);
+	{
+		SearchNode &node = search.get(start_node);
+		node.heuristic_cost = heuristic(start);
+		node.future_cost = node.heuristic_cost;
+	}
+	search.visit(start_node);
+	search.push(start_node);
+
+	search_node_id closest_node = start_node;
+
+	// directions to jump to from the current node
+	int directions[8][2];
+
+	while (not search.empty()) {
+		search_node_id best_candidate = search.pop();
+
+		search.get(best_candidate).was_best = true;
+		if (statistics) {
+			statistics->expanded += 1;
+		}
+
+		coord::phys3 position = search.get(best_candidate).position;
+		if (valid_end(position)) {
+			log::log(MSG(dbg) <<
+				"jump point path cost is " <<
+				util::FloatFixed<3, 8>{search.get(best_candidate).future_cost / coord::settings::phys_per_tile});
+
+			return search.generate_backtrace(best_candidate);
+		}
+
+		if (search.get(best_candidate).heuristic_cost < search.get(closest_node).heuristic_cost) {
+			closest_node = best_candidate;
+		}
+
+		// prune the directions by the one the node was reached from
+		int direction_count = 0;
+		auto add_direction = [&](int ne, int se) {
+			directions[direction_count][0] = ne;
+			directions[direction_count][1] = se;
+			direction_count += 1;
+		};
+
+		search_node_id predecessor = search.get(best_candidate).predecessor;
+		if (predecessor == no_search_node) {
+			for (int ne = -1; ne <= 1; ne++) {
+				for (int se = -1; se <= 1; se++) {
+					if (ne != 0 or se != 0) {
+						add_direction(ne, se);
+					}
+				}
+			}
+		}
+		else {
+			coord::phys3_delta from = position - search.get(predecessor).position;
+			int ne = sign(from.ne);
+			int se = sign(from.se);
+
+			if (ne != 0 and se != 0) {
+				add_direction(ne, 0);
+				add_direction(0, se);
+				add_direction(ne, se);
+			}
+			else if (ne != 0) {
+				add_direction(ne, 0);
+				for (int side = -1; side <= 1; side += 2) {
+					if (passable(position + grid_step(0, side))) {
+						add_direction(0, side);
+						add_direction(ne, side);
+					}
+				}
+			}
+			else {
+				add_direction(0, se);
+				for (int side = -1; side <= 1; side += 2) {
+					if (passable(position + grid_step(side, 0))) {
+						add_direction(side, 0);
+						add_direction(side, se);
+					}
+				}
+			}
+		}
+
+		for (int d = 0; d < direction_count; d++) {
+			int ne = directions[d][0];
+			int se = directions[d][1];
+
+			coord::phys3 jump_point = position;
+			jump_result result;
+			if (ne != 0 and se != 0) {
+				result = jump_diagonal(jump_point, ne, se, valid_end, passable);
+			}
+			else {
+				result = jump_straight(jump_point, ne, se, valid_end, passable);
+			}
+
+			if (result == jump_result::blocked) {
+				continue;
+			}
+
+			search_node_id neighbor = search.find(jump_point);
+			bool not_visited = (neighbor == no_search_node);
+
+			if (not_visited) {
+				neighbor = search.create(jump_point, best_candidate);
+
+				// all moves cost their length, there is no turning factor
+				search.get(neighbor).factor = 1.0f;
+			}
+			else if (search.get(neighbor).was_best) {
+				continue;
+			}
+
+			cost_t new_past_cost = search.get(best_candidate).past_cost + search.cost(best_candidate, neighbor);
+			SearchNode &neighbor_node = search.get(neighbor);
+
+			if (not_visited or new_past_cost < neighbor_node.past_cost) {
+				if (not_visited) {
+					neighbor_node.heuristic_cost = heuristic(jump_point);
+				}
+				if (bounded and
+				    neighbor_node.heuristic_cost > search.get(closest_node).heuristic_cost * 3) {
+					if (not_visited) {
+						search.discard(neighbor);
+					}
+					continue;
+				}
+
+				neighbor_node.past_cost   = new_past_cost;
+				neighbor_node.future_cost = neighbor_node.past_cost + neighbor_node.heuristic_cost;
+				neighbor_node.predecessor = best_candidate;
+
+				if (not_visited) {
+					search.push(neighbor);
+					search.visit(neighbor);
+				} else {
+					search.update(neighbor);
+				}
+			}
+		}
+	}
+
+	log::log(MSG(dbg) <<
+		"incomplete jump point path cost is " <<
+		util::FloatFixed<3, 8>{search.get(closest_node).future_cost / coord::settings::phys_per_tile});
+
+	return search.generate_backtrace(closest_node);
+}
+
+}} // namespace openage::path
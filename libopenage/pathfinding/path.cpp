@@ -98,13 +98,20 @@ std::vector<node_pt> Node::get_neighbors(const nodemap_t &nodes, float scale) {
 
 
 bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)> passable, float samples) {
+	return passable_line(start->position, end->position, passable, samples);
+}
+
+
+bool passable_line(const coord::phys3 &start, const coord::phys3 &end,
+                   const std::function<bool(const coord::phys3 &)> &passable,
+                   float samples) {
 	// interpolate between points and make passablity checks
 	// (dont check starting position)
 	for (int i = 1; i <= samples; ++i) {
 		double percent = (double) i / samples;
-		coord::phys_t ne = (1.0 - percent) * start->position.ne + percent * end->position.ne;
-		coord::phys_t se = (1.0 - percent) * start->position.se + percent * end->position.se;
-		coord::phys_t up = (1.0 - percent) * start->position.up + percent * end->position.up;
+		coord::phys_t ne = (1.0 - percent) * start.ne + percent * end.ne;
+		coord::phys_t se = (1.0 - percent) * start.se + percent * end.se;
+		coord::phys_t up = (1.0 - percent) * start.up + percent * end.up;
 
 		if (!passable(coord::phys3{ne, se, up})) {
 			return false;
@@ -77,6 +77,14 @@ constexpr coord::phys3_delta const neigh_phys[] = {
  */
 bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)>passable, float samples=5.0f);
 
+/**
+ * Sample the straight line between two positions for passability.
+ * The start position is not checked.
+ */
+bool passable_line(const coord::phys3 &start, const coord::phys3 &end,
+                   const std::function<bool(const coord::phys3 &)> &passable,
+                   float samples=5.0f);
+
 /**
  * One navigation waypoint in a path.
  */
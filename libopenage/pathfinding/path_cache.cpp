@@ -0,0 +1,186 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "path_cache.h"
+
+#include <algorithm>
+
+#include "../coord/tile3.h"
+#include "../terrain/terrain_object.h"
+#include "../util/misc.h"
+
+
+namespace openage {
+namespace path {
+
+bool path_key::operator ==(const path_key &other) const {
+	return (this->start == other.start and
+	        this->goal_object == other.goal_object and
+	        this->goal_tile == other.goal_tile and
+	        this->radius == other.radius and
+	        this->object_size == other.object_size and
+	        this->allowed_terrain == other.allowed_terrain);
+}
+
+
+size_t path_key_hash::operator ()(const path_key &key) const {
+	size_t hash = std::hash<coord::tile_t>{}(key.start.ne);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<coord::tile_t>{}(key.start.se);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<const TerrainObject *>{}(key.goal_object);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<coord::tile_t>{}(key.goal_tile.ne);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<coord::tile_t>{}(key.goal_tile.se);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<coord::phys_t>{}(key.radius);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<coord::phys_t>{}(key.object_size);
+	hash = util::rol<size_t, 7>(hash) ^ std::hash<terrain_mask_t>{}(key.allowed_terrain);
+	return hash;
+}
+
+
+PathCache::PathCache()
+	:
+	hits{0},
+	misses{0} {}
+
+
+bool PathCache::lookup(const path_key &key, Path &result) {
+	auto it = this->paths.find(key);
+	if (it == this->paths.end()) {
+		this->misses += 1;
+		return false;
+	}
+
+	this->hits += 1;
+	result = it->second.path;
+	return true;
+}
+
+
+void PathCache::store(const path_key &key, const Path &path) {
+	auto previous = this->paths.find(key);
+	if (previous != this->paths.end()) {
+		this->remove(previous);
+	}
+	else if (this->paths.size() >= path_cache_size) {
+		this->clear();
+	}
+
+	std::vector<coord::chunk> chunks;
+	auto add_chunk = [&chunks](const coord::chunk &chunk) {
+		if (std::find(std::begin(chunks), std::end(chunks), chunk) == std::end(chunks)) {
+			chunks.push_back(chunk);
+		}
+	};
+
+	// chunks the path crosses, sampled every half tile
+	// along the lines between the waypoints.
+	const std::vector<Node> &nodes = path.waypoints;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		const coord::phys3 &to = nodes[i].position;
+		add_chunk(to.to_tile3().to_tile().to_chunk());
+		if (i == 0) {
+			continue;
+		}
+
+		const coord::phys3 &from = nodes[i - 1].position;
+		int steps = distance(from, to) / (coord::settings::phys_per_tile / 2);
+		for (int step = 1; step < steps; step++) {
+			coord::phys3 pos = from + ((to - from) * step) / steps;
+			add_chunk(pos.to_tile3().to_tile().to_chunk());
+		}
+	}
+
+	// the goal is gone when its chunks change
+	if (key.goal_object) {
+		coord::chunk first = key.goal_object->pos.start.to_chunk();
+		coord::chunk last = key.goal_object->pos.end.to_chunk();
+		for (coord::chunk_t ne = first.ne; ne <= last.ne; ne++) {
+			for (coord::chunk_t se = first.se; se <= last.se; se++) {
+				add_chunk(coord::chunk{ne, se});
+			}
+		}
+	}
+
+	for (auto &chunk : chunks) {
+		this->crossing[chunk].push_back(key);
+	}
+	this->paths[key] = entry{path, std::move(chunks)};
+}
+
+
+void PathCache::invalidate(const coord::chunk &position) {
+	auto it = this->crossing.find(position);
+	if (it == this->crossing.end()) {
+		return;
+	}
+
+	std::vector<path_key> keys = std::move(it->second);
+	this->crossing.erase(it);
+
+	for (auto &key : keys) {
+		auto dropped = this->paths.find(key);
+		if (dropped != this->paths.end()) {
+			this->remove(dropped);
+		}
+	}
+}
+
+
+void PathCache::remove(entries_t::iterator it) {
+	for (auto &chunk : it->second.chunks) {
+		auto list = this->crossing.find(chunk);
+		if (list == this->crossing.end()) {
+			continue;
+		}
+
+		std::vector<path_key> &keys = list->second;
+		auto key = std::find(std::begin(keys), std::end(keys), it->first);
+		if (key != std::end(keys)) {
+			*key = keys.back();
+			keys.pop_back();
+		}
+		if (keys.empty()) {
+			this->crossing.erase(list);
+		}
+	}
+	this->paths.erase(it);
+}
+
+
+void PathCache::clear() {
+	this->paths.clear();
+	this->crossing.clear();
+}
+
+
+size_t PathCache::size() const {
+	return this->paths.size();
+}
+
+
+Path smooth(const Path &path,
+            const std::function<bool(const coord::phys3 &)> &passable,
+            size_t max_skip) {
+	const std::vector<Node> &nodes = path.waypoints;
+	if (nodes.size() <= 2) {
+		return path;
+	}
+
+	std::vector<Node> result;
+	result.push_back(nodes.front());
+
+	// extend the straight line from the last kept waypoint
+	// until it would be blocked.
+	size_t anchor = 0;
+	for (size_t next = 2; next < nodes.size(); next++) {
+		float samples = 2.0f * (next - anchor);
+		if (next - anchor > max_skip or
+		    not passable_line(nodes[anchor].position, nodes[next].position, passable, samples)) {
+			anchor = next - 1;
+			result.push_back(nodes[anchor]);
+		}
+	}
+	result.push_back(nodes.back());
+
+	return {result};
+}
+
+}} // namespace openage::path
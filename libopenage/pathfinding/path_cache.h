@@ -0,0 +1,144 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../terrain/terrain.h"
+#include "path.h"
+
+
+namespace openage {
+
+class TerrainObject;
+
+namespace path {
+
+/**
+ * Maximum number of cached paths, the cache is emptied when it is full.
+ */
+constexpr size_t path_cache_size = 4096;
+
+
+/**
+ * Identifies paths that can be shared.
+ */
+struct path_key {
+	/**
+	 * Tile the path starts on.
+	 */
+	coord::tile start;
+
+	/**
+	 * Object the path leads to, nullptr if it leads to goal_tile.
+	 * Only objects that don't move are used.
+	 */
+	const TerrainObject *goal_object;
+	coord::tile goal_tile;
+
+	/**
+	 * How close the path gets to the goal object.
+	 */
+	coord::phys_t radius;
+
+	/**
+	 * Restrictions of the moving object: its size and terrains.
+	 */
+	coord::phys_t object_size;
+	terrain_mask_t allowed_terrain;
+
+	bool operator ==(const path_key &other) const;
+};
+
+
+/**
+ * Hash function for path keys.
+ */
+struct path_key_hash {
+	size_t operator ()(const path_key &key) const;
+};
+
+
+/**
+ * Paths which were found before, to be used again by objects
+ * going the same way, e.g. gatherers between a resource and a dropsite.
+ *
+ * A path is dropped when a chunk it crosses reports a change.
+ */
+class PathCache {
+public:
+	PathCache();
+
+	/**
+	 * Get a cached path.
+	 * @returns false if there is none.
+	 */
+	bool lookup(const path_key &key, Path &result);
+
+	/**
+	 * Remember a path, it is dropped when the chunks crossed
+	 * between its waypoints or the chunks of its goal object change.
+	 */
+	void store(const path_key &key, const Path &path);
+
+	/**
+	 * Drop all paths crossing this chunk.
+	 */
+	void invalidate(const coord::chunk &position);
+
+	/**
+	 * Drop all paths.
+	 */
+	void clear();
+
+	/**
+	 * Number of cached paths.
+	 */
+	size_t size() const;
+
+	/**
+	 * Lookup statistics.
+	 */
+	size_t hits;
+	size_t misses;
+
+private:
+	/**
+	 * A cached path and the chunks whose key lists contain it.
+	 */
+	struct entry {
+		Path path;
+		std::vector<coord::chunk> chunks;
+	};
+
+	using entries_t = std::unordered_map<path_key, entry, path_key_hash>;
+
+	/**
+	 * Drop a path and its key from the lists of all its chunks.
+	 */
+	void remove(entries_t::iterator it);
+
+	entries_t paths;
+
+	/**
+	 * Keys of the paths crossing each chunk.
+	 */
+	std::unordered_map<coord::chunk, std::vector<path_key>, coord_chunk_hash> crossing;
+};
+
+
+/**
+ * Remove the waypoints that can be skipped by walking straight
+ * from the previous kept waypoint. Waypoints are at most max_skip
+ * nodes apart afterwards.
+ */
+Path smooth(const Path &path,
+            const std::function<bool(const coord::phys3 &)> &passable,
+            size_t max_skip=32);
+
+}} // namespace openage::path
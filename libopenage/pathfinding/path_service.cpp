@@ -0,0 +1,263 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "path_service.h"
+
+#include <algorithm>
+
+#include "../coord/tile3.h"
+#include "../job/job_manager.h"
+#include "../terrain/terrain_object.h"
+#include "a_star.h"
+#include "heuristics.h"
+
+
+namespace openage {
+namespace path {
+
+namespace {
+
+constexpr coord::tile_t chunk_tiles = coord::settings::tiles_per_chunk;
+
+/**
+ * Additional chunks around the route in a snapshot,
+ * so the searches can walk around obstacles near the border.
+ */
+constexpr coord::chunk_t snapshot_margin = 1;
+
+} // anonymous namespace
+
+
+TerrainSnapshot::TerrainSnapshot(const Hierarchy &hierarchy, const coord::chunk &min, const coord::chunk &max)
+	:
+	min(min),
+	width{static_cast<coord::chunk_t>(max.ne - min.ne + 1)},
+	height{static_cast<coord::chunk_t>(max.se - min.se + 1)} {
+
+	this->bitmaps.reserve(this->width * this->height);
+	for (coord::chunk_t se = 0; se < this->height; se++) {
+		for (coord::chunk_t ne = 0; ne < this->width; ne++) {
+			coord::chunk pos{
+				static_cast<coord::chunk_t>(min.ne + ne),
+				static_cast<coord::chunk_t>(min.se + se)
+			};
+			this->bitmaps.push_back(hierarchy.get_passability(pos).tiles);
+		}
+	}
+}
+
+
+void TerrainSnapshot::add_objects(Terrain &terrain, const coord::tile &center, const TerrainObject *ignore) {
+	for (coord::tile_t ne = -snapshot_object_range; ne <= snapshot_object_range; ne++) {
+		for (coord::tile_t se = -snapshot_object_range; se <= snapshot_object_range; se++) {
+			TileContent tc = terrain.get_data(center + coord::tile_delta{ne, se});
+			if (tc == nullptr) {
+				continue;
+			}
+
+			for (auto obj : tc.obj) {
+				if (obj == ignore or obj->covers_tiles() or not obj->check_collisions()) {
+					continue;
+				}
+
+				// objects span several tiles, only add them once
+				object entry{obj->pos.draw, obj->min_axis() / 2};
+				auto same = [&entry](const object &other) {
+					return other.position == entry.position and other.radius == entry.radius;
+				};
+				if (std::none_of(std::begin(this->objects), std::end(this->objects), same)) {
+					this->objects.push_back(entry);
+				}
+			}
+		}
+	}
+}
+
+
+bool TerrainSnapshot::tile_passable(const coord::tile &pos) const {
+	coord::chunk chunk = pos.to_chunk();
+	coord::chunk_t ne = chunk.ne - this->min.ne;
+	coord::chunk_t se = chunk.se - this->min.se;
+	if (ne < 0 or ne >= this->width or se < 0 or se >= this->height) {
+		return false;
+	}
+
+	coord::tile_delta on_chunk = pos.get_pos_on_chunk();
+	return this->bitmaps[se * this->width + ne][on_chunk.se * chunk_tiles + on_chunk.ne];
+}
+
+
+bool TerrainSnapshot::passable(const coord::phys3 &pos, coord::phys_t radius) const {
+	coord::phys3 p_start = pos, p_end = pos;
+	p_start.ne -= radius;
+	p_start.se -= radius;
+	p_end.ne += radius;
+	p_end.se += radius;
+
+	coord::tile start = p_start.to_tile3().to_tile();
+	coord::tile end = p_end.to_tile3().to_tile();
+	for (coord::tile_t ne = start.ne; ne <= end.ne; ne++) {
+		for (coord::tile_t se = start.se; se <= end.se; se++) {
+			if (not this->tile_passable(coord::tile{ne, se})) {
+				return false;
+			}
+		}
+	}
+
+	for (const object &other : this->objects) {
+		if (distance(pos, other.position) < radius + other.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+PathRequest::PathRequest(coord::phys3 start, coord::phys3 end, coord::phys_t radius,
+                         terrain_mask_t allowed_terrain, const TerrainObject *ignore)
+	:
+	start(start),
+	end(end),
+	radius{radius},
+	allowed_terrain{allowed_terrain},
+	ignore{ignore},
+	ready{false} {}
+
+
+PathRequest::PathRequest(const TerrainObject &to_move, coord::phys3 end)
+	:
+	PathRequest{to_move.pos.draw, end, to_move.min_axis() / 2,
+	            to_move.allowed_terrain, &to_move} {}
+
+
+bool PathRequest::is_ready() const {
+	return this->ready;
+}
+
+
+PathService::PathService(job::JobManager *job_manager, size_t searches_per_tick)
+	:
+	job_manager{job_manager},
+	searches_per_tick{searches_per_tick},
+	focus{0, 0, 0} {}
+
+
+void PathService::set_terrain(std::shared_ptr<Terrain> terrain) {
+	this->terrain = terrain;
+}
+
+
+void PathService::set_focus(const coord::phys3 &focus) {
+	this->focus = focus;
+}
+
+
+void PathService::request(const std::shared_ptr<PathRequest> &request) {
+	this->queue.push_back(request);
+}
+
+
+size_t PathService::pending() const {
+	return this->queue.size();
+}
+
+
+void PathService::update() {
+	// requests of removed objects are dropped
+	std::vector<std::shared_ptr<PathRequest>> requests;
+	requests.reserve(this->queue.size());
+	for (auto &entry : this->queue) {
+		if (auto request = entry.lock()) {
+			requests.push_back(std::move(request));
+		}
+	}
+	this->queue.clear();
+
+	// the requests closest to the focus go first
+	size_t count = std::min(requests.size(), this->searches_per_tick);
+	auto closer = [this](const std::shared_ptr<PathRequest> &a,
+	                     const std::shared_ptr<PathRequest> &b) {
+		return euclidean_squared_cost(a->start, this->focus) <
+		       euclidean_squared_cost(b->start, this->focus);
+	};
+	std::nth_element(std::begin(requests), std::begin(requests) + count,
+	                 std::end(requests), closer);
+
+	for (size_t i = 0; i < count; i++) {
+		this->start(requests[i]);
+	}
+
+	// the remaining ones wait for the next tick
+	for (size_t i = count; i < requests.size(); i++) {
+		this->queue.push_back(requests[i]);
+	}
+}
+
+
+void PathService::start(const std::shared_ptr<PathRequest> &request) {
+	auto terrain = this->terrain.lock();
+	if (not terrain or request->allowed_terrain == 0) {
+		request->ready = true;
+		return;
+	}
+
+	Hierarchy &hierarchy = terrain->get_path_hierarchy(request->allowed_terrain);
+
+	// the chunk route is found here, only refining it runs in the worker
+	coord::tile start_tile = request->start.to_tile3().to_tile();
+	coord::tile end_tile = request->end.to_tile3().to_tile();
+	std::vector<coord::tile> route;
+	if (not (start_tile.to_chunk() == end_tile.to_chunk())) {
+		hierarchy.find_route(start_tile, end_tile, route);
+	}
+
+	coord::chunk min = start_tile.to_chunk();
+	coord::chunk max = min;
+	auto extend = [&min, &max](const coord::tile &pos) {
+		coord::chunk chunk = pos.to_chunk();
+		min.ne = std::min(min.ne, chunk.ne);
+		min.se = std::min(min.se, chunk.se);
+		max.ne = std::max(max.ne, chunk.ne);
+		max.se = std::max(max.se, chunk.se);
+	};
+	extend(end_tile);
+	for (auto &portal : route) {
+		extend(portal);
+	}
+	min.ne -= snapshot_margin;
+	min.se -= snapshot_margin;
+	max.ne += snapshot_margin;
+	max.se += snapshot_margin;
+
+	auto snapshot = std::make_shared<TerrainSnapshot>(hierarchy, min, max);
+	snapshot->add_objects(*terrain, start_tile, request->ignore);
+
+	coord::phys3 start = request->start;
+	coord::phys3 end = request->end;
+	coord::phys_t radius = request->radius;
+
+	auto search = [snapshot, route, start, end, radius]() -> Path {
+		auto valid_end = [end](const coord::phys3 &point) -> bool {
+			return euclidean_squared_cost(point, end) < path_grid_size_squared;
+		};
+		auto heuristic = [end](const coord::phys3 &point) -> cost_t {
+			return euclidean_cost(point, end);
+		};
+		auto passable = [snapshot, radius](const coord::phys3 &pos) -> bool {
+			return snapshot->passable(pos, radius);
+		};
+		return refine(start, route, valid_end, heuristic, passable);
+	};
+
+	std::weak_ptr<PathRequest> receiver = request;
+	auto deliver = [receiver](job::result_function_t<Path> result) {
+		auto request = receiver.lock();
+		if (request) {
+			request->path = result();
+			request->ready = true;
+		}
+	};
+
+	this->job_manager->enqueue<Path>(search, deliver);
+}
+
+}} // namespace openage::path
@@ -0,0 +1,180 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../terrain/terrain.h"
+#include "hierarchy.h"
+#include "path.h"
+
+
+namespace openage {
+
+class TerrainObject;
+
+namespace job {
+class JobManager;
+} // namespace job
+
+namespace path {
+
+/**
+ * Number of path searches started per game tick by default.
+ */
+constexpr size_t default_searches_per_tick = 32;
+
+/**
+ * Moving objects up to this many tiles around the start
+ * of a search are copied into its snapshot.
+ */
+constexpr coord::tile_t snapshot_object_range = 4;
+
+
+/**
+ * Copy of the terrain state a path search in a worker thread needs.
+ * It is taken in the game thread and never changes afterwards.
+ */
+class TerrainSnapshot {
+public:
+	/**
+	 * Copy the passability bitmaps of all chunks from min to max (inclusive).
+	 */
+	TerrainSnapshot(const Hierarchy &hierarchy, const coord::chunk &min, const coord::chunk &max);
+
+	/**
+	 * Copy the positions of moving objects around a tile,
+	 * ignoring the given object.
+	 */
+	void add_objects(Terrain &terrain, const coord::tile &center, const TerrainObject *ignore);
+
+	/**
+	 * Does a tile bitmap allow it, tiles outside the snapshot are blocked.
+	 */
+	bool tile_passable(const coord::tile &pos) const;
+
+	/**
+	 * Can a radial object with the given radius stand at a position?
+	 * Same tile range as RadialObject::get_range.
+	 */
+	bool passable(const coord::phys3 &pos, coord::phys_t radius) const;
+
+private:
+	/**
+	 * A moving object copied into the snapshot.
+	 */
+	struct object {
+		coord::phys3 position;
+		coord::phys_t radius;
+	};
+
+	coord::chunk min;
+	coord::chunk_t width;
+	coord::chunk_t height;
+
+	std::vector<chunk_bitmap_t> bitmaps;
+	std::vector<object> objects;
+};
+
+
+/**
+ * Search for the path of an object to a fixed point.
+ * The requester keeps this object until the path is ready,
+ * dropping it cancels the search if it was not started yet.
+ */
+class PathRequest {
+public:
+	/**
+	 * @param ignore object that is excluded from the collisions,
+	 *               usually the one that is moving.
+	 */
+	PathRequest(coord::phys3 start, coord::phys3 end, coord::phys_t radius,
+	            terrain_mask_t allowed_terrain, const TerrainObject *ignore=nullptr);
+
+	/**
+	 * Request the path of a radial object to a point.
+	 */
+	PathRequest(const TerrainObject &to_move, coord::phys3 end);
+
+	/**
+	 * Has the search finished?
+	 */
+	bool is_ready() const;
+
+	/**
+	 * The path that was found, may be empty.
+	 * Only valid once the request is ready.
+	 */
+	Path path;
+
+	const coord::phys3 start;
+	const coord::phys3 end;
+	const coord::phys_t radius;
+	const terrain_mask_t allowed_terrain;
+	const TerrainObject *const ignore;
+
+private:
+	bool ready;
+
+	friend class PathService;
+};
+
+
+/**
+ * Runs path searches on the worker threads of the job manager.
+ *
+ * Requests are queued and a limited number of them is started every
+ * tick, the ones closest to the focus (e.g. the camera) first.
+ * Each search works on a snapshot of the terrain around its route,
+ * the result is delivered in the game thread by the job callbacks.
+ */
+class PathService {
+public:
+	PathService(job::JobManager *job_manager,
+	            size_t searches_per_tick=default_searches_per_tick);
+
+	/**
+	 * Terrain the searches run on.
+	 */
+	void set_terrain(std::shared_ptr<Terrain> terrain);
+
+	/**
+	 * Position whose surroundings are served first.
+	 */
+	void set_focus(const coord::phys3 &focus);
+
+	/**
+	 * Queue a request, it stays pending until the next update.
+	 */
+	void request(const std::shared_ptr<PathRequest> &request);
+
+	/**
+	 * Start the searches of this tick, must be called in the game thread.
+	 */
+	void update();
+
+	/**
+	 * Number of queued requests that were not started yet.
+	 */
+	size_t pending() const;
+
+private:
+	/**
+	 * Snapshot the terrain and enqueue the search job.
+	 */
+	void start(const std::shared_ptr<PathRequest> &request);
+
+	job::JobManager *job_manager;
+	size_t searches_per_tick;
+
+	std::weak_ptr<Terrain> terrain;
+	coord::phys3 focus;
+
+	std::vector<std::weak_ptr<PathRequest>> queue;
+};
+
+}} // namespace openage::path
@@ -0,0 +1,320 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "search_context.h"
+
+#include <cmath>
+
+#include "../util/compiler.h"
+
+
+namespace openage {
+namespace path {
+
+/**
+ * Initial number of slots in the visited table, must be a power of two.
+ */
+constexpr size_t initial_table_size = 1024;
+
+
+SearchContext::SearchContext()
+	:
+	table(initial_table_size, slot{0, no_search_node, 0}),
+	stamp{1},
+	table_used{0},
+	heap_root{no_search_node},
+	origin{0, 0, 0} {}
+
+
+void SearchContext::reset(const coord::phys3 &start) {
+	this->nodes.clear();
+	this->heap_root = no_search_node;
+	this->origin = start;
+	this->table_used = 0;
+
+	this->stamp += 1;
+	if (unlikely(this->stamp == 0)) {
+		// stamps wrapped around, old entries would become valid again.
+		for (auto &entry : this->table) {
+			entry.stamp = 0;
+		}
+		this->stamp = 1;
+	}
+}
+
+
+search_node_id SearchContext::create(const coord::phys3 &pos, search_node_id prev) {
+	SearchNode node;
+	node.position       = pos;
+	node.dir_ne         = 0.0f;
+	node.dir_se         = 0.0f;
+	node.future_cost    = 0.0f;
+	node.past_cost      = 0.0f;
+	node.heuristic_cost = 0.0f;
+	node.factor         = 1.0f;
+	node.predecessor    = prev;
+	node.was_best       = false;
+	node.first_child    = no_search_node;
+	node.prev_sibling   = no_search_node;
+	node.next_sibling   = no_search_node;
+	node.parent         = no_search_node;
+
+	// same direction and turning factor as the Node constructor
+	if (prev != no_search_node) {
+		const SearchNode &prev_node = this->nodes[prev];
+		cost_t dx = node.position.ne - prev_node.position.ne;
+		cost_t dy = node.position.se - prev_node.position.se;
+		cost_t hyp = std::sqrt(dx * dx + dy * dy);
+		node.dir_ne = dx / hyp;
+		node.dir_se = dy / hyp;
+		cost_t similarity = node.dir_ne * prev_node.dir_ne + node.dir_se * prev_node.dir_se;
+		node.factor += (1 - similarity);
+	}
+
+	this->nodes.push_back(node);
+	return this->nodes.size() - 1;
+}
+
+
+void SearchContext::discard(search_node_id id) {
+	ENSURE(id == this->nodes.size() - 1, "only the newest node can be discarded");
+	this->nodes.pop_back();
+}
+
+
+uint64_t SearchContext::grid_key(const coord::phys3 &pos) const {
+	auto ne = static_cast<uint32_t>((pos.ne - this->origin.ne) / path_grid_size);
+	auto se = static_cast<uint32_t>((pos.se - this->origin.se) / path_grid_size);
+	return (static_cast<uint64_t>(ne) << 32) | se;
+}
+
+
+size_t SearchContext::slot_of(uint64_t key) const {
+	// fibonacci hashing, the grid keys are small and dense
+	uint64_t mixed = key * 0x9e3779b97f4a7c15ull;
+	return (mixed ^ (mixed >> 32)) & (this->table.size() - 1);
+}
+
+
+void SearchContext::visit(search_node_id id) {
+	if (unlikely((this->table_used + 1) * 2 > this->table.size())) {
+		this->grow_table();
+	}
+
+	uint64_t key = this->grid_key(this->nodes[id].position);
+	size_t mask = this->table.size() - 1;
+	for (size_t index = this->slot_of(key);; index = (index + 1) & mask) {
+		slot &entry = this->table[index];
+		if (entry.stamp != this->stamp) {
+			entry = slot{key, id, this->stamp};
+			this->table_used += 1;
+			return;
+		}
+		if (entry.key == key) {
+			entry.node = id;
+			return;
+		}
+	}
+}
+
+
+search_node_id SearchContext::find(const coord::phys3 &pos) const {
+	uint64_t key = this->grid_key(pos);
+	size_t mask = this->table.size() - 1;
+	for (size_t index = this->slot_of(key);; index = (index + 1) & mask) {
+		const slot &entry = this->table[index];
+		if (entry.stamp != this->stamp) {
+			return no_search_node;
+		}
+		if (entry.key == key) {
+			return entry.node;
+		}
+	}
+}
+
+
+void SearchContext::grow_table() {
+	std::vector<slot> old_table{this->table.size() * 2, slot{0, no_search_node, 0}};
+	std::swap(old_table, this->table);
+
+	uint32_t old_stamp = this->stamp;
+	this->stamp = 1;
+	this->table_used = 0;
+
+	size_t mask = this->table.size() - 1;
+	for (const slot &old_entry : old_table) {
+		if (old_entry.stamp != old_stamp) {
+			continue;
+		}
+		size_t index = this->slot_of(old_entry.key);
+		while (this->table[index].stamp == this->stamp) {
+			index = (index + 1) & mask;
+		}
+		this->table[index] = slot{old_entry.key, old_entry.node, this->stamp};
+		this->table_used += 1;
+	}
+}
+
+
+cost_t SearchContext::cost(search_node_id from, search_node_id to) const {
+	const SearchNode &a = this->nodes[from];
+	const SearchNode &b = this->nodes[to];
+	cost_t dx = a.position.ne - b.position.ne;
+	cost_t dy = a.position.se - b.position.se;
+	return std::sqrt(dx * dx + dy * dy) * b.factor * a.factor;
+}
+
+
+/*
+ * The open list is the pairing heap of datastructure::PairingHeap,
+ * with the node links stored in the pool instead of allocated heap nodes.
+ * Linking is done in the same order, so ties are broken identically.
+ */
+
+search_node_id SearchContext::link(search_node_id a, search_node_id b) {
+	search_node_id root, child;
+	if (this->nodes[a].future_cost < this->nodes[b].future_cost) {
+		root  = a;
+		child = b;
+	}
+	else {
+		root  = b;
+		child = a;
+	}
+
+	SearchNode &root_node  = this->nodes[root];
+	SearchNode &child_node = this->nodes[child];
+	child_node.prev_sibling = no_search_node;
+	child_node.next_sibling = root_node.first_child;
+	if (root_node.first_child != no_search_node) {
+		this->nodes[root_node.first_child].prev_sibling = child;
+	}
+	root_node.first_child = child;
+	child_node.parent = root;
+
+	return root;
+}
+
+
+void SearchContext::loosen(search_node_id id) {
+	SearchNode &node = this->nodes[id];
+	if (node.parent == no_search_node) {
+		return;
+	}
+
+	SearchNode &parent = this->nodes[node.parent];
+	if (parent.first_child == id) {
+		parent.first_child = node.next_sibling;
+	}
+	if (node.prev_sibling != no_search_node) {
+		this->nodes[node.prev_sibling].next_sibling = node.next_sibling;
+	}
+	if (node.next_sibling != no_search_node) {
+		this->nodes[node.next_sibling].prev_sibling = node.prev_sibling;
+	}
+
+	node.prev_sibling = no_search_node;
+	node.next_sibling = no_search_node;
+	node.parent = no_search_node;
+}
+
+
+void SearchContext::push(search_node_id id) {
+	if (unlikely(this->heap_root == no_search_node)) {
+		this->heap_root = id;
+	} else {
+		this->heap_root = this->link(this->heap_root, id);
+	}
+}
+
+
+search_node_id SearchContext::pop() {
+	ENSURE(this->heap_root != no_search_node, "Can't pop an empty heap!");
+
+	// remove tree root, it's the minimum.
+	search_node_id ret = this->heap_root;
+	search_node_id current_sibling = this->nodes[ret].first_child;
+	this->nodes[ret].first_child = no_search_node;
+	this->heap_root = no_search_node;
+
+	// link root children pairwise, last node may be alone
+	search_node_id previous_pair = no_search_node;
+
+	while (current_sibling != no_search_node) {
+		search_node_id link0 = current_sibling;
+		search_node_id link1 = this->nodes[link0].next_sibling;
+		search_node_id pair;
+
+		if (link1 != no_search_node) {
+			current_sibling = this->nodes[link1].next_sibling;
+			pair = this->link(link0, link1);
+		}
+		else {
+			current_sibling = no_search_node;
+			pair = link0;
+		}
+
+		SearchNode &pair_node = this->nodes[pair];
+		pair_node.parent = no_search_node;
+		pair_node.next_sibling = no_search_node;
+		pair_node.prev_sibling = previous_pair;
+		if (previous_pair != no_search_node) {
+			this->nodes[previous_pair].next_sibling = pair;
+		}
+		previous_pair = pair;
+	}
+
+	// then link remaining trees to the last one, from right to left
+	if (previous_pair != no_search_node) {
+		search_node_id root = previous_pair;
+		search_node_id current = this->nodes[root].prev_sibling;
+		this->nodes[root].prev_sibling = no_search_node;
+
+		while (current != no_search_node) {
+			search_node_id next = this->nodes[current].prev_sibling;
+			this->nodes[current].prev_sibling = no_search_node;
+			this->nodes[current].next_sibling = no_search_node;
+			this->nodes[root].next_sibling = no_search_node;
+			root = this->link(root, current);
+			current = next;
+		}
+		this->heap_root = root;
+	}
+
+	return ret;
+}
+
+
+void SearchContext::update(search_node_id id) {
+	// decreasing the root node won't change it.
+	if (likely(id != this->heap_root)) {
+		this->loosen(id);
+		this->heap_root = this->link(id, this->heap_root);
+	}
+}
+
+
+Path SearchContext::generate_backtrace(search_node_id id) const {
+	std::vector<Node> waypoints;
+
+	for (search_node_id current = id;
+	     current != no_search_node;
+	     current = this->nodes[current].predecessor) {
+
+		const SearchNode &node = this->nodes[current];
+		waypoints.emplace_back(node.position, nullptr);
+
+		Node &waypoint = waypoints.back();
+		waypoint.dir_ne         = node.dir_ne;
+		waypoint.dir_se         = node.dir_se;
+		waypoint.future_cost    = node.future_cost;
+		waypoint.past_cost      = node.past_cost;
+		waypoint.heuristic_cost = node.heuristic_cost;
+		waypoint.was_best       = node.was_best;
+		waypoint.factor         = node.factor;
+	}
+	waypoints.pop_back(); // remove start
+
+	return {waypoints};
+}
+
+}} // namespace openage::path
@@ -0,0 +1,197 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "path.h"
+
+
+namespace openage {
+namespace path {
+
+/**
+ * Index of a node in the pool of a SearchContext.
+ */
+using search_node_id = uint32_t;
+
+/**
+ * Marks the absence of a node, e.g. no predecessor.
+ */
+constexpr search_node_id no_search_node = UINT32_MAX;
+
+
+/**
+ * Counters a search can fill, e.g. to compare search algorithms.
+ */
+struct search_statistics {
+	/**
+	 * Number of nodes taken from the open list.
+	 */
+	size_t expanded = 0;
+};
+
+
+/**
+ * Graph node as stored in a SearchContext.
+ *
+ * Carries the same values as Node, but references other nodes
+ * by their pool index and embeds the links of the open list heap.
+ */
+struct SearchNode {
+	coord::phys3 position;
+	cost_t dir_ne, dir_se;
+	cost_t future_cost;
+	cost_t past_cost;
+	cost_t heuristic_cost;
+	cost_t factor;
+
+	search_node_id predecessor;
+
+	/**
+	 * Set when the node was popped from the open list.
+	 */
+	bool was_best;
+
+	/**
+	 * Pairing heap links of the open list.
+	 */
+	search_node_id first_child;
+	search_node_id prev_sibling;
+	search_node_id next_sibling;
+	search_node_id parent;
+};
+
+
+/**
+ * Reusable storage for A* queries.
+ *
+ * Holds the node pool, the table of visited grid points and the
+ * open list. Everything is reset in O(1) between queries and keeps its
+ * capacity, so after warm-up a search does no heap allocations apart
+ * from the resulting Path.
+ *
+ * A context must only be used by one search at a time,
+ * a_star uses one instance per thread.
+ */
+class SearchContext {
+public:
+	SearchContext();
+
+	/**
+	 * Forget all nodes and start a search around the given position.
+	 * All positions of the search must be on its path grid.
+	 */
+	void reset(const coord::phys3 &start);
+
+	/**
+	 * Create a node reached from prev.
+	 * Direction and turning factor are calculated like in Node.
+	 * The node is not registered as visited yet.
+	 */
+	search_node_id create(const coord::phys3 &pos, search_node_id prev);
+
+	/**
+	 * Drop the most recently created node again.
+	 * Only allowed if it was neither visited nor pushed.
+	 */
+	void discard(search_node_id id);
+
+	/**
+	 * Access a node in the pool.
+	 */
+	SearchNode &get(search_node_id id) {
+		return this->nodes[id];
+	}
+
+	/**
+	 * Register the node as visited at its position.
+	 */
+	void visit(search_node_id id);
+
+	/**
+	 * Look up the visited node at a position.
+	 * @returns no_search_node if the position was not visited yet.
+	 */
+	search_node_id find(const coord::phys3 &pos) const;
+
+	/**
+	 * Movement cost between two nodes, as Node::cost_to.
+	 */
+	cost_t cost(search_node_id from, search_node_id to) const;
+
+	/**
+	 * Add a node to the open list.
+	 */
+	void push(search_node_id id);
+
+	/**
+	 * Remove and return the cheapest node of the open list.
+	 */
+	search_node_id pop();
+
+	/**
+	 * Restore the open list order after the future cost of a node decreased.
+	 */
+	void update(search_node_id id);
+
+	/**
+	 * @returns whether the open list has no more nodes.
+	 */
+	bool empty() const {
+		return this->heap_root == no_search_node;
+	}
+
+	/**
+	 * Number of nodes created since the last reset.
+	 */
+	size_t size() const {
+		return this->nodes.size();
+	}
+
+	/**
+	 * Create the waypoints from the given node back to the search start.
+	 * The start is excluded, as in Node::generate_backtrace.
+	 */
+	Path generate_backtrace(search_node_id id) const;
+
+private:
+	struct slot {
+		uint64_t key;
+		search_node_id node;
+		uint32_t stamp;
+	};
+
+	/**
+	 * Path grid coordinates of a position relative to the origin.
+	 */
+	uint64_t grid_key(const coord::phys3 &pos) const;
+
+	size_t slot_of(uint64_t key) const;
+
+	void grow_table();
+
+	search_node_id link(search_node_id a, search_node_id b);
+	void loosen(search_node_id id);
+
+	std::vector<SearchNode> nodes;
+
+	/**
+	 * Open addressing table of visited nodes, linear probing.
+	 * A slot is occupied if its stamp equals the current one,
+	 * so a reset only has to advance the stamp.
+	 */
+	std::vector<slot> table;
+	uint32_t stamp;
+	size_t table_used;
+
+	search_node_id heap_root;
+
+	coord::phys3 origin;
+};
+
+}} // namespace openage::path
@@ -1,10 +1,24 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
+#include <cstdlib>
+
+#include "../job/job_manager.h"
 #include "../log/log.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_chunk.h"
+#include "../terrain/terrain_object.h"
 #include "../testing/testing.h"
+#include "../unit/unit.h"
+#include "../unit/unit_container.h"
 
+#include "a_star.h"
+#include "flow_field.h"
 #include "heuristics.h"
+#include "hierarchy.h"
 #include "path.h"
+#include "path_cache.h"
+#include "path_service.h"
+#include "search_context.h"
 
 namespace openage {
 namespace path {
@@ -326,6 +340,501 @@ void node_passable_line_0() {
 	(path::passable_line(n0, n1, path::tests::sometimes_passable, 50) == false) or TESTFAIL;
 }
 
+/**
+ * The former A* implementation, allocating one shared node per grid point.
+ * Kept as reference for the search context variant in a_star.cpp.
+ */
+Path a_star_reference(coord::phys3 start,
+                      std::function<bool(const coord::phys3 &)> valid_end,
+                      std::function<cost_t(const coord::phys3 &)> heuristic,
+                      std::function<bool(const coord::phys3 &)> passable) {
+	heap_t node_candidates;
+	nodemap_t visited_tiles;
+
+	node_pt start_node = std::make_shared<Node>(start, nullptr, .0f, heuristic(start));
+	visited_tiles[start_node->position] = start_node;
+	node_candidates.push(start_node);
+
+	start_node->heap_node = node_candidates.push(start_node);
+
+	node_pt closest_node = start_node;
+
+	while (not node_candidates.empty()) {
+		node_pt best_candidate = node_candidates.pop();
+
+		best_candidate->was_best = true;
+
+		if (valid_end(best_candidate->position)) {
+			return best_candidate->generate_backtrace();
+		}
+
+		if (best_candidate->heuristic_cost < closest_node->heuristic_cost) {
+			closest_node = best_candidate;
+		}
+
+		for (node_pt neighbor : best_candidate->get_neighbors(visited_tiles)) {
+			if (neighbor->was_best) {
+				continue;
+			}
+			if (not passable_line(best_candidate, neighbor, passable)) {
+				continue;
+			}
+
+			bool not_visited = (visited_tiles.count(neighbor->position) == 0);
+			cost_t new_past_cost = best_candidate->past_cost + best_candidate->cost_to(*neighbor);
+
+			if (not_visited or new_past_cost < neighbor->past_cost) {
+				if (not_visited) {
+					neighbor->heuristic_cost = heuristic(neighbor->position);
+				}
+				if (neighbor->heuristic_cost > closest_node->heuristic_cost * 3) {
+					continue;
+				}
+
+				neighbor->past_cost        = new_past_cost;
+				neighbor->future_cost      = neighbor->past_cost + neighbor->heuristic_cost;
+				neighbor->path_predecessor = best_candidate;
+
+				if (not_visited) {
+					neighbor->heap_node = node_candidates.push(neighbor);
+					visited_tiles[neighbor->position] = neighbor;
+				} else {
+					node_candidates.update(neighbor->heap_node);
+				}
+			}
+		}
+	}
+
+	return closest_node->generate_backtrace();
+}
+
+
+/**
+ * A search problem for comparing and benchmarking the A* implementations.
+ */
+struct search_scenario {
+	coord::phys3 start;
+	std::function<bool(const coord::phys3 &)> valid_end;
+	std::function<cost_t(const coord::phys3 &)> heuristic;
+	std::function<bool(const coord::phys3 &)> passable;
+};
+
+constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+
+/**
+ * Wall along ne = 6 tiles with a gap at se = 8 tiles.
+ */
+bool wall_passable(const coord::phys3 &pos) {
+	return pos.ne < 6 * tile or pos.ne >= 7 * tile or
+	       (pos.se >= 8 * tile and pos.se < 9 * tile);
+}
+
+/**
+ * Closed box around the tile at (12, 3).
+ */
+bool boxed_passable(const coord::phys3 &pos) {
+	bool in_box = (pos.ne >= 10 * tile and pos.ne < 15 * tile and
+	               pos.se >= 1 * tile and pos.se < 6 * tile);
+	bool in_room = (pos.ne >= 11 * tile and pos.ne < 14 * tile and
+	                pos.se >= 2 * tile and pos.se < 5 * tile);
+	return not in_box or in_room;
+}
+
+/**
+ * Walls along every 4th ne tile with gaps at every 5th se tile,
+ * and single blocked tiles in between.
+ */
+bool cluttered_passable(const coord::phys3 &pos) {
+	if (pos.ne < 0 or pos.se < 0) {
+		return true;
+	}
+	coord::phys_t ne = pos.ne / tile;
+	coord::phys_t se = pos.se / tile;
+	bool in_wall = (ne % 4 == 2 and se % 5 != 0);
+	bool in_clutter = (se % 4 == 3 and ne % 5 == 1);
+	return not in_wall and not in_clutter;
+}
+
+std::vector<search_scenario> search_scenarios() {
+	auto to = [](coord::phys3 end) {
+		return std::make_pair(
+			std::function<bool(const coord::phys3 &)>{[end](const coord::phys3 &pos) {
+				return euclidean_squared_cost(pos, end) < path_grid_size_squared;
+			}},
+			std::function<cost_t(const coord::phys3 &)>{[end](const coord::phys3 &pos) {
+				return euclidean_cost(pos, end);
+			}}
+		);
+	};
+	auto zero = [](const coord::phys3 &) -> cost_t { return .0f; };
+
+	coord::phys3 start{tile / 2, tile / 2, 0};
+	coord::phys3 open_end{20 * tile, 10 * tile, 0};
+	coord::phys3 wall_end{12 * tile, 2 * tile, 0};
+	coord::phys3 boxed_end{12 * tile + tile / 2, 3 * tile + tile / 2, 0};
+	coord::phys3 cluttered_end{21 * tile + tile / 2, 13 * tile + tile / 2, 0};
+
+	std::vector<search_scenario> ret;
+	ret.push_back({start, to(open_end).first, to(open_end).second, always_passable});
+	ret.push_back({start, to(wall_end).first, to(wall_end).second, wall_passable});
+	ret.push_back({start, to(boxed_end).first, to(boxed_end).second, boxed_passable});
+	ret.push_back({start, to(cluttered_end).first, to(cluttered_end).second, cluttered_passable});
+	ret.push_back({
+		start,
+		[](const coord::phys3 &pos) { return pos.ne > 8 * tile and pos.se > 2 * tile; },
+		zero,
+		wall_passable
+	});
+	return ret;
+}
+
+/**
+ * Checks that the search context based A* finds
+ * the same paths as the reference implementation.
+ */
+void a_star_0() {
+	for (auto &scenario : search_scenarios()) {
+		Path expected = a_star_reference(scenario.start, scenario.valid_end,
+		                                 scenario.heuristic, scenario.passable);
+
+		// twice, the second run reuses the warm search context
+		for (int i = 0; i < 2; i++) {
+			Path result = a_star(scenario.start, scenario.valid_end,
+			                     scenario.heuristic, scenario.passable);
+
+			TESTEQUALS(result.waypoints.size(), expected.waypoints.size());
+			for (size_t w = 0; w < expected.waypoints.size(); w++) {
+				(result.waypoints[w] == expected.waypoints[w]) or TESTFAIL;
+				TESTEQUALS(result.waypoints[w].past_cost, expected.waypoints[w].past_cost);
+				TESTEQUALS(result.waypoints[w].factor, expected.waypoints[w].factor);
+			}
+		}
+	}
+}
+
+/**
+ * Length of a path from the start over all waypoints.
+ */
+cost_t path_length(const coord::phys3 &start, const Path &path) {
+	cost_t length = 0;
+	coord::phys3 from = start;
+	for (auto it = path.waypoints.rbegin(); it != path.waypoints.rend(); ++it) {
+		length += euclidean_cost(from, it->position);
+		from = it->position;
+	}
+	return length;
+}
+
+/**
+ * Checks that jump point search reaches the same ends as A*
+ * on paths of about the same length, with fewer expanded nodes.
+ */
+void jump_point_0() {
+	std::vector<search_scenario> scenarios = search_scenarios();
+	for (size_t i = 0; i < scenarios.size(); i++) {
+		search_scenario &scenario = scenarios[i];
+
+		search_statistics a_star_stats, jump_stats;
+		Path expected = a_star(scenario.start, scenario.valid_end, scenario.heuristic,
+		                       scenario.passable, true, &a_star_stats);
+		Path result = jump_point_search(scenario.start, scenario.valid_end, scenario.heuristic,
+		                                scenario.passable, true, &jump_stats);
+
+		bool expected_done = (not expected.waypoints.empty() and
+		                      scenario.valid_end(expected.waypoints.front().position));
+		bool result_done = (not result.waypoints.empty() and
+		                    scenario.valid_end(result.waypoints.front().position));
+		TESTEQUALS(result_done, expected_done);
+
+		if (expected_done) {
+			(path_length(scenario.start, result) <= path_length(scenario.start, expected) * 1.05f) or TESTFAIL;
+		}
+
+		// consecutive jump points are connected by straight or diagonal lines
+		coord::phys3 from = scenario.start;
+		for (auto it = result.waypoints.rbegin(); it != result.waypoints.rend(); ++it) {
+			coord::phys3_delta d = it->position - from;
+			(d.ne == 0 or d.se == 0 or std::abs(d.ne) == std::abs(d.se)) or TESTFAIL;
+			from = it->position;
+		}
+
+		(jump_stats.expanded <= a_star_stats.expanded) or TESTFAIL;
+	}
+
+	// on open ground, jumps replace almost all expansions
+	search_statistics a_star_stats, jump_stats;
+	search_scenario &open = scenarios[0];
+	a_star(open.start, open.valid_end, open.heuristic, open.passable, true, &a_star_stats);
+	jump_point_search(open.start, open.valid_end, open.heuristic, open.passable, true, &jump_stats);
+	(jump_stats.expanded * 10 < a_star_stats.expanded) or TESTFAIL;
+
+	// selectable in the search entry points
+	Path nearest = find_nearest(scenarios[3].start, scenarios[3].valid_end,
+	                            scenarios[3].passable, search_method::jump_point);
+	(not nearest.waypoints.empty() and
+	 scenarios[3].valid_end(nearest.waypoints.front().position)) or TESTFAIL;
+}
+
+/**
+ * Tests the route search on the chunk graphs and their invalidation.
+ * The terrain is split by water along ne = 20, with a gap at se = 40.
+ */
+void hierarchy_0() {
+	constexpr coord::tile_t size = 48;
+	constexpr terrain_t land = 0, water = 1;
+
+	std::vector<int> data(size * size, land);
+	for (coord::tile_t se = 0; se < size; se++) {
+		if (se != 40) {
+			data[20 * size + se] = water;
+		}
+	}
+
+	Terrain terrain{nullptr, true};
+	terrain.fill(data.data(), coord::tile_delta{size, size});
+
+	Hierarchy &hierarchy = terrain.get_path_hierarchy(~(terrain_mask_t{1} << water));
+
+	// passability bitmaps
+	hierarchy.tile_passable(coord::tile{19, 2}) or TESTFAIL;
+	(not hierarchy.tile_passable(coord::tile{20, 2})) or TESTFAIL;
+	hierarchy.tile_passable(coord::tile{20, 40}) or TESTFAIL;
+	(not hierarchy.tile_passable(coord::tile{-1, 2})) or TESTFAIL;
+	TESTEQUALS(hierarchy.get_passability(coord::chunk{1, 0}).tiles.count(),
+	           coord::settings::tiles_per_chunk * (coord::settings::tiles_per_chunk - 1));
+
+	std::vector<coord::tile> route;
+	hierarchy.find_route(coord::tile{2, 2}, coord::tile{40, 2}, route) or TESTFAIL;
+
+	// the route must pass the gap
+	bool through_gap = false;
+	for (auto &portal : route) {
+		if (portal.ne >= 16 and portal.ne < 32 and portal.se >= 32) {
+			through_gap = true;
+		}
+	}
+	through_gap or TESTFAIL;
+
+	// graphs are cached
+	size_t rebuilds = hierarchy.rebuild_count;
+	hierarchy.find_route(coord::tile{3, 2}, coord::tile{40, 3}, route) or TESTFAIL;
+	TESTEQUALS(hierarchy.rebuild_count, rebuilds);
+
+	// closing the gap disconnects both sides
+	terrain.get_data(coord::tile{20, 40}).set_terrain_id(water);
+	terrain.chunk_changed(coord::tile{20, 40}.to_chunk());
+	(not hierarchy.tile_passable(coord::tile{20, 40})) or TESTFAIL;
+	(not hierarchy.find_route(coord::tile{2, 2}, coord::tile{40, 2}, route)) or TESTFAIL;
+	(hierarchy.rebuild_count > rebuilds) or TESTFAIL;
+
+	// but the same side is still reachable
+	hierarchy.find_route(coord::tile{2, 2}, coord::tile{2, 45}, route) or TESTFAIL;
+}
+
+/**
+ * The passability bitmaps follow buildings that are placed and removed.
+ */
+void hierarchy_1() {
+	constexpr coord::tile_t size = 32;
+
+	auto terrain = std::make_shared<Terrain>(nullptr, true);
+	std::vector<int> data(size * size, 0);
+	terrain->fill(data.data(), coord::tile_delta{size, size});
+
+	Hierarchy &hierarchy = terrain->get_path_hierarchy(~terrain_mask_t{0});
+
+	UnitContainer container;
+	Unit *building = container.new_unit().get();
+	building->make_location<SquareObject>(coord::tile_delta{2, 2}, nullptr);
+
+	coord::tile start{15, 7};
+	coord::phys3 position = start.to_tile3().to_phys3();
+	building->location->place(terrain, position, object_state::placed) or TESTFAIL;
+
+	for (coord::tile_t ne = 0; ne < 2; ne++) {
+		for (coord::tile_t se = 0; se < 2; se++) {
+			(not hierarchy.tile_passable(start + coord::tile_delta{ne, se})) or TESTFAIL;
+		}
+	}
+
+	building->location->remove();
+
+	for (coord::tile_t ne = 0; ne < 2; ne++) {
+		for (coord::tile_t se = 0; se < 2; se++) {
+			hierarchy.tile_passable(start + coord::tile_delta{ne, se}) or TESTFAIL;
+		}
+	}
+}
+
+/**
+ * Flow field around a wall with a single gap.
+ */
+void flow_field_0() {
+	constexpr coord::tile_t size = 48;
+	constexpr terrain_t land = 0, water = 1;
+
+	std::vector<int> data(size * size, land);
+	for (coord::tile_t se = 0; se < size; se++) {
+		if (se != 40) {
+			data[20 * size + se] = water;
+		}
+	}
+
+	Terrain terrain{nullptr, true};
+	terrain.fill(data.data(), coord::tile_delta{size, size});
+
+	Hierarchy &hierarchy = terrain.get_path_hierarchy(~(terrain_mask_t{1} << water));
+	coord::tile target{40, 2};
+	FlowField field{hierarchy, target, coord::chunk{0, 0}, coord::chunk{2, 2}};
+
+	field.covers(coord::tile{47, 47}) or TESTFAIL;
+	(not field.covers(coord::tile{48, 0})) or TESTFAIL;
+	(not field.reachable(coord::tile{20, 2})) or TESTFAIL;
+	TESTEQUALS(field.direction(target), -1);
+	TESTEQUALS(field.distance(target), 0);
+
+	// the other side is only reachable through the gap
+	(field.distance(coord::tile{2, 2}) > 2 * (40 - 2)) or TESTFAIL;
+
+	// following the directions passes the gap and ends at the target
+	coord::phys3 start = coord::tile{2, 2}.to_tile3().to_phys3(phys_half_tile);
+	coord::phys3 end = target.to_tile3().to_phys3(phys_half_tile);
+	Path path = field.follow(start, end);
+	(not path.waypoints.empty()) or TESTFAIL;
+	(path.waypoints.front().position == end) or TESTFAIL;
+
+	bool through_gap = false;
+	for (auto &waypoint : path.waypoints) {
+		coord::tile pos = waypoint.position.to_tile3().to_tile();
+		hierarchy.tile_passable(pos) or TESTFAIL;
+		if (pos.ne >= 19 and pos.ne <= 21 and pos.se >= 39) {
+			through_gap = true;
+		}
+	}
+	through_gap or TESTFAIL;
+}
+
+/**
+ * Background path search around a wall with a single gap.
+ */
+void path_service_0() {
+	constexpr coord::tile_t size = 48;
+	constexpr terrain_t land = 0, water = 1;
+
+	std::vector<int> data(size * size, land);
+	for (coord::tile_t se = 0; se < size; se++) {
+		if (se != 40) {
+			data[20 * size + se] = water;
+		}
+	}
+
+	auto terrain = std::make_shared<Terrain>(nullptr, true);
+	terrain->fill(data.data(), coord::tile_delta{size, size});
+
+	job::JobManager manager{2};
+	manager.start();
+
+	PathService service{&manager, 1};
+	service.set_terrain(terrain);
+
+	terrain_mask_t allowed = ~(terrain_mask_t{1} << water);
+	coord::phys3 start = coord::tile{2, 2}.to_tile3().to_phys3(phys_half_tile);
+	coord::phys3 end = coord::tile{40, 2}.to_tile3().to_phys3(phys_half_tile);
+	coord::phys_t radius = coord::settings::phys_per_tile / 4;
+
+	auto near = std::make_shared<PathRequest>(start, end, radius, allowed);
+	auto far = std::make_shared<PathRequest>(end, start, radius, allowed);
+	auto dropped = std::make_shared<PathRequest>(start, end, radius, allowed);
+	service.request(far);
+	service.request(dropped);
+	service.request(near);
+	dropped.reset();
+
+	// one search per tick, the one closest to the focus first
+	service.set_focus(start);
+	service.update();
+	TESTEQUALS(service.pending(), 1);
+	service.update();
+	TESTEQUALS(service.pending(), 0);
+
+	while (not near->is_ready() or not far->is_ready()) {
+		manager.execute_callbacks();
+	}
+	manager.stop();
+
+	for (auto &request : {near, far}) {
+		const Path &path = request->path;
+		(not path.waypoints.empty()) or TESTFAIL;
+		(euclidean_cost(path.waypoints.front().position, request->end) < path_grid_size) or TESTFAIL;
+
+		// the only way across is the gap
+		bool through_gap = false;
+		for (auto &waypoint : path.waypoints) {
+			coord::tile pos = waypoint.position.to_tile3().to_tile();
+			if (pos.ne == 20) {
+				TESTEQUALS(pos.se, 40);
+				through_gap = true;
+			}
+		}
+		through_gap or TESTFAIL;
+	}
+}
+
+/**
+ * Path cache lookups, invalidation and path smoothing.
+ */
+void path_cache_0() {
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+	auto passable = [](const coord::phys3 &) -> bool { return true; };
+
+	// a straight line of nodes across two chunks, end first
+	std::vector<Node> nodes;
+	for (coord::phys_t ne = 20 * tile; ne >= 0; ne -= path_grid_size) {
+		nodes.emplace_back(coord::phys3{ne, tile / 2, 0}, nullptr);
+	}
+	Path straight = smooth(Path{nodes}, passable, nodes.size());
+	TESTEQUALS(straight.waypoints.size(), 2);
+	(straight.waypoints.front().position == nodes.front().position) or TESTFAIL;
+	(straight.waypoints.back().position == nodes.back().position) or TESTFAIL;
+
+	// waypoints are kept at most max_skip nodes apart
+	TESTEQUALS(smooth(Path{nodes}, passable, 32).waypoints.size(),
+	           (nodes.size() - 2) / 32 + 2);
+
+	PathCache cache;
+	path_key key{coord::tile{0, 0}, nullptr, coord::tile{20, 0}, 0, tile / 2, 1};
+	path_key other = key;
+	other.start = coord::tile{1, 0};
+
+	Path result;
+	(not cache.lookup(key, result)) or TESTFAIL;
+	cache.store(key, straight);
+	cache.store(other, straight);
+	cache.lookup(key, result) or TESTFAIL;
+	TESTEQUALS(result.waypoints.size(), 2);
+	TESTEQUALS(cache.hits, 1);
+	TESTEQUALS(cache.misses, 1);
+
+	// the line crosses chunk 1 between the waypoints
+	cache.invalidate(coord::chunk{1, 0});
+	TESTEQUALS(cache.size(), 0);
+	(not cache.lookup(other, result)) or TESTFAIL;
+
+	// other chunks don't affect the path
+	cache.store(key, straight);
+	cache.invalidate(coord::chunk{0, 1});
+	cache.lookup(key, result) or TESTFAIL;
+
+	// a dropped path leaves no key behind in its other chunks,
+	// which would drop the next path stored for it
+	Path inside{std::vector<Node>{nodes.front(), Node{coord::phys3{18 * tile, tile / 2, 0}, nullptr}}};
+	cache.invalidate(coord::chunk{1, 0});
+	cache.store(key, inside);
+	cache.invalidate(coord::chunk{0, 0});
+	cache.lookup(key, result) or TESTFAIL;
+	TESTEQUALS(cache.size(), 1);
+}
+
 /**
  * Top level node test.
  */
@@ -336,6 +845,60 @@ void path_node() {
 	node_generate_backtrace_0();
 	node_get_neighbors_0();
 	node_passable_line_0();
+	a_star_0();
+	jump_point_0();
+	hierarchy_0();
+	hierarchy_1();
+	flow_field_0();
+	path_service_0();
+	path_cache_0();
+}
+
+/**
+ * Runs the search scenarios with the search context based A*.
+ */
+void benchmark_a_star() {
+	static const std::vector<search_scenario> scenarios = search_scenarios();
+	for (auto &scenario : scenarios) {
+		a_star(scenario.start, scenario.valid_end, scenario.heuristic, scenario.passable);
+	}
+}
+
+/**
+ * Runs the search scenarios with jump point search,
+ * for comparison with benchmark_a_star.
+ * The expanded nodes of both are logged once.
+ */
+void benchmark_jump_point_search() {
+	static const std::vector<search_scenario> scenarios = search_scenarios();
+	static bool logged = false;
+	for (size_t i = 0; i < scenarios.size(); i++) {
+		const search_scenario &scenario = scenarios[i];
+		search_statistics stats;
+		jump_point_search(scenario.start, scenario.valid_end, scenario.heuristic,
+		                  scenario.passable, true, &stats);
+
+		if (not logged) {
+			search_statistics a_star_stats;
+			a_star(scenario.start, scenario.valid_end, scenario.heuristic,
+			       scenario.passable, true, &a_star_stats);
+			log::log(MSG(info) << "scenario " << i << ": "
+			         << a_star_stats.expanded << " nodes expanded by A*, "
+			         << stats.expanded << " by jump point search");
+		}
+	}
+	logged = true;
+}
+
+/**
+ * Runs the search scenarios with the reference A*,
+ * for comparison with benchmark_a_star.
+ */
+void benchmark_a_star_reference() {
+	static const std::vector<search_scenario> scenarios = search_scenarios();
+	for (auto &scenario : scenarios) {
+		a_star_reference(scenario.start, scenario.valid_end, scenario.heuristic, scenario.passable);
+	}
 }
 
 } // namespace tests
@@ -0,0 +1,266 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "object_index.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../coord/tile3.h"
+#include "../gamestate/player.h"
+#include "../unit/unit.h"
+#include "../unit/unit_type.h"
+#include "../util/misc.h"
+#include "terrain_object.h"
+
+namespace openage {
+
+bool object_filter::operator ()(const TerrainObject &obj) const {
+	if (this->owner and not this->owner->owns(obj.unit)) {
+		return false;
+	}
+	if (this->by_class and
+	    (obj.unit.unit_type == nullptr or obj.unit.unit_type->unit_class != this->unit_class)) {
+		return false;
+	}
+	return not this->accept or this->accept(obj);
+}
+
+
+ObjectIndex::ObjectIndex()
+	:
+	used_min{std::numeric_limits<coord::tile_t>::max(), std::numeric_limits<coord::tile_t>::max()},
+	used_max{std::numeric_limits<coord::tile_t>::min(), std::numeric_limits<coord::tile_t>::min()},
+	max_extent{0},
+	count{0},
+	empty_buckets{0} {}
+
+
+coord::tile ObjectIndex::bucket_of(const coord::tile &pos) const {
+	return coord::tile{
+		util::div(pos.ne, object_bucket_tiles),
+		util::div(pos.se, object_bucket_tiles)
+	};
+}
+
+
+void ObjectIndex::insert(TerrainObject *obj) {
+	coord::tile bucket = this->bucket_of(obj->pos.draw.to_tile3().to_tile());
+	auto it = this->buckets.find(bucket);
+	if (it == this->buckets.end()) {
+		it = this->buckets.emplace(bucket, std::vector<TerrainObject *>{}).first;
+	}
+	else if (it->second.empty()) {
+		this->empty_buckets -= 1;
+	}
+	it->second.push_back(obj);
+	this->count += 1;
+
+	this->used_min.ne = std::min(this->used_min.ne, bucket.ne);
+	this->used_min.se = std::min(this->used_min.se, bucket.se);
+	this->used_max.ne = std::max(this->used_max.ne, bucket.ne);
+	this->used_max.se = std::max(this->used_max.se, bucket.se);
+
+	coord::tile_delta size = obj->pos.end - obj->pos.start;
+	coord::phys_t extent = std::max(size.ne, size.se) * coord::settings::phys_per_tile;
+	this->max_extent = std::max(this->max_extent, extent);
+}
+
+
+void ObjectIndex::remove(TerrainObject *obj) {
+	coord::tile bucket = this->bucket_of(obj->pos.draw.to_tile3().to_tile());
+	auto it = this->buckets.find(bucket);
+	if (it == this->buckets.end()) {
+		return;
+	}
+
+	auto &objects = it->second;
+	auto position = std::find(std::begin(objects), std::end(objects), obj);
+	if (position == std::end(objects)) {
+		return;
+	}
+
+	// the order within a bucket doesn't matter
+	*position = objects.back();
+	objects.pop_back();
+	this->count -= 1;
+
+	if (objects.empty()) {
+		this->empty_buckets += 1;
+		if (this->empty_buckets > std::max(object_bucket_spare, this->buckets.size() / 2)) {
+			this->compact();
+		}
+	}
+}
+
+
+void ObjectIndex::compact() {
+	for (auto it = std::begin(this->buckets); it != std::end(this->buckets);) {
+		if (it->second.empty()) {
+			it = this->buckets.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	this->empty_buckets = 0;
+}
+
+
+size_t ObjectIndex::size() const {
+	return this->count;
+}
+
+
+template<typename F>
+void ObjectIndex::for_buckets(const coord::tile &min, const coord::tile &max, F f) const {
+	size_t area = (max.ne - min.ne + 1) * (max.se - min.se + 1);
+
+	// large areas on a sparse index: walk the used buckets instead
+	if (area > this->buckets.size()) {
+		for (auto &bucket : this->buckets) {
+			const coord::tile &pos = bucket.first;
+			if (pos.ne >= min.ne and pos.ne <= max.ne and
+			    pos.se >= min.se and pos.se <= max.se) {
+				for (TerrainObject *obj : bucket.second) {
+					f(obj);
+				}
+			}
+		}
+		return;
+	}
+
+	for (coord::tile_t ne = min.ne; ne <= max.ne; ne++) {
+		for (coord::tile_t se = min.se; se <= max.se; se++) {
+			auto it = this->buckets.find(coord::tile{ne, se});
+			if (it == this->buckets.end()) {
+				continue;
+			}
+			for (TerrainObject *obj : it->second) {
+				f(obj);
+			}
+		}
+	}
+}
+
+
+std::vector<TerrainObject *> ObjectIndex::nearest(const coord::phys3 &center,
+                                                  size_t k,
+                                                  coord::phys_t max_distance,
+                                                  const object_filter &filter) const {
+	using candidate = std::pair<coord::phys_t, TerrainObject *>;
+	std::vector<candidate> found;
+	if (k == 0) {
+		return {};
+	}
+
+	constexpr coord::phys_t bucket_phys = object_bucket_tiles * coord::settings::phys_per_tile;
+	coord::tile origin = this->bucket_of(center.to_tile3().to_tile());
+
+	auto check = [&](TerrainObject *obj) {
+		if (not filter(*obj)) {
+			return;
+		}
+		coord::phys_t d = obj->from_edge(center);
+		if (d <= max_distance) {
+			found.emplace_back(d, obj);
+		}
+	};
+
+	// look at rings of buckets around the center until
+	// no object in the next ring can be closer
+	for (coord::tile_t r = 0; ; r++) {
+		if (r > 0) {
+			// the previous ring enclosed all used buckets
+			if (origin.ne - (r - 1) <= this->used_min.ne and origin.ne + (r - 1) >= this->used_max.ne and
+			    origin.se - (r - 1) <= this->used_min.se and origin.se + (r - 1) >= this->used_max.se) {
+				break;
+			}
+
+			coord::phys_t bound = (r - 1) * bucket_phys - this->max_extent;
+			if (bound > max_distance or (found.size() >= k and bound > found[k - 1].first)) {
+				break;
+			}
+		}
+
+		coord::tile min{origin.ne - r, origin.se - r};
+		coord::tile max{origin.ne + r, origin.se + r};
+		if (r == 0) {
+			this->for_buckets(min, max, check);
+		}
+		else {
+			// the four sides of the ring
+			this->for_buckets(min, coord::tile{max.ne, min.se}, check);
+			this->for_buckets(coord::tile{min.ne, max.se}, max, check);
+			this->for_buckets(coord::tile{min.ne, min.se + 1}, coord::tile{min.ne, max.se - 1}, check);
+			this->for_buckets(coord::tile{max.ne, min.se + 1}, coord::tile{max.ne, max.se - 1}, check);
+		}
+
+		std::sort(std::begin(found), std::end(found),
+		          [](const candidate &a, const candidate &b) {
+			          return a.first < b.first;
+		          });
+		if (found.size() > k) {
+			found.resize(k);
+		}
+	}
+
+	std::vector<TerrainObject *> result;
+	result.reserve(found.size());
+	for (auto &entry : found) {
+		result.push_back(entry.second);
+	}
+	return result;
+}
+
+
+TerrainObject *ObjectIndex::nearest(const coord::phys3 &center,
+                                    coord::phys_t max_distance,
+                                    const object_filter &filter) const {
+	std::vector<TerrainObject *> result = this->nearest(center, 1, max_distance, filter);
+	if (result.empty()) {
+		return nullptr;
+	}
+	return result.front();
+}
+
+
+std::vector<TerrainObject *> ObjectIndex::in_radius(const coord::phys3 &center,
+                                                    coord::phys_t radius,
+                                                    const object_filter &filter) const {
+	std::vector<TerrainObject *> result;
+
+	coord::tile_t reach = (radius + this->max_extent) / coord::settings::phys_per_tile + 1;
+	coord::tile center_tile = center.to_tile3().to_tile();
+	coord::tile min = this->bucket_of(center_tile - coord::tile_delta{reach, reach});
+	coord::tile max = this->bucket_of(center_tile + coord::tile_delta{reach, reach});
+
+	this->for_buckets(min, max, [&](TerrainObject *obj) {
+		if (filter(*obj) and obj->from_edge(center) <= radius) {
+			result.push_back(obj);
+		}
+	});
+	return result;
+}
+
+
+std::vector<TerrainObject *> ObjectIndex::in_box(const coord::tile &min,
+                                                 const coord::tile &max,
+                                                 const object_filter &filter) const {
+	std::vector<TerrainObject *> result;
+
+	coord::tile_t reach = this->max_extent / coord::settings::phys_per_tile + 1;
+	coord::tile bucket_min = this->bucket_of(min - coord::tile_delta{reach, reach});
+	coord::tile bucket_max = this->bucket_of(max + coord::tile_delta{reach, reach});
+
+	this->for_buckets(bucket_min, bucket_max, [&](TerrainObject *obj) {
+		// the tile ranges of objects exclude their end
+		if (obj->pos.start.ne <= max.ne and obj->pos.end.ne > min.ne and
+		    obj->pos.start.se <= max.se and obj->pos.end.se > min.se and
+		    filter(*obj)) {
+			result.push_back(obj);
+		}
+	});
+	return result;
+}
+
+} // namespace openage
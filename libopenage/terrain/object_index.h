@@ -0,0 +1,146 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../gamedata/unit.gen.h"
+
+namespace openage {
+
+class Player;
+class TerrainObject;
+
+/**
+ * Width and height of the index buckets in tiles.
+ */
+constexpr coord::tile_t object_bucket_tiles = 4;
+
+/**
+ * Empty buckets that are kept before they are dropped together.
+ */
+constexpr size_t object_bucket_spare = 64;
+
+
+/**
+ * Restricts the objects found by an ObjectIndex query.
+ * Unset restrictions accept all objects.
+ */
+struct object_filter {
+	/**
+	 * Only objects of units owned by this player.
+	 */
+	const Player *owner = nullptr;
+
+	/**
+	 * Only objects of units with this class.
+	 */
+	bool by_class = false;
+	gamedata::unit_classes unit_class = gamedata::unit_classes::NONE;
+
+	/**
+	 * Additional condition, checked after the others.
+	 */
+	std::function<bool(const TerrainObject &)> accept;
+
+	bool operator ()(const TerrainObject &obj) const;
+};
+
+
+/**
+ * Uniform grid of the objects placed on a terrain.
+ *
+ * Each object is stored in the bucket of the tile its center is on,
+ * queries only look at the buckets around the searched area, so empty
+ * ground costs nothing. Objects are added by TerrainObject::place_unchecked
+ * and dropped by TerrainObject::remove.
+ *
+ * Buckets stay allocated when their last object leaves, so units walking
+ * back and forth reuse them. They are dropped once there are too many.
+ *
+ * Distances are measured to the edge of the objects.
+ */
+class ObjectIndex {
+public:
+	ObjectIndex();
+
+	void insert(TerrainObject *obj);
+	void remove(TerrainObject *obj);
+
+	/**
+	 * Number of indexed objects.
+	 */
+	size_t size() const;
+
+	/**
+	 * The up to k nearest matching objects within max_distance,
+	 * ordered by their distance.
+	 */
+	std::vector<TerrainObject *> nearest(const coord::phys3 &center,
+	                                     size_t k,
+	                                     coord::phys_t max_distance,
+	                                     const object_filter &filter) const;
+
+	/**
+	 * The nearest matching object within max_distance, nullptr if there is none.
+	 */
+	TerrainObject *nearest(const coord::phys3 &center,
+	                       coord::phys_t max_distance,
+	                       const object_filter &filter) const;
+
+	/**
+	 * All matching objects within the radius, in no particular order.
+	 */
+	std::vector<TerrainObject *> in_radius(const coord::phys3 &center,
+	                                       coord::phys_t radius,
+	                                       const object_filter &filter) const;
+
+	/**
+	 * All matching objects on the tiles from min to max (inclusive),
+	 * in no particular order.
+	 */
+	std::vector<TerrainObject *> in_box(const coord::tile &min,
+	                                    const coord::tile &max,
+	                                    const object_filter &filter) const;
+
+private:
+	coord::tile bucket_of(const coord::tile &pos) const;
+
+	/**
+	 * Drop the empty buckets.
+	 */
+	void compact();
+
+	/**
+	 * Call f for each object in the buckets from min to max (inclusive).
+	 */
+	template<typename F>
+	void for_buckets(const coord::tile &min, const coord::tile &max, F f) const;
+
+	std::unordered_map<coord::tile, std::vector<TerrainObject *>> buckets;
+
+	/**
+	 * Buckets that were ever used, rings of a nearest search stop there.
+	 */
+	coord::tile used_min, used_max;
+
+	/**
+	 * Largest object size seen in phys units. Objects reach that far
+	 * out of their bucket, so queries look at that many more tiles.
+	 */
+	coord::phys_t max_extent;
+
+	size_t count;
+
+	/**
+	 * Number of buckets without objects.
+	 */
+	size_t empty_buckets;
+};
+
+} // namespace openage
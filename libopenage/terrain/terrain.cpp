@@ -2,6 +2,7 @@
 
 #include "terrain.h"
 
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <set>
@@ -17,41 +18,103 @@
 #include "../coord/tile3.h"
 #include "../util/misc.h"
 #include "../util/strings.h"
+#include "../pathfinding/hierarchy.h"
+#include "../pathfinding/path_cache.h"
 
+#include "object_index.h"
 #include "terrain_chunk.h"
 #include "terrain_object.h"
 
 namespace openage {
 
-TileContent::TileContent() :
-	terrain_id{0} {
-}
+namespace {
+
+/**
+ * source of the ids of terrains, see Terrain::id.
+ */
+std::atomic<size_t> next_terrain_id{1};
+
+/**
+ * the chunk looked up by the last get_data call of a thread.
+ */
+struct chunk_cache {
+	size_t terrain_id;
+	size_t generation;
+	coord::chunk position;
+	TerrainChunk *chunk;
+};
+
+thread_local chunk_cache last_chunk{0, 0, {0, 0}, nullptr};
 
-TileContent::~TileContent() {}
+} // anonymous namespace
 
 Terrain::Terrain(terrain_meta *meta, bool is_infinite)
 	:
 	infinite{is_infinite},
-	meta{meta} {
-
-	// TODO:
-	//this->limit_positive =
-	//this->limit_negative =
+	limit_positive{0, 0},
+	limit_negative{0, 0},
+	meta{meta},
+	chunk_grid_origin{0, 0},
+	chunk_grid_width{0},
+	chunk_grid_height{0},
+	id{next_terrain_id++},
+	generation{0},
+	path_cache{std::make_unique<path::PathCache>()},
+	object_index{std::make_unique<ObjectIndex>()} {
+
+	if (not this->infinite) {
+		this->reserve_chunks(this->limit_negative, this->limit_positive);
+	}
+}
 
-	// maps chunk position to chunks
-	this->chunks = std::unordered_map<coord::chunk, TerrainChunk *, coord_chunk_hash>{};
+Terrain::Terrain(terrain_meta *meta, coord::tile limit_negative, coord::tile limit_positive)
+	:
+	Terrain{meta, false} {
 
+	this->limit_negative = limit_negative;
+	this->limit_positive = limit_positive;
+	this->reserve_chunks(limit_negative, limit_positive);
 }
 
 Terrain::~Terrain() {
 	log::log(MSG(dbg) << "Cleanup terrain");
 
-	for (auto &chunk : this->chunks) {
-		// this chunk was autogenerated, so clean it up
-		if (chunk.second->manually_created == false) {
-			delete chunk.second;
+	// autogenerated chunks are cleaned up
+	auto cleanup = [](TerrainChunk *chunk) {
+		if (chunk != nullptr and chunk->manually_created == false) {
+			delete chunk;
 		}
+	};
+
+	for (auto &chunk : this->chunks) {
+		cleanup(chunk.second);
+	}
+	for (auto chunk : this->chunk_grid) {
+		cleanup(chunk);
+	}
+}
+
+void Terrain::reserve_chunks(coord::tile first, coord::tile last) {
+	coord::chunk min = first.to_chunk();
+	coord::chunk max = last.to_chunk();
+	ENSURE(min.ne <= max.ne and min.se <= max.se, "terrain limits are swapped");
+	ENSURE(this->used_chunks().empty(), "the chunk grid must be set up before adding chunks");
+
+	this->chunk_grid_origin = min;
+	this->chunk_grid_width = max.ne - min.ne + 1;
+	this->chunk_grid_height = max.se - min.se + 1;
+	this->chunk_grid.assign(this->chunk_grid_width * this->chunk_grid_height, nullptr);
+	this->generation.fetch_add(1, std::memory_order_release);
+}
+
+TerrainChunk **Terrain::grid_slot(coord::chunk position) {
+	coord::chunk_t ne = position.ne - this->chunk_grid_origin.ne;
+	coord::chunk_t se = position.se - this->chunk_grid_origin.se;
+	if (ne < 0 or ne >= this->chunk_grid_width or
+	    se < 0 or se >= this->chunk_grid_height) {
+		return nullptr;
 	}
+	return &this->chunk_grid[se * this->chunk_grid_width + ne];
 }
 
 std::vector<coord::chunk> Terrain::used_chunks() const {
@@ -59,6 +122,16 @@ std::vector<coord::chunk> Terrain::used_chunks() const {
 	for (auto &c : chunks) {
 		result.push_back(c.first);
 	}
+	for (coord::chunk_t se = 0; se < this->chunk_grid_height; se++) {
+		for (coord::chunk_t ne = 0; ne < this->chunk_grid_width; ne++) {
+			if (this->chunk_grid[se * this->chunk_grid_width + ne] != nullptr) {
+				result.push_back(coord::chunk{
+					static_cast<coord::chunk_t>(this->chunk_grid_origin.ne + ne),
+					static_cast<coord::chunk_t>(this->chunk_grid_origin.se + se)
+				});
+			}
+		}
+	}
 	return result;
 }
 
@@ -72,21 +145,39 @@ bool Terrain::fill(const int *data, coord::tile_delta size) {
 				was_cut = true;
 				continue;
 			}
-			int terrain_id = data[pos.ne * size.ne + pos.se];
+			int terrain_id = data[pos.ne * size.se + pos.se];
 			TerrainChunk *chunk = this->get_create_chunk(pos);
-			chunk->get_data(pos)->terrain_id = terrain_id;
+			chunk->get_data(pos).set_terrain_id(terrain_id);
 		}
 	}
+
+	// the ground changed everywhere
+	for (auto &hierarchy : this->path_hierarchies) {
+		hierarchy.second->refresh_all();
+	}
+	this->path_cache->clear();
+
 	return was_cut;
 }
 
 void Terrain::attach_chunk(TerrainChunk *new_chunk,
                            coord::chunk position,
                            bool manually_created) {
+	TerrainChunk **slot = this->grid_slot(position);
+	if (slot != nullptr) {
+		*slot = new_chunk;
+	}
+	else if (this->infinite) {
+		this->chunks[position] = new_chunk;
+	}
+	else {
+		throw Error{MSG(err) << "Chunk (" << position.ne << "," << position.se << ") "
+		                     << "is outside of the finite terrain"};
+	}
+
 	new_chunk->set_terrain(this);
 	new_chunk->manually_created = manually_created;
 	log::log(MSG(dbg) << "Inserting new chunk at (" << position.ne << "," << position.se << ")");
-	this->chunks[position] = new_chunk;
 
 	struct chunk_neighbors neigh = this->get_chunk_neighbors(position);
 	for (int i = 0; i < 8; i++) {
@@ -105,9 +196,23 @@ void Terrain::attach_chunk(TerrainChunk *new_chunk,
 			log::log(MSG(dbg) << "Neighbor " << i << " not found.");
 		}
 	}
+
+	// lookups cached before don't know the new chunk
+	this->generation.fetch_add(1, std::memory_order_release);
+
+	// borders to the new chunk may have become passable
+	this->chunk_changed(position);
 }
 
 TerrainChunk *Terrain::get_chunk(coord::chunk position) {
+	TerrainChunk **slot = this->grid_slot(position);
+	if (slot != nullptr) {
+		return *slot;
+	}
+	else if (not this->infinite) {
+		return nullptr;
+	}
+
 	auto iter = this->chunks.find(position);
 
 	if (iter == this->chunks.end()) {
@@ -135,10 +240,25 @@ TerrainChunk *Terrain::get_create_chunk(coord::tile position) {
 	return this->get_create_chunk(position.to_chunk());
 }
 
-TileContent *Terrain::get_data(coord::tile position) {
-	TerrainChunk *c = this->get_chunk(position.to_chunk());
+TileContent Terrain::get_data(coord::tile position) {
+	coord::chunk chunk_position = position.to_chunk();
+
+	// consecutive lookups are mostly on the same chunk
+	chunk_cache &cache = last_chunk;
+	size_t generation = this->generation.load(std::memory_order_acquire);
+	TerrainChunk *c;
+	if (cache.terrain_id == this->id and
+	    cache.generation == generation and
+	    cache.position == chunk_position) {
+		c = cache.chunk;
+	}
+	else {
+		c = this->get_chunk(chunk_position);
+		cache = chunk_cache{this->id, generation, chunk_position, c};
+	}
+
 	if (c == nullptr) {
-		return nullptr;
+		return TileContent{};
 	} else {
 		return c->get_data(position.get_pos_on_chunk().to_tile());
 	}
@@ -146,7 +266,7 @@ TileContent *Terrain::get_data(coord::tile position) {
 
 TerrainObject *Terrain::obj_at_point(const coord::phys3 &point) {
 	coord::tile t = point.to_tile3().to_tile();
-	TileContent *tc = this->get_data(t);
+	TileContent tc = this->get_data(t);
 	if (!tc) {
 		return nullptr;
 	}
@@ -154,7 +274,7 @@ TerrainObject *Terrain::obj_at_point(const coord::phys3 &point) {
 
 	// prioritise selecting the smallest object
 	TerrainObject *smallest = nullptr;
-	for (auto obj_ptr : tc->obj) {
+	for (auto obj_ptr : tc.obj) {
 		if (obj_ptr->contains(point) &&
 		    (!smallest || obj_ptr->min_axis() < smallest->min_axis())) {
 			smallest = obj_ptr;
@@ -163,6 +283,29 @@ TerrainObject *Terrain::obj_at_point(const coord::phys3 &point) {
 	return smallest;
 }
 
+path::Hierarchy &Terrain::get_path_hierarchy(terrain_mask_t allowed_terrain) {
+	auto &hierarchy = this->path_hierarchies[allowed_terrain];
+	if (not hierarchy) {
+		hierarchy = std::make_unique<path::Hierarchy>(this, allowed_terrain);
+	}
+	return *hierarchy;
+}
+
+void Terrain::chunk_changed(coord::chunk position) {
+	for (auto &hierarchy : this->path_hierarchies) {
+		hierarchy.second->refresh(position);
+	}
+	this->path_cache->invalidate(position);
+}
+
+path::PathCache &Terrain::get_path_cache() {
+	return *this->path_cache;
+}
+
+ObjectIndex &Terrain::get_object_index() {
+	return *this->object_index;
+}
+
 bool Terrain::validate_terrain(terrain_t terrain_id) {
 	if (terrain_id >= (ssize_t)this->meta->terrain_id_count) {
 		throw Error(MSG(err) << "Requested terrain_id is out of range: " << terrain_id);
@@ -401,9 +544,9 @@ struct terrain_render_data Terrain::create_draw_advice(coord::tile ab,
 
 			// get the object standing on the tile
 			// TODO: make the terrain independent of objects standing on it.
-			TileContent *tile_content = this->get_data(tilepos);
+			TileContent tile_content = this->get_data(tilepos);
 			if (tile_content != nullptr) {
-				for (auto obj_item : tile_content->obj) {
+				for (auto obj_item : tile_content.obj) {
 					objects->insert(obj_item);
 				}
 			}
@@ -419,7 +562,7 @@ struct tile_draw_data Terrain::create_tile_advice(coord::tile position, bool ble
 	struct tile_draw_data tile;
 	tile.count = 0;
 
-	TileContent *base_tile_content = this->get_data(position);
+	TileContent base_tile_content = this->get_data(position);
 
 	// chunk of this tile does not exist
 	if (base_tile_content == nullptr) {
@@ -429,7 +572,7 @@ struct tile_draw_data Terrain::create_tile_advice(coord::tile position, bool ble
 	struct tile_data base_tile_data;
 
 	// the base terrain id of the tile
-	base_tile_data.terrain_id = base_tile_content->terrain_id;
+	base_tile_data.terrain_id = base_tile_content.get_terrain_id();
 
 	// the base terrain is not existant.
 	if (base_tile_data.terrain_id < 0) {
@@ -495,14 +638,14 @@ void Terrain::get_neighbors(coord::tile basepos,
 		coord::tile neigh_pos = basepos + neigh_offsets[neigh_id];
 
 		// get the neighbor data
-		TileContent *neigh_content = this->get_data(neigh_pos);
+		TileContent neigh_content = this->get_data(neigh_pos);
 
 		// chunk for neighbor or single tile is not existant
-		if (neigh_content == nullptr || neigh_content->terrain_id < 0) {
+		if (neigh_content == nullptr || neigh_content.get_terrain_id() < 0) {
 			neighbor->state = tile_state::missing;
 		}
 		else {
-			neighbor->terrain_id = neigh_content->terrain_id;
+			neighbor->terrain_id = neigh_content.get_terrain_id();
 			neighbor->state      = tile_state::existing;
 			neighbor->priority   = this->priority(neighbor->terrain_id);
 
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <stddef.h>
@@ -18,10 +21,16 @@
 namespace openage {
 
 class Engine;
+class ObjectIndex;
 class RenderOptions;
 class TerrainChunk;
 class TerrainObject;
 
+namespace path {
+class Hierarchy;
+class PathCache;
+} // namespace path
+
 /**
  * type that for terrain ids.
  * it's signed so that -1 can indicate a missing tile.
@@ -29,6 +38,25 @@ class TerrainObject;
  */
 using terrain_t = int;
 
+/**
+ * set of terrain ids, bit n is set if terrain id n is contained.
+ * used to describe the terrains an object may stand on.
+ */
+using terrain_mask_t = uint64_t;
+
+/**
+ * number of terrain ids a terrain mask can contain,
+ * larger ids can't be allowed by a mask.
+ */
+constexpr terrain_t terrain_mask_bits = sizeof(terrain_mask_t) * 8;
+
+/**
+ * whether the terrain id can be stored in a terrain mask.
+ */
+constexpr bool fits_terrain_mask(terrain_t id) {
+	return id >= 0 and id < terrain_mask_bits;
+}
+
 /**
  * hashing for chunk coordinates.
  *
@@ -37,24 +65,112 @@ using terrain_t = int;
 struct coord_chunk_hash {
 	size_t operator ()(const coord::chunk &input) const {
 		constexpr int half_size_t_bits = sizeof(size_t) * 4;
+		constexpr size_t low_mask = (size_t{1} << half_size_t_bits) - 1;
 
-		return ((size_t)input.ne << half_size_t_bits) | input.se;
+		// se must not be sign extended into the bits of ne
+		return ((size_t)input.ne << half_size_t_bits) | ((size_t)input.se & low_mask);
 	}
 };
 
 
+/**
+ * the list of objects which have a bounding box overlapping a tile.
+ *
+ * the lists of all tiles of a chunk are stored in one slot pool of
+ * the chunk, this is only a view of one of them.
+ */
+class TileObjects {
+public:
+	class iterator {
+	public:
+		iterator(const TerrainChunk *chunk, uint32_t slot);
+
+		TerrainObject *operator *() const;
+		iterator &operator ++();
+		bool operator ==(const iterator &other) const;
+		bool operator !=(const iterator &other) const;
+
+	private:
+		const TerrainChunk *chunk;
+		uint32_t slot;
+	};
+
+	TileObjects(TerrainChunk *chunk, size_t tile);
+
+	iterator begin() const;
+	iterator end() const;
+
+	bool empty() const;
+	size_t size() const;
+
+	/**
+	 * the object at the given position of the list.
+	 */
+	TerrainObject *operator [](size_t index) const;
+
+	/**
+	 * append an object to the list.
+	 */
+	void push_back(TerrainObject *obj);
+
+	/**
+	 * remove all entries of an object from the list.
+	 */
+	void remove(TerrainObject *obj);
+
+private:
+	TerrainChunk *chunk;
+	size_t tile;
+};
+
+
 /**
  * describes the properties of one terrain tile.
  *
  * this includes the terrain_id (ice, water, grass, ...)
- * and the list of objects which have a bounding box overlapping the tile
+ * and the list of objects which have a bounding box overlapping the tile.
+ *
+ * the data is stored in the arrays of the chunk, this is a handle to it.
+ * handles of missing tiles compare equal to nullptr, they have no
+ * objects and their terrain id is -1.
+ * store the handle before looping over its objects, a temporary
+ * handle is gone before the loop body runs.
  */
 class TileContent {
 public:
+	/**
+	 * handle of a missing tile.
+	 */
 	TileContent();
-	~TileContent();
-	terrain_t terrain_id;
-	std::vector<TerrainObject *> obj;
+	TileContent(TerrainChunk *chunk, size_t tile);
+
+	/**
+	 * the terrain id of the tile, -1 if the tile is missing.
+	 */
+	terrain_t get_terrain_id() const;
+
+	/**
+	 * change the terrain id of the tile, which must exist.
+	 */
+	void set_terrain_id(terrain_t id);
+
+	TileObjects obj;
+
+	explicit operator bool() const {
+		return this->chunk != nullptr;
+	}
+
+	bool operator ==(std::nullptr_t) const {
+		return this->chunk == nullptr;
+	}
+
+	bool operator !=(std::nullptr_t) const {
+		return this->chunk != nullptr;
+	}
+
+private:
+	TerrainChunk *chunk;
+	size_t tile;
 };
 
 
@@ -173,6 +289,12 @@ struct terrain_meta {
 class Terrain {
 public:
 	Terrain(terrain_meta *meta, bool is_infinite);
+
+	/**
+	 * create a finite terrain from limit_negative to limit_positive (inclusive).
+	 * its chunks are stored in a dense grid.
+	 */
+	Terrain(terrain_meta *meta, coord::tile limit_negative, coord::tile limit_positive);
 	~Terrain();
 
 	bool infinite; //!< chunks are automagically created as soon as they are referenced
@@ -180,6 +302,14 @@ public:
 	coord::tile limit_positive, limit_negative; //!< for non-infinite terrains, this is the size limit.
 	//TODO: non-square shaped terrain bounds
 
+	/**
+	 * store the chunks from the first to the last tile (inclusive)
+	 * in a dense grid, which is faster to look up than the hash map.
+	 * infinite terrains keep chunks outside of it in the hash map.
+	 * must be called before chunks are attached.
+	 */
+	void reserve_chunks(coord::tile first, coord::tile last);
+
 	/**
 	 * returns a list of all referenced chunks
 	 */
@@ -234,13 +364,38 @@ public:
 	 *
 	 * the only reason the chunks exist, is because of this data.
 	 */
-	TileContent *get_data(coord::tile position);
+	TileContent get_data(coord::tile position);
 
 	/**
 	 * an object which contains the given point, null otherwise
 	 */
 	TerrainObject *obj_at_point(const coord::phys3 &point);
 
+	/**
+	 * get the chunk graphs for hierarchical path searches of objects
+	 * that may stand on the given terrain ids.
+	 * they are created on first use, only on the game thread.
+	 */
+	path::Hierarchy &get_path_hierarchy(terrain_mask_t allowed_terrain);
+
+	/**
+	 * get the paths found on this terrain that can be used again.
+	 */
+	path::PathCache &get_path_cache();
+
+	/**
+	 * get the index of the objects placed on this terrain,
+	 * for finding them by position.
+	 */
+	ObjectIndex &get_object_index();
+
+	/**
+	 * notify the terrain that the ground or the buildings
+	 * on a chunk changed, so the passability bitmaps are rebuilt
+	 * and cached path data gets invalidated.
+	 */
+	void chunk_changed(coord::chunk position);
+
 	/**
 	 * get the neighbor chunks of a given chunk.
 	 *
@@ -386,6 +541,11 @@ public:
 	                     struct influence_group *influences);
 
 private:
+	/**
+	 * the grid entry of a chunk position.
+	 * @return nullptr if the position is outside of the grid.
+	 */
+	TerrainChunk **grid_slot(coord::chunk position);
 
 	/**
 	 * terrain meta data
@@ -393,10 +553,43 @@ private:
 	terrain_meta *meta;
 
 	/**
-	 * maps chunk coordinates to chunks.
+	 * maps chunk coordinates to chunks, used by infinite terrains
+	 * for the chunks outside of the grid.
 	 */
 	std::unordered_map<coord::chunk, TerrainChunk *, coord_chunk_hash> chunks;
 
+	/**
+	 * chunks of finite terrains and the reserved chunks of infinite ones,
+	 * row by row from chunk_grid_origin. missing chunks are nullptr.
+	 */
+	std::vector<TerrainChunk *> chunk_grid;
+	coord::chunk chunk_grid_origin;
+	coord::chunk_t chunk_grid_width, chunk_grid_height;
+
+	/**
+	 * identifies this terrain and its chunk layout in the
+	 * per-thread chunk cache of get_data.
+	 * the id is never reused, the generation changes when chunks are attached.
+	 * it is only changed on the game thread after the chunk was stored,
+	 * so a thread that sees the new generation also sees the chunk.
+	 */
+	const size_t id;
+	std::atomic<size_t> generation;
+
+	/**
+	 * chunk graphs for path searches, by allowed terrain ids.
+	 */
+	std::unordered_map<terrain_mask_t, std::unique_ptr<path::Hierarchy>> path_hierarchies;
+
+	/**
+	 * paths for reuse, dropped when the chunks they cross change.
+	 */
+	std::unique_ptr<path::PathCache> path_cache;
+
+	/**
+	 * placed objects by position.
+	 */
+	std::unique_ptr<ObjectIndex> object_index;
 };
 
 } // namespace openage
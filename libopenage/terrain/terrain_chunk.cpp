@@ -1,4 +1,4 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "terrain_chunk.h"
 
@@ -20,14 +20,139 @@
 namespace openage {
 
 
+TileObjects::iterator::iterator(const TerrainChunk *chunk, uint32_t slot)
+	:
+	chunk{chunk},
+	slot{slot} {}
+
+TerrainObject *TileObjects::iterator::operator *() const {
+	return this->chunk->object_slots[this->slot].obj;
+}
+
+TileObjects::iterator &TileObjects::iterator::operator ++() {
+	this->slot = this->chunk->object_slots[this->slot].next;
+	return *this;
+}
+
+bool TileObjects::iterator::operator ==(const iterator &other) const {
+	return this->slot == other.slot;
+}
+
+bool TileObjects::iterator::operator !=(const iterator &other) const {
+	return this->slot != other.slot;
+}
+
+
+TileObjects::TileObjects(TerrainChunk *chunk, size_t tile)
+	:
+	chunk{chunk},
+	tile{tile} {}
+
+TileObjects::iterator TileObjects::begin() const {
+	if (this->chunk == nullptr) {
+		return this->end();
+	}
+	return iterator{this->chunk, this->chunk->first_object[this->tile]};
+}
+
+TileObjects::iterator TileObjects::end() const {
+	return iterator{this->chunk, TerrainChunk::no_slot};
+}
+
+bool TileObjects::empty() const {
+	return this->begin() == this->end();
+}
+
+size_t TileObjects::size() const {
+	size_t count = 0;
+	for (auto it = this->begin(); it != this->end(); ++it) {
+		count += 1;
+	}
+	return count;
+}
+
+TerrainObject *TileObjects::operator [](size_t index) const {
+	auto it = this->begin();
+	for (size_t i = 0; i < index; i++) {
+		++it;
+	}
+	return *it;
+}
+
+void TileObjects::push_back(TerrainObject *obj) {
+	auto &pool = this->chunk->object_slots;
+
+	uint32_t slot = this->chunk->free_slot;
+	if (slot == TerrainChunk::no_slot) {
+		slot = pool.size();
+		pool.push_back({obj, TerrainChunk::no_slot});
+	}
+	else {
+		this->chunk->free_slot = pool[slot].next;
+		pool[slot] = {obj, TerrainChunk::no_slot};
+	}
+
+	// append at the end to keep the order of the objects
+	uint32_t *link = &this->chunk->first_object[this->tile];
+	while (*link != TerrainChunk::no_slot) {
+		link = &pool[*link].next;
+	}
+	*link = slot;
+}
+
+void TileObjects::remove(TerrainObject *obj) {
+	auto &pool = this->chunk->object_slots;
+
+	uint32_t *link = &this->chunk->first_object[this->tile];
+	while (*link != TerrainChunk::no_slot) {
+		uint32_t slot = *link;
+		if (pool[slot].obj == obj) {
+			*link = pool[slot].next;
+			pool[slot] = {nullptr, this->chunk->free_slot};
+			this->chunk->free_slot = slot;
+		}
+		else {
+			link = &pool[slot].next;
+		}
+	}
+}
+
+
+TileContent::TileContent()
+	:
+	obj{nullptr, 0},
+	chunk{nullptr},
+	tile{0} {}
+
+TileContent::TileContent(TerrainChunk *chunk, size_t tile)
+	:
+	obj{chunk, tile},
+	chunk{chunk},
+	tile{tile} {}
+
+terrain_t TileContent::get_terrain_id() const {
+	if (this->chunk == nullptr) {
+		return -1;
+	}
+	return this->chunk->terrain_ids[this->tile];
+}
+
+void TileContent::set_terrain_id(terrain_t id) {
+	ENSURE(this->chunk != nullptr, "the terrain of a missing tile can't be set");
+	this->chunk->terrain_ids[this->tile] = id;
+}
+
+
 TerrainChunk::TerrainChunk()
 	:
-	manually_created{true} {
+	manually_created{true},
+	free_slot{no_slot} {
 	this->tile_count = std::pow(chunk_size, 2);
 
-	// the data array for this chunk.
-	// each element describes the tile data.
-	this->data = new TileContent[this->tile_count];
+	for (size_t i = 0; i < this->tile_count; i++) {
+		this->terrain_ids[i] = 0;
+		this->first_object[i] = no_slot;
+	}
 
 	// initialize all neighbors as nonexistant
 	for (int i = 0; i < 8; i++) {
@@ -40,19 +165,17 @@ TerrainChunk::TerrainChunk()
 }
 
 
-TerrainChunk::~TerrainChunk() {
-	delete[] this->data;
-}
+TerrainChunk::~TerrainChunk() {}
 
-TileContent *TerrainChunk::get_data(coord::tile pos) {
+TileContent TerrainChunk::get_data(coord::tile pos) {
 	return this->get_data(this->tile_position_neigh(pos));
 }
 
-TileContent *TerrainChunk::get_data(size_t pos) {
-	return &this->data[pos];
+TileContent TerrainChunk::get_data(size_t pos) {
+	return TileContent{this, pos};
 }
 
-TileContent *TerrainChunk::get_data_neigh(coord::tile pos) {
+TileContent TerrainChunk::get_data_neigh(coord::tile pos) {
 	// determine the neighbor id by the given position
 	int neighbor_id = this->neighbor_id_by_pos(pos);
 
@@ -64,7 +187,7 @@ TileContent *TerrainChunk::get_data_neigh(coord::tile pos) {
 
 		// this neighbor does not exist, so the tile does not exist.
 		if (neigh_chunk == nullptr) {
-			return nullptr;
+			return TileContent{};
 		}
 
 		// get position of tile on neighbor
@@ -1,7 +1,8 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <stddef.h>
 #include <vector>
 
@@ -9,6 +10,7 @@
 #include "../coord/tile.h"
 #include "../texture.h"
 #include "../util/file.h"
+#include "terrain.h"
 
 namespace openage {
 
@@ -56,9 +58,9 @@ public:
 	size_t tile_count;
 
 	/**
-	 * stores the chunk data, one tile_content struct for each tile.
+	 * the terrain id of each tile, row by row.
 	 */
-	TileContent *data;
+	terrain_t terrain_ids[chunk_size * chunk_size];
 
 	/**
 	 * the terrain to which this chunk belongs to.
@@ -80,19 +82,19 @@ public:
 	/**
 	 * get tile data by coordinates.
 	 */
-	TileContent *get_data(coord::tile pos);
+	TileContent get_data(coord::tile pos);
 
 	/**
 	 * get tile data by memory position.
 	 */
-	TileContent *get_data(size_t pos);
+	TileContent get_data(size_t pos);
 
 	/**
 	 * get the tile data a given tile position relative to this chunk.
 	 *
 	 * also queries neighbors if the position is not on this chunk.
 	 */
-	TileContent *get_data_neigh(coord::tile pos);
+	TileContent get_data_neigh(coord::tile pos);
 
 	int neighbor_id_by_pos(coord::tile pos);
 
@@ -106,6 +108,32 @@ public:
 	void set_terrain(Terrain *parent);
 
 	bool manually_created;
+
+private:
+	/**
+	 * entry of an object list of a tile.
+	 */
+	struct object_slot {
+		TerrainObject *obj;
+		uint32_t next;
+	};
+
+	static constexpr uint32_t no_slot = UINT32_MAX;
+
+	/**
+	 * the first slot of the object list of each tile,
+	 * no_slot if there are no objects on it.
+	 */
+	uint32_t first_object[chunk_size * chunk_size];
+
+	/**
+	 * the object lists of all tiles, unused slots are linked from free_slot.
+	 * most tiles have no object, so this is much smaller than a list per tile.
+	 */
+	std::vector<object_slot> object_slots;
+	uint32_t free_slot;
+
+	friend class TileObjects;
 };
 
 } // namespace openage
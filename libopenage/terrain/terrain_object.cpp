@@ -1,4 +1,4 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "terrain_object.h"
 
@@ -14,16 +14,72 @@
 #include "../coord/camgame.h"
 #include "../unit/unit.h"
 
+#include "object_index.h"
 #include "terrain.h"
 #include "terrain_chunk.h"
 #include "terrain_outline.h"
 
 namespace openage {
 
-TerrainObject::TerrainObject(Unit &u)
+namespace {
+
+/*
+ * collision tests of an object at a position with a placed one,
+ * for each combination of shapes
+ */
+
+bool square_square(const TerrainObject &obj, const TerrainObject &other, const coord::phys3 &position) {
+	tile_range rng = obj.get_range(position);
+	return rng.start.ne < other.pos.end.ne
+	       and other.pos.start.ne < rng.end.ne
+	       and rng.start.se < other.pos.end.se
+	       and other.pos.start.se < rng.end.se;
+}
+
+bool square_radial(const TerrainObject &obj, const TerrainObject &other, const coord::phys3 &position) {
+	const RadialObject &rad = static_cast<const RadialObject &>(other);
+
+	// clamp between start and end
+	tile_range rng = obj.get_range(position);
+	coord::phys3 start_phys = rng.start.to_phys2().to_phys3() - phys_half_tile;
+	coord::phys3 end_phys = rng.end.to_phys2().to_phys3() - phys_half_tile;
+	coord::phys_t cx = std::max(start_phys.ne, std::min(end_phys.ne, rad.pos.draw.ne));
+	coord::phys_t cy = std::max(start_phys.se, std::min(end_phys.se, rad.pos.draw.se));
+
+	// distance to square object base
+	coord::phys_t dx = rad.pos.draw.ne - cx;
+	coord::phys_t dy = rad.pos.draw.se - cy;
+	return std::hypot(dx, dy) < rad.phys_radius;
+}
+
+bool radial_square(const TerrainObject &obj, const TerrainObject &other, const coord::phys3 &position) {
+	return other.from_edge(position) < static_cast<const RadialObject &>(obj).phys_radius;
+}
+
+bool radial_radial(const TerrainObject &obj, const TerrainObject &other, const coord::phys3 &position) {
+	const RadialObject &rad = static_cast<const RadialObject &>(obj);
+	const RadialObject &rad_other = static_cast<const RadialObject &>(other);
+	return distance(position, rad_other.pos.draw) < rad.phys_radius + rad_other.phys_radius;
+}
+
+using collision_test = bool (*)(const TerrainObject &, const TerrainObject &, const coord::phys3 &);
+
+/**
+ * the collision tests, by the shape of the tested and of the other object
+ */
+constexpr collision_test collision_tests[2][2] {
+	{square_square, square_radial},
+	{radial_square, radial_radial},
+};
+
+} // anonymous namespace
+
+TerrainObject::TerrainObject(Unit &u, object_shape shape)
 	:
 	unit(u),
+	shape{shape},
 	passable{[](const coord::phys3 &) -> bool {return true;}},
+	allowed_terrain{0},
 	draw{[]() {}},
 	state{object_state::removed},
 	occupied_chunk_count{0},
@@ -78,7 +134,7 @@ bool TerrainObject::place(object_state init_state) {
 	// which intersect with the new placement
 	// if non-floating objects are on the foundation
 	// then this placement will fail
-	for (coord::tile temp_pos : tile_list(this->pos)) {
+	for (coord::tile temp_pos : tiles(this->pos)) {
 		std::vector<TerrainObject *> to_remove;
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
@@ -86,7 +142,8 @@ bool TerrainObject::place(object_state init_state) {
 			continue;
 		}
 
-		for (auto obj : chunk->get_data(temp_pos)->obj) {
+		TileContent tile = chunk->get_data(temp_pos);
+		for (auto obj : tile.obj) {
 
 			// ignore self and annexes of self
 			if (obj != this &&
@@ -113,6 +170,9 @@ bool TerrainObject::place(object_state init_state) {
 
 	// set new state
 	this->state = init_state;
+	if (this->changes_chunks()) {
+		this->notify_chunks();
+	}
 	return true;
 }
 
@@ -134,6 +194,9 @@ bool TerrainObject::place(std::shared_ptr<Terrain> t, coord::phys3 &position, ob
 
 	// set state
 	this->state = init_state;
+	if (this->changes_chunks()) {
+		this->notify_chunks();
+	}
 	return true;
 }
 
@@ -165,7 +228,11 @@ void TerrainObject::remove() {
 		return;
 	}
 
-	for (coord::tile temp_pos : tile_list(this->pos)) {
+	// the chunks are notified once the object is gone from its tiles
+	bool notify = this->changes_chunks();
+	this->get_terrain()->get_object_index().remove(this);
+
+	for (coord::tile temp_pos : tiles(this->pos)) {
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -173,18 +240,15 @@ void TerrainObject::remove() {
 		}
 
 		int tile_pos = chunk->tile_position_neigh(temp_pos);
-		auto &v = chunk->get_data(tile_pos)->obj;
-		auto position_it = std::remove_if(
-			std::begin(v),
-			std::end(v),
-			[this](TerrainObject *obj) {
-				return this == obj;
-			});
-		v.erase(position_it, std::end(v));
+		chunk->get_data(tile_pos).obj.remove(this);
 	}
 
 	this->occupied_chunk_count = 0;
 	this->state = object_state::removed;
+
+	if (notify) {
+		this->notify_chunks();
+	}
 }
 
 void TerrainObject::set_ground(int id, int additional) {
@@ -204,12 +268,20 @@ void TerrainObject::set_ground(int id, int additional) {
 			}
 
 			size_t tile_pos = chunk->tile_position_neigh(temp_pos);
-			chunk->get_data(tile_pos)->terrain_id = id;
+			chunk->get_data(tile_pos).set_terrain_id(id);
 			temp_pos.se++;
 		}
 		temp_pos.se = this->pos.start.se - additional;
 		temp_pos.ne++;
 	}
+
+	coord::chunk first = (this->pos.start - coord::tile_delta{additional, additional}).to_chunk();
+	coord::chunk last = (this->pos.end + coord::tile_delta{additional, additional}).to_chunk();
+	for (coord::chunk_t ne = first.ne; ne <= last.ne; ne++) {
+		for (coord::chunk_t se = first.se; se <= last.se; se++) {
+			this->get_terrain()->chunk_changed(coord::chunk{ne, se});
+		}
+	}
 }
 
 const TerrainObject *TerrainObject::get_parent() const {
@@ -229,6 +301,10 @@ std::vector<TerrainObject *> TerrainObject::get_children() const {
 	return result;
 }
 
+bool TerrainObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
+	return collision_tests[static_cast<int>(this->shape)][static_cast<int>(other.shape)](*this, other, position);
+}
+
 bool TerrainObject::operator <(const TerrainObject &other) {
 	if (this == &other) {
 		return false;
@@ -268,7 +344,7 @@ void TerrainObject::place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &po
 
 	// set pointers to this object on each terrain tile
 	// where the building will stand and block the ground
-	for (coord::tile temp_pos : tile_list(this->pos)) {
+	for (coord::tile temp_pos : tiles(this->pos)) {
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -289,7 +365,28 @@ void TerrainObject::place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &po
 		}
 
 		int tile_pos = chunk->tile_position_neigh(temp_pos);
-		chunk->get_data(tile_pos)->obj.push_back(this);
+		chunk->get_data(tile_pos).obj.push_back(this);
+	}
+
+	// objects outside of all chunks are not on the terrain
+	if (this->occupied_chunk_count > 0) {
+		t->get_object_index().insert(this);
+	}
+}
+
+bool TerrainObject::changes_chunks() const {
+	// only placed buildings change the chunk path graphs
+	return this->covers_tiles() and this->check_collisions();
+}
+
+void TerrainObject::notify_chunks() const {
+	auto terrain = this->get_terrain();
+	coord::chunk first = this->pos.start.to_chunk();
+	coord::chunk last = this->pos.end.to_chunk();
+	for (coord::chunk_t ne = first.ne; ne <= last.ne; ne++) {
+		for (coord::chunk_t se = first.se; se <= last.se; se++) {
+			terrain->chunk_changed(coord::chunk{ne, se});
+		}
 	}
 }
 
@@ -300,7 +397,7 @@ SquareObject::SquareObject(Unit &u, coord::tile_delta foundation_size)
 
 SquareObject::SquareObject(Unit &u, coord::tile_delta foundation_size, std::shared_ptr<Texture> out_tex)
 	:
-	TerrainObject(u),
+	TerrainObject(u, object_shape::square),
 	size(foundation_size) {
 	this->outline_texture = out_tex;
 }
@@ -338,7 +435,7 @@ coord::phys3 SquareObject::on_edge(const coord::phys3 &angle, coord::phys_t) con
 bool SquareObject::contains(const coord::phys3 &other) const {
 	coord::tile other_tile = other.to_tile3().to_tile();
 
-	for (coord::tile check_pos : tile_list(this->pos)) {
+	for (coord::tile check_pos : tiles(this->pos)) {
 		if (check_pos == other_tile) {
 			return true;
 		}
@@ -346,34 +443,14 @@ bool SquareObject::contains(const coord::phys3 &other) const {
 	return false;
 }
 
-bool SquareObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
-	if (const SquareObject *sq = dynamic_cast<const SquareObject *>(&other)) {
-		tile_range rng = this->get_range(position);
-		return this->pos.end.ne < rng.start.ne
-		       || rng.end.ne < sq->pos.start.ne
-		       || rng.end.se < sq->pos.start.se
-		       || rng.end.se < sq->pos.start.se;
-	}
-	else if (const RadialObject *rad = dynamic_cast<const RadialObject *>(&other)) {
-		// clamp between start and end
-		tile_range rng = this->get_range(position);
-		coord::phys3 start_phys = rng.start.to_phys2().to_phys3() - phys_half_tile;
-		coord::phys3 end_phys = rng.end.to_phys2().to_phys3() - phys_half_tile;
-		coord::phys_t cx = std::max(start_phys.ne, std::min(end_phys.ne, rad->pos.draw.ne));
-		coord::phys_t cy = std::max(start_phys.se, std::min(end_phys.se, rad->pos.draw.se));
-
-		// distance to square object base
-		coord::phys_t dx = rad->pos.draw.ne - cx;
-		coord::phys_t dy = rad->pos.draw.se - cy;
-		return std::hypot(dx, dy) < rad->phys_radius;
-	}
-	return false;
-}
-
 coord::phys_t SquareObject::min_axis() const {
 	return std::min( this->size.ne, this->size.se ) * coord::settings::phys_per_tile;
 }
 
+bool SquareObject::covers_tiles() const {
+	return true;
+}
+
 RadialObject::RadialObject(Unit &u, float rad)
 	:
 	RadialObject(u, rad, radial_outline(rad)) {
@@ -381,7 +458,7 @@ RadialObject::RadialObject(Unit &u, float rad)
 
 RadialObject::RadialObject(Unit &u, float rad, std::shared_ptr<Texture> out_tex)
 	:
-	TerrainObject(u),
+	TerrainObject(u, object_shape::radial),
 	phys_radius(coord::settings::phys_per_tile * rad) {
 	this->outline_texture = out_tex;
 }
@@ -418,38 +495,22 @@ bool RadialObject::contains(const coord::phys3 &other) const {
 	return distance(this->pos.draw, other) < this->phys_radius;
 }
 
-bool RadialObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
-	if (const SquareObject *sq = dynamic_cast<const SquareObject *>(&other)) {
-		return sq->from_edge(position) < this->phys_radius;
-	}
-	else if (const RadialObject *rad = dynamic_cast<const RadialObject *>(&other)) {
-		return distance(position, rad->pos.draw) < this->phys_radius + rad->phys_radius;
-	}
-	return false;
-}
-
 coord::phys_t RadialObject::min_axis() const {
 	return this->phys_radius * 2;
 }
 
-std::vector<coord::tile> tile_list(const tile_range &rng) {
-	std::vector<coord::tile> tiles;
-
-	coord::tile check_pos = rng.start;
-	while (check_pos.ne < rng.end.ne) {
-		while (check_pos.se < rng.end.se) {
-			tiles.push_back(check_pos);
-			check_pos.se += 1;
-		}
-		check_pos.se = rng.start.se;
-		check_pos.ne += 1;
-	}
+bool RadialObject::covers_tiles() const {
+	return false;
+}
 
-	// a case when the objects radius is zero
-	if (tiles.empty()) {
-		tiles.push_back(rng.start);
+std::vector<coord::tile> tile_list(const tile_range &rng) {
+	TileSpan span{rng};
+	std::vector<coord::tile> result;
+	result.reserve(span.size());
+	for (coord::tile pos : span) {
+		result.push_back(pos);
 	}
-	return tiles;
+	return result;
 }
 
 tile_range building_center(coord::phys3 west, coord::tile_delta size) {
@@ -483,4 +544,19 @@ bool complete_building(Unit &u) {
 	return false;
 }
 
+std::function<bool(const coord::phys3 &)> collision_passable(TerrainObject *obj, Terrain *terrain) {
+	return [obj, terrain](const coord::phys3 &pos) -> bool {
+		for (coord::tile check_pos : tiles(obj->get_range(pos))) {
+			TileContent tc = terrain->get_data(check_pos);
+			if (not tc) {
+				return false;
+			}
+			if (obj->intersects_any(tc.obj, pos)) {
+				return false;
+			}
+		}
+		return true;
+	};
+}
+
 } // openage
@@ -1,4 +1,4 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -8,6 +8,7 @@
 #include "../pathfinding/path.h"
 #include "../coord/tile.h"
 #include "../coord/phys3.h"
+#include "terrain.h"
 
 namespace openage {
 
@@ -26,6 +27,15 @@ enum class object_state {
 	placed_no_collision
 };
 
+/**
+ * the shape of a terrain object, which selects the collision test
+ * between two objects without looking up their classes.
+ */
+enum class object_shape {
+	square,
+	radial,
+};
+
 /**
  * A rectangle or square of tiles which is the minimim
  * space to fit the units foundation or radius
@@ -38,10 +48,89 @@ struct tile_range {
 	coord::phys3 draw;	// gets used as center point of radial objects
 };
 
+/**
+ * the tiles of a tile_range, for iterating without storing them.
+ *
+ * yields the tiles between the start and end tiles, the end excluded,
+ * row by row along se. a range without tiles yields its start tile,
+ * like objects with zero radius occupy the tile they stand on.
+ */
+class TileSpan {
+public:
+	class iterator {
+	public:
+		iterator(coord::tile pos, coord::tile_t start_se, coord::tile_t end_se)
+			:
+			pos{pos},
+			start_se{start_se},
+			end_se{end_se} {}
+
+		const coord::tile &operator *() const {
+			return this->pos;
+		}
+
+		iterator &operator ++() {
+			this->pos.se += 1;
+			if (this->pos.se == this->end_se) {
+				this->pos.se = this->start_se;
+				this->pos.ne += 1;
+			}
+			return *this;
+		}
+
+		bool operator ==(const iterator &other) const {
+			return this->pos.ne == other.pos.ne and this->pos.se == other.pos.se;
+		}
+
+		bool operator !=(const iterator &other) const {
+			return not (*this == other);
+		}
+
+	private:
+		coord::tile pos;
+		coord::tile_t start_se;
+		coord::tile_t end_se;
+	};
+
+	TileSpan(const tile_range &rng)
+		:
+		first{rng.start},
+		last{rng.end} {
+
+		if (this->last.ne <= this->first.ne or this->last.se <= this->first.se) {
+			this->last = this->first + coord::tile_delta{1, 1};
+		}
+	}
+
+	iterator begin() const {
+		return {this->first, this->first.se, this->last.se};
+	}
+
+	iterator end() const {
+		return {coord::tile{this->last.ne, this->first.se}, this->first.se, this->last.se};
+	}
+
+	size_t size() const {
+		return (this->last.ne - this->first.ne) * (this->last.se - this->first.se);
+	}
+
+private:
+	// last is the first tile past the span on both axes
+	coord::tile first;
+	coord::tile last;
+};
+
 /**
  * get all tiles in the tile range -- useful for iterating
- * returns a flat list of tiles between the rectangle enclosed
- * by the tile_range start and end tiles
+ */
+inline TileSpan tiles(const tile_range &rng) {
+	return TileSpan{rng};
+}
+
+/**
+ * get all tiles in the tile range as a flat list,
+ * in the same order as tiles() iterates them.
+ * prefer tiles(), which does not allocate.
  */
 std::vector<coord::tile> tile_list(const tile_range &rng);
 
@@ -83,7 +172,7 @@ constexpr coord::phys3_delta phys_half_tile = coord::phys3_delta{
  */
 class TerrainObject : public std::enable_shared_from_this<TerrainObject> {
 public:
-	TerrainObject(Unit &u);
+	TerrainObject(Unit &u, object_shape shape);
 	TerrainObject(const TerrainObject &) = delete;	// disable copy constructor
 	TerrainObject(TerrainObject &&) = delete;	// disable move constructor
 	virtual ~TerrainObject();
@@ -101,6 +190,11 @@ public:
 	 */
 	Unit &unit;
 
+	/**
+	 * square for SquareObjects, radial for RadialObjects
+	 */
+	const object_shape shape;
+
 	/**
 	 * is the object a floating outline -- it is only an indicator
 	 * of where a building will be built, but not yet started building
@@ -127,6 +221,13 @@ public:
 	 */
 	std::function<bool(const coord::phys3 &)> passable;
 
+	/**
+	 * terrain ids this object may stand on, used for
+	 * hierarchical path searches. 0 if unknown, then only
+	 * the passable function can be used.
+	 */
+	terrain_mask_t allowed_terrain;
+
 	/**
 	 * specifies content to be drawn
 	 */
@@ -244,13 +345,41 @@ public:
 	/**
 	 * would this intersect with another object if it were positioned at the given point
 	 */
-	virtual bool intersects(const TerrainObject &other, const coord::phys3 &position) const = 0;
+	bool intersects(const TerrainObject &other, const coord::phys3 &position) const;
+
+	/**
+	 * would this intersect with any of the objects of a tile if it were
+	 * positioned at the given point. objects that don't check collisions,
+	 * this object itself and the ones for which ignore returns true are skipped.
+	 */
+	template <typename F>
+	bool intersects_any(const TileObjects &objects, const coord::phys3 &position, F ignore) const {
+		for (TerrainObject *other : objects) {
+			if (other != this and
+			    other->check_collisions() and
+			    not ignore(*other) and
+			    this->intersects(*other, position)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool intersects_any(const TileObjects &objects, const coord::phys3 &position) const {
+		return this->intersects_any(objects, position, [](const TerrainObject &) { return false; });
+	}
 
 	/**
 	 * the shortest line that can be placed across the objects center
 	 */
 	virtual coord::phys_t min_axis() const = 0;
 
+	/**
+	 * does this object block its whole tiles (e.g. buildings)
+	 * instead of only a part of them (e.g. moving units)
+	 */
+	virtual bool covers_tiles() const = 0;
+
 protected:
 	object_state state;
 
@@ -276,6 +405,16 @@ protected:
 	 * this does not modify the units placement state
 	 */
 	void place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &position);
+
+	/**
+	 * whether this object is relevant for the chunk path graphs.
+	 */
+	bool changes_chunks() const;
+
+	/**
+	 * tell the terrain that the tiles of this object changed.
+	 */
+	void notify_chunks() const;
 };
 
 /**
@@ -315,8 +454,8 @@ public:
 	coord::phys_t from_edge(const coord::phys3 &point) const override;
 	coord::phys3 on_edge(const coord::phys3 &angle, coord::phys_t extra=0) const override;
 	bool contains(const coord::phys3 &other) const override;
-	bool intersects(const TerrainObject &other, const coord::phys3 &position) const override;
 	coord::phys_t min_axis() const override;
+	bool covers_tiles() const override;
 
 private:
 	SquareObject(Unit &u, coord::tile_delta foundation_size);
@@ -348,8 +487,8 @@ public:
 	coord::phys_t from_edge(const coord::phys3 &point) const override;
 	coord::phys3 on_edge(const coord::phys3 &angle, coord::phys_t extra=0) const override;
 	bool contains(const coord::phys3 &other) const override;
-	bool intersects(const TerrainObject &other, const coord::phys3 &position) const override;
 	coord::phys_t min_axis() const override;
+	bool covers_tiles() const override;
 
 private:
 	RadialObject(Unit &u, float rad);
@@ -359,4 +498,11 @@ private:
 	friend class Unit;
 };
 
+/**
+ * passable function for objects that may stand on any terrain,
+ * positions are blocked only outside of the terrain and by the
+ * objects it would collide with there. the terrain must outlive it.
+ */
+std::function<bool(const coord::phys3 &)> collision_passable(TerrainObject *obj, Terrain *terrain);
+
 } // openage
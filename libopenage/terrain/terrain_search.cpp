@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <cmath>
 
@@ -9,48 +9,44 @@
 namespace openage {
 
 TerrainObject *find_near(const TerrainObject &start,
-                         std::function<bool(const TerrainObject &)> found,
+                         const object_filter &filter,
                          unsigned int search_limit) {
-
 	auto terrain = start.get_terrain();
-	auto tile = start.pos.draw.to_tile3().to_tile();
-	TerrainSearch search(terrain, tile);
+	if (not terrain) {
+		return nullptr;
+	}
 
-	for (unsigned int i = 0; i < search_limit; ++i) {
-		for (auto o : terrain->get_data(tile)->obj) {
+	// the radius of a circle with the area of search_limit tiles
+	coord::phys_t max_distance = std::sqrt(search_limit / M_PI) * coord::settings::phys_per_tile;
+	return terrain->get_object_index().nearest(start.pos.draw, max_distance, filter);
+}
 
-			// invalid pointers are removed when the object is deleted
-			if (found(*o)) {
-				return o;
-			}
-		}
-		tile = search.next_tile();
+TerrainObject *find_near(const TerrainObject &start,
+                         std::function<bool(const TerrainObject &)> found,
+                         unsigned int search_limit) {
+	object_filter filter;
+	filter.accept = found;
+	return find_near(start, filter, search_limit);
+}
+
+TerrainObject *find_in_radius(const TerrainObject &start,
+                              const object_filter &filter,
+                              float radius) {
+	auto terrain = start.get_terrain();
+	if (not terrain) {
+		return nullptr;
 	}
 
-	return nullptr;
+	coord::phys_t max_distance = radius * coord::settings::phys_per_tile;
+	return terrain->get_object_index().nearest(start.pos.draw, max_distance, filter);
 }
 
 TerrainObject *find_in_radius(const TerrainObject &start,
                               std::function<bool(const TerrainObject &)> found,
                               float radius) {
-	auto terrain = start.get_terrain();
-	coord::tile start_tile = start.pos.draw.to_tile3().to_tile();
-	TerrainSearch search(terrain, start_tile, radius);
-
-	// next_tile will first return the starting tile, so we need to run it once. We also
-	// shouldn't discard this tile - if it isn't useful, ignore it in found
-	coord::tile tile = search.next_tile();
-	do {
-		for (auto o : terrain->get_data(tile)->obj) {
-			if (found(*o)) {
-				return o;
-			}
-		}
-		tile = search.next_tile();
-		// coord::tile doesn't have a != operator, so we need to use !(a==b)
-	} while (!(tile == start_tile));
-
-	return nullptr;
+	object_filter filter;
+	filter.accept = found;
+	return find_in_radius(start, filter, radius);
 }
 
 TerrainSearch::TerrainSearch(std::shared_ptr<Terrain> t, coord::tile s)
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -9,15 +9,30 @@
 #include <vector>
 
 #include "../coord/tile.h"
+#include "object_index.h"
 
 namespace openage {
 
 class Terrain;
 class TerrainObject;
 
+/**
+ * the nearest object matching the filter, searched on the object index
+ * of the terrain within the area of about search_limit tiles.
+ */
+TerrainObject *find_near(const TerrainObject &start,
+                         const object_filter &filter,
+                         unsigned int search_limit=500);
 TerrainObject *find_near(const TerrainObject &start,
                          std::function<bool(const TerrainObject &)> found,
                          unsigned int search_limit=500);
+
+/**
+ * the nearest object matching the filter within a radius in tiles.
+ */
+TerrainObject *find_in_radius(const TerrainObject &start,
+                              const object_filter &filter,
+                              float radius);
 TerrainObject *find_in_radius(const TerrainObject &start,
                               std::function<bool(const TerrainObject &)> found,
                               float radius);
@@ -0,0 +1,211 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "../testing/testing.h"
+
+#include "terrain.h"
+#include "terrain_chunk.h"
+#include "terrain_object.h"
+
+namespace openage {
+namespace terrain {
+namespace tests {
+
+/**
+ * Side length of the benchmark terrains in tiles.
+ */
+constexpr coord::tile_t bench_size = 512;
+
+/**
+ * Terrain ids that differ between neighboring tiles.
+ */
+std::vector<int> bench_data() {
+	std::vector<int> data(bench_size * bench_size);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = i % 7;
+	}
+	return data;
+}
+
+/**
+ * Checks the object lists of tiles, which share the slot pool of their chunk.
+ */
+void tile_objects() {
+	TerrainChunk chunk;
+
+	// the objects are only compared, never accessed
+	TerrainObject *a = reinterpret_cast<TerrainObject *>(0x10);
+	TerrainObject *b = reinterpret_cast<TerrainObject *>(0x20);
+	TerrainObject *c = reinterpret_cast<TerrainObject *>(0x30);
+
+	TileContent tile = chunk.get_data(coord::tile{3, 5});
+	TileContent other = chunk.get_data(coord::tile{4, 5});
+	tile.obj.empty() or TESTFAIL;
+
+	tile.obj.push_back(a);
+	other.obj.push_back(c);
+	tile.obj.push_back(b);
+	tile.obj.push_back(c);
+	TESTEQUALS(tile.obj.size(), 3u);
+	TESTEQUALS(other.obj.size(), 1u);
+
+	// insertion order is kept
+	(tile.obj[0] == a and tile.obj[1] == b and tile.obj[2] == c) or TESTFAIL;
+
+	tile.obj.remove(b);
+	TESTEQUALS(tile.obj.size(), 2u);
+	(tile.obj[0] == a and tile.obj[1] == c) or TESTFAIL;
+
+	// the free slot is used again
+	other.obj.push_back(b);
+	(other.obj[0] == c and other.obj[1] == b) or TESTFAIL;
+
+	tile.obj.remove(a);
+	tile.obj.remove(c);
+	tile.obj.empty() or TESTFAIL;
+	TESTEQUALS(other.obj.size(), 2u);
+
+	tile.set_terrain_id(4);
+	TESTEQUALS(chunk.terrain_ids[5 * chunk_size + 3], 4);
+
+	(TileContent{} == nullptr) or TESTFAIL;
+	(tile != nullptr) or TESTFAIL;
+	TESTEQUALS(TileContent{}.get_terrain_id(), -1);
+	TESTTHROWS(TileContent{}.set_terrain_id(4));
+}
+
+/**
+ * Checks that the tiles of ranges are iterated like they were listed.
+ */
+void tile_spans() {
+	tile_range range{coord::tile{-1, 2}, coord::tile{1, 5}, coord::phys3{0, 0, 0}};
+	std::vector<coord::tile> expected{
+		{-1, 2}, {-1, 3}, {-1, 4},
+		{0, 2}, {0, 3}, {0, 4},
+	};
+
+	std::vector<coord::tile> iterated;
+	for (coord::tile pos : tiles(range)) {
+		iterated.push_back(pos);
+	}
+	(iterated == expected) or TESTFAIL;
+	(tile_list(range) == expected) or TESTFAIL;
+	TESTEQUALS(tiles(range).size(), 6u);
+
+	// ranges without tiles have their start tile
+	tile_range point{coord::tile{4, 4}, coord::tile{4, 7}, coord::phys3{0, 0, 0}};
+	std::vector<coord::tile> start{{4, 4}};
+	(tile_list(point) == start) or TESTFAIL;
+	TESTEQUALS(tiles(point).size(), 1u);
+}
+
+
+/**
+ * Checks that negative chunk coordinates don't collide in the hash
+ * and that finite terrains find the same tiles as infinite ones.
+ */
+void terrain_storage() {
+	std::unordered_set<size_t> hashes;
+	for (coord::chunk_t ne = -4; ne < 4; ne++) {
+		for (coord::chunk_t se = -4; se < 4; se++) {
+			hashes.insert(coord_chunk_hash{}(coord::chunk{ne, se}));
+		}
+	}
+	TESTEQUALS(hashes.size(), 64u);
+
+	Terrain infinite{nullptr, true};
+	Terrain finite{nullptr, coord::tile{-20, -20}, coord::tile{39, 39}};
+
+	for (coord::tile_t ne = -20; ne < 40; ne++) {
+		for (coord::tile_t se = -20; se < 40; se++) {
+			coord::tile pos{ne, se};
+			int id = (ne * 3 + se) & 0xf;
+			infinite.get_create_chunk(pos)->get_data(pos).set_terrain_id(id);
+			finite.get_create_chunk(pos)->get_data(pos).set_terrain_id(id);
+		}
+	}
+	TESTEQUALS(finite.used_chunks().size(), infinite.used_chunks().size());
+
+	for (coord::tile_t ne = -20; ne < 40; ne++) {
+		for (coord::tile_t se = -20; se < 40; se++) {
+			coord::tile pos{ne, se};
+			TESTEQUALS(finite.get_data(pos).get_terrain_id(), infinite.get_data(pos).get_terrain_id());
+		}
+	}
+
+	// alternate between terrains, so the chunk cache must tell them apart
+	coord::tile pos{3, 4};
+	infinite.get_data(pos).set_terrain_id(1);
+	finite.get_data(pos).set_terrain_id(2);
+	TESTEQUALS(infinite.get_data(pos).get_terrain_id(), 1);
+	TESTEQUALS(finite.get_data(pos).get_terrain_id(), 2);
+
+	// chunks attached after a missed lookup are found
+	coord::tile far{100, -100};
+	(infinite.get_data(far) == nullptr) or TESTFAIL;
+	infinite.get_create_chunk(far);
+	(infinite.get_data(far) != nullptr) or TESTFAIL;
+
+	// the finite terrain has no chunks outside of its limits
+	(finite.get_data(coord::tile{-40, 0}) == nullptr) or TESTFAIL;
+	(finite.get_chunk(coord::chunk{10, 0}) == nullptr) or TESTFAIL;
+	TESTTHROWS(finite.get_create_chunk(coord::chunk{10, 0}));
+
+	tile_objects();
+	tile_spans();
+}
+
+
+/**
+ * Reads terrain ids from all tiles in order, or from as many random tiles.
+ */
+void access_tiles(Terrain &terrain, bool random) {
+	int64_t sum = 0;
+	uint32_t state = 1;
+	for (coord::tile_t ne = 0; ne < bench_size; ne++) {
+		for (coord::tile_t se = 0; se < bench_size; se++) {
+			coord::tile pos{ne, se};
+			if (random) {
+				state = state * 1664525 + 1013904223;
+				pos.ne = (state >> 8) % bench_size;
+				pos.se = (state >> 20) % bench_size;
+			}
+			sum += terrain.get_data(pos).get_terrain_id();
+		}
+	}
+	(sum > 0) or TESTFAIL;
+}
+
+Terrain &bench_terrain(bool infinite) {
+	static std::vector<int> data = bench_data();
+	static Terrain infinite_terrain{nullptr, true};
+	static Terrain finite_terrain{nullptr, coord::tile{0, 0}, coord::tile{bench_size - 1, bench_size - 1}};
+	static bool filled = false;
+	if (not filled) {
+		infinite_terrain.fill(data.data(), coord::tile_delta{bench_size, bench_size});
+		finite_terrain.fill(data.data(), coord::tile_delta{bench_size, bench_size});
+		filled = true;
+	}
+	return infinite ? infinite_terrain : finite_terrain;
+}
+
+void benchmark_sequential_tile_access() {
+	access_tiles(bench_terrain(false), false);
+}
+
+void benchmark_random_tile_access() {
+	access_tiles(bench_terrain(false), true);
+}
+
+void benchmark_sequential_tile_access_infinite() {
+	access_tiles(bench_terrain(true), false);
+}
+
+void benchmark_random_tile_access_infinite() {
+	access_tiles(bench_terrain(true), true);
+}
+
+}}} // openage::terrain::tests
@@ -1,7 +1,8 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <memory>
 
+#include "../pathfinding/flow_field.h"
 #include "../terrain/terrain_object.h"
 #include "../gamestate/player.h"
 #include "ability.h"
@@ -82,7 +83,19 @@ void MoveAbility::invoke(Unit &to_modify, const Command &cmd, bool play_sound) {
 
 	if (cmd.has_position()) {
 		auto target = cmd.position();
-		to_modify.push_action(std::make_unique<MoveAction>(&to_modify, target));
+
+		// share the path of a group move
+		std::shared_ptr<path::FlowField> flow_field;
+		if (cmd.flow_fields()) {
+			flow_field = cmd.flow_fields()->get(to_modify.location.get());
+		}
+
+		if (flow_field) {
+			to_modify.push_action(std::make_unique<MoveAction>(&to_modify, target, flow_field));
+		}
+		else {
+			to_modify.push_action(std::make_unique<MoveAction>(&to_modify, target));
+		}
 	}
 	else if (cmd.has_unit()) {
 		auto target = cmd.unit();
@@ -4,7 +4,9 @@
 #include <cmath>
 
 #include "../pathfinding/a_star.h"
+#include "../pathfinding/flow_field.h"
 #include "../pathfinding/heuristics.h"
+#include "../pathfinding/path_service.h"
 #include "../terrain/terrain.h"
 #include "../terrain/terrain_search.h"
 #include "action.h"
@@ -63,8 +65,11 @@ UnitAction::UnitAction(Unit *u, graphic_type initial_gt)
 
 		// a random starting point for static graphics
 		// this creates variations in trees / houses etc
-		// this value is also deterministic to match across clients
-		this->frame = (u->id * u->id * 19249) & 0xff;
+		// this value is also deterministic to match across clients.
+		// the slot index is used, the generation in the lower half of
+		// the id is the same for most units.
+		uint64_t index = u->id >> 32;
+		this->frame = (index * index * 19249) & 0xff;
 	}
 }
 
@@ -98,6 +103,7 @@ void UnitAction::face_towards(const coord::phys3 pos) {
 
 bool UnitAction::damage_unit(Unit &target) {
 	bool killed = false;
+	target.wake();
 
 	if (target.has_attribute(attr_type::damaged)) {
 		auto &dm = target.get_attribute<attr_type::damaged>();
@@ -176,6 +182,8 @@ TargetAction::TargetAction(Unit *u, graphic_type gt, UnitReference r, coord::phy
 	end_action{false},
 	radius{rad} {
 
+	this->planned_distance.valid = false;
+
 	// update type
 	if (this->target.is_valid()) {
 		auto target_ptr = this->target.get();
@@ -191,6 +199,25 @@ TargetAction::TargetAction(Unit *u, graphic_type gt, UnitReference r)
 	TargetAction(u, gt, r, adjacent_range(u)) {
 }
 
+void TargetAction::think(unsigned int) {
+	this->planned_distance.valid = false;
+	if (!this->target.is_valid()) {
+		return;
+	}
+
+	auto target_ptr = this->target.get();
+	if (!target_ptr->location) {
+		return;
+	}
+
+	distance_plan &plan = this->planned_distance;
+	plan.target = this->target.get_id();
+	plan.from = this->entity->location->pos.draw;
+	plan.target_at = target_ptr->location->pos.draw;
+	plan.distance = target_ptr->location->from_edge(plan.from);
+	plan.valid = true;
+}
+
 void TargetAction::update(unsigned int time) {
 	auto target_ptr = update_distance();
 	if (!target_ptr) {
@@ -210,6 +237,9 @@ void TargetAction::update(unsigned int time) {
 		// the derived class controls what to
 		// do when in range of the target
 		this->update_in_range(time, target_ptr);
+
+		// the target may have been changed, so it checks its state again
+		target_ptr->wake();
 		this->repath_attempts = 10;
 	}
 	else if (this->repath_attempts) {
@@ -263,8 +293,19 @@ Unit *TargetAction::update_distance() {
 		return nullptr;
 	}
 
-	// update distance
-	this->dist_to_target = target_ptr->location->from_edge(this->entity->location->pos.draw);
+	// update distance, unless it was measured while thinking
+	// and neither of the units has moved since
+	const distance_plan &plan = this->planned_distance;
+	if (plan.valid &&
+	    plan.target == this->target.get_id() &&
+	    plan.from == this->entity->location->pos.draw &&
+	    plan.target_at == target_ptr->location->pos.draw) {
+		this->dist_to_target = plan.distance;
+	}
+	else {
+		this->dist_to_target = target_ptr->location->from_edge(this->entity->location->pos.draw);
+	}
+	this->planned_distance.valid = false;
 
 	// return the targeted unit
 	return target_ptr;
@@ -309,6 +350,17 @@ bool DecayAction::completed() const {
 	return this->frame > this->end_frame;
 }
 
+time_nsec_t DecayAction::sleep_time() const {
+	if (this->frame_rate <= 0) {
+		return sleep_until_woken;
+	}
+
+	// sleep until the next frame is drawn, or the last one is passed
+	float next_frame = std::min(std::floor(this->frame) + 1.0f, this->end_frame);
+	float remaining = (next_frame - this->frame) * 10000.0f / this->frame_rate;
+	return (static_cast<time_nsec_t>(std::max(remaining, 0.0f)) + 1) * 1000 * 1000;
+}
+
 DeadAction::DeadAction(Unit *e, std::function<void()> on_complete)
 	:
 	UnitAction(e, graphic_type::dying),
@@ -403,41 +455,48 @@ IdleAction::IdleAction(Unit *e)
 
 	// currently allow attack and heal automatically
 	this->auto_abilities = UnitAbility::set_from_list({ability_type::attack, ability_type::heal});
+
+	this->planned_target.valid = false;
+}
+
+void IdleAction::think(unsigned int time) {
+	this->planned_target.valid = false;
+	if (this->searches_targets()) {
+		this->planned_target.from = this->entity->location->pos.draw.to_tile3().to_tile();
+		this->planned_target.target = this->find_target();
+		this->planned_target.time = time;
+		this->planned_target.valid = true;
+	}
 }
 
 void IdleAction::update(unsigned int time) {
 
 	// auto task searching
-	if (this->entity->location &&
-	    this->entity->has_attribute(attr_type::owner) &&
-	    this->entity->has_attribute(attr_type::attack) &&
-	    this->entity->has_attribute(attr_type::formation) &&
-	    this->entity->get_attribute<attr_type::formation>().stance != attack_stance::do_nothing) {
-
-		// restart search from new tile when moved
-		auto terrain = this->entity->location->get_terrain();
-		auto current_tile = this->entity->location->pos.draw.to_tile3().to_tile();
-		if (!(current_tile == this->search->start_tile())) {
-			this->search = std::make_shared<TerrainSearch>(terrain, current_tile, 5.0f);
+	if (this->searches_targets()) {
+
+		// the tile was already searched while thinking
+		// if the unit is still where it searched from
+		const target_plan &plan = this->planned_target;
+		UnitReference target;
+		if (plan.valid &&
+		    plan.time == time &&
+		    plan.from == this->entity->location->pos.draw.to_tile3().to_tile()) {
+			target = plan.target;
+		}
+		else {
+			target = this->find_target();
 		}
 
-		// search one tile per update
-		// next tile will always be valid
-		coord::tile tile = this->search->next_tile();
-		auto tile_data = terrain->get_data(tile);
-		auto &player = this->entity->get_attribute<attr_type::owner>().player;
-
-		// find and actions which can be invoked
-		for (auto object_location : tile_data->obj) {
-			Command to_object(player, &object_location->unit);
-
-			// only allow abilities in the set of auto ability types
+		// an earlier update may have changed the target meanwhile,
+		// queuing checks the abilities again
+		if (target.is_valid()) {
+			auto &player = this->entity->get_attribute<attr_type::owner>().player;
+			Command to_object(player, target.get());
 			to_object.set_ability_set(auto_abilities);
-			if (this->entity->queue_cmd(to_object)) {
-				break;
-			}
+			this->entity->queue_cmd(to_object);
 		}
 	}
+	this->planned_target.valid = false;
 
 	// unit carrying ressources take the carrying sprite when idle
 	// we're not updating frames because the carying sprite is walking
@@ -458,6 +517,51 @@ void IdleAction::update(unsigned int time) {
 
 void IdleAction::on_completion() {}
 
+time_nsec_t IdleAction::sleep_time() const {
+	// static graphics and no targets to look for: nothing changes
+	// until a command arrives or another unit acts on this one
+	if (this->frame_rate == 0 && !this->searches_targets()) {
+		return sleep_until_woken;
+	}
+	return 0;
+}
+
+UnitReference IdleAction::find_target() {
+
+	// restart search from new tile when moved
+	auto terrain = this->entity->location->get_terrain();
+	auto current_tile = this->entity->location->pos.draw.to_tile3().to_tile();
+	if (!(current_tile == this->search->start_tile())) {
+		this->search = std::make_shared<TerrainSearch>(terrain, current_tile, 5.0f);
+	}
+
+	// search one tile per update
+	// next tile will always be valid
+	coord::tile tile = this->search->next_tile();
+	auto tile_data = terrain->get_data(tile);
+	auto &player = this->entity->get_attribute<attr_type::owner>().player;
+
+	// find the first object an action can be invoked on
+	for (auto object_location : tile_data.obj) {
+		Command to_object(player, &object_location->unit);
+
+		// only allow abilities in the set of auto ability types
+		to_object.set_ability_set(auto_abilities);
+		if (this->entity->find_ability(to_object)) {
+			return object_location->unit.get_ref();
+		}
+	}
+	return UnitReference{};
+}
+
+bool IdleAction::searches_targets() const {
+	return this->entity->location &&
+	       this->entity->has_attribute(attr_type::owner) &&
+	       this->entity->has_attribute(attr_type::attack) &&
+	       this->entity->has_attribute(attr_type::formation) &&
+	       this->entity->get_attribute<attr_type::formation>().stance != attack_stance::do_nothing;
+}
+
 bool IdleAction::completed() const {
 	if (this->entity->has_attribute(attr_type::damaged)) {
 		auto &dm = this->entity->get_attribute<attr_type::damaged>();
@@ -481,6 +585,18 @@ MoveAction::MoveAction(Unit *e, coord::phys3 tar, bool repath)
 	this->initialise();
 }
 
+MoveAction::MoveAction(Unit *e, coord::phys3 tar, std::shared_ptr<path::FlowField> flow_field)
+	:
+	UnitAction{e, graphic_type::walking},
+	unit_target{},
+	target(tar),
+	radius{path::path_grid_size},
+	flow_field{std::move(flow_field)},
+	allow_repath{true},
+	end_action{false} {
+	this->initialise();
+}
+
 MoveAction::MoveAction(Unit *e, UnitReference tar, coord::phys_t within_range)
 	:
 	UnitAction{e, graphic_type::walking},
@@ -493,6 +609,8 @@ MoveAction::MoveAction(Unit *e, UnitReference tar, coord::phys_t within_range)
 }
 
 void MoveAction::initialise() {
+	this->planned_step.valid = false;
+
 	// switch workers to the carrying graphic
 	if (this->entity->has_attribute(attr_type::worker)) {
 		auto &worker_resource = this->entity->get_attribute<attr_type::resource>();
@@ -513,7 +631,20 @@ void MoveAction::initialise() {
 
 MoveAction::~MoveAction() {}
 
+void MoveAction::think(unsigned int time) {
+	if (not this->path.waypoints.empty()) {
+		this->planned_step = this->plan_step(time);
+	}
+}
+
 void MoveAction::update(unsigned int time) {
+	bool path_changed = false;
+	if (this->pending_path and this->pending_path->is_ready()) {
+		this->path = std::move(this->pending_path->path);
+		this->pending_path.reset();
+		path_changed = true;
+	}
+
 	if (this->unit_target.is_valid()) {
 		// a unit is targeted, which may move
 		auto &target_object = this->unit_target.get()->location;
@@ -536,6 +667,7 @@ void MoveAction::update(unsigned int time) {
 		if (this->path.waypoints.empty() || std::hypot(tdx, tdy) > std::hypot(udx, udy)) {
 			this->target = target_pos;
 			this->set_path();
+			path_changed = true;
 		}
 	}
 
@@ -548,23 +680,71 @@ void MoveAction::update(unsigned int time) {
 		return;
 	}
 
+	// the step found while thinking is outdated
+	// if the path was changed or the unit was moved since
+	if (path_changed ||
+	    !this->planned_step.valid ||
+	    this->planned_step.time != time ||
+	    !(this->planned_step.from == this->entity->location->pos.draw)) {
+		this->planned_step = this->plan_step(time);
+	}
+	move_step step = this->planned_step;
+	this->planned_step.valid = false;
+
+	// remove the waypoints passed on the way
+	for (size_t i = 0; i < step.waypoints_reached; i++) {
+		this->path.waypoints.pop_back();
+	}
+
+	// check move collisions
+	bool move_completed = this->entity->location->move(step.position);
+	if (move_completed) {
+		this->entity->get_attribute<attr_type::direction>().unit_dir = step.direction;
+		this->set_distance();
+	}
+	else {
+		// cases for modifying path when blocked
+		if (this->allow_repath) {
+			this->entity->log(MSG(dbg) << "Path blocked -- finding new path");
+
+			// the flow field ignores moving units, search around them instead
+			this->flow_field.reset();
+			this->set_path();
+		}
+		else {
+			this->entity->log(MSG(dbg) << "Path blocked -- drop action");
+			this->end_action = true;
+		}
+	}
+
+	// inc frame
+	this->frame += time * this->frame_rate / 5.0f;
+}
+
+MoveAction::move_step MoveAction::plan_step(unsigned int time) const {
+	move_step step;
+	step.valid = true;
+	step.time = time;
+	step.waypoints_reached = 0;
+
 	// find distance to move in this update
 	auto &sp_attr = this->entity->get_attribute<attr_type::speed>();
 	coord::phys_t distance_to_move = sp_attr.unit_speed * time;
 
 	// current position and direction
-	coord::phys3 new_position = this->entity->location->pos.draw;
-	auto &d_attr = this->entity->get_attribute<attr_type::direction>();
-	coord::phys3_delta new_direction = d_attr.unit_dir;
+	step.from = this->entity->location->pos.draw;
+	step.position = step.from;
+	step.direction = this->entity->get_attribute<attr_type::direction>().unit_dir;
 
+	auto &waypoints = this->path.waypoints;
 	while (distance_to_move > 0) {
-		if (this->path.waypoints.empty()) {
+		if (step.waypoints_reached == waypoints.size()) {
 			break;
 		}
 
 		// find a point to move directly towards
-		coord::phys3 waypoint = this->next_waypoint();
-		coord::phys3_delta move_dir = waypoint - new_position;
+		coord::phys3 waypoint = waypoints[waypoints.size() - 1 - step.waypoints_reached].position;
+		coord::phys3_delta move_dir = waypoint - step.position;
 
 		// normalise dir
 		coord::phys_t distance_to_waypoint = (coord::phys_t) std::hypot(move_dir.ne, move_dir.se);
@@ -573,52 +753,35 @@ void MoveAction::update(unsigned int time) {
 			distance_to_move -= distance_to_waypoint;
 
 			// change entity position and direction
-			new_position = waypoint;
-			new_direction = move_dir;
+			step.position = waypoint;
+			step.direction = move_dir;
 
-			// remove the waypoint
-			this->path.waypoints.pop_back();
+			// pass the waypoint
+			step.waypoints_reached += 1;
 		}
 		else {
 			// distance_to_waypoint is larger so need to divide
 			move_dir = (move_dir * distance_to_move) / distance_to_waypoint;
 
 			// change entity position and direction
-			new_position += move_dir;
-			new_direction = move_dir;
+			step.position += move_dir;
+			step.direction = move_dir;
 			break;
 		}
 	}
-
-	// check move collisions
-	bool move_completed = this->entity->location->move(new_position);
-	if (move_completed) {
-		d_attr.unit_dir = new_direction;
-		this->set_distance();
-	}
-	else {
-		// cases for modifying path when blocked
-		if (this->allow_repath) {
-			this->entity->log(MSG(dbg) << "Path blocked -- finding new path");
-			this->set_path();
-		}
-		else {
-			this->entity->log(MSG(dbg) << "Path blocked -- drop action");
-			this->end_action = true;
-		}
-	}
-
-	// inc frame
-	this->frame += time * this->frame_rate / 5.0f;
+	return step;
 }
 
-void MoveAction::on_completion() {}
+void MoveAction::on_completion() {
+	this->flow_field.reset();
+}
 
 bool MoveAction::completed() const {
 
 	// no more waypoints to a static location
 	if (this->end_action ||
 	    (!this->unit_target.is_valid() &&
+	    !this->pending_path &&
 	    this->path.waypoints.empty())) {
 		return true;
 	}
@@ -645,9 +808,31 @@ void MoveAction::set_path() {
 		this->path = path::to_object(this->entity->location.get(), this->unit_target.get()->location.get(), this->radius);
 	}
 	else {
-		coord::phys3 start = this->entity->location->pos.draw;
-		coord::phys3 end = this->target;
-		this->path = path::to_point(start, end, this->entity->location->passable);
+		if (this->flow_field) {
+			this->path = this->flow_field->follow(this->entity->location->pos.draw, this->target);
+			if (not this->path.waypoints.empty()) {
+				return;
+			}
+
+			// this unit can't reach the target along the field
+			this->flow_field.reset();
+		}
+
+		path::PathService *service = nullptr;
+		if (this->entity->get_container()) {
+			service = this->entity->get_container()->get_path_service();
+		}
+
+		if (service) {
+			// keep following the current path until the new one arrives
+			if (not this->pending_path) {
+				this->pending_path = std::make_shared<path::PathRequest>(*this->entity->location, this->target);
+				service->request(this->pending_path);
+			}
+		}
+		else {
+			this->path = path::to_point(this->entity->location.get(), this->target);
+		}
 	}
 }
 
@@ -772,13 +957,24 @@ void TrainAction::update(unsigned int time) {
 			}
 		}
 		else {
-			this->train_percent += 0.001 * time;
+			this->train_percent += train_rate * time;
 		}
 	}
 }
 
 void TrainAction::on_completion() {}
 
+time_nsec_t TrainAction::sleep_time() const {
+	// waiting for population space, or placing the trained unit
+	if (!this->started || this->train_percent >= 1.0f) {
+		return 0;
+	}
+
+	// nothing happens until the training is done
+	float remaining = (1.0f - this->train_percent) / train_rate;
+	return (static_cast<time_nsec_t>(remaining) + 1) * 1000 * 1000;
+}
+
 BuildAction::BuildAction(Unit *e, UnitReference foundation)
 	:
 	TargetAction{e, graphic_type::work, foundation},
@@ -838,9 +1034,10 @@ void BuildAction::on_completion() {
 		return;
 	}
 	this->entity->log(MSG(dbg) << "Done building, searching for new building");
-	auto valid = [this](const TerrainObject &obj) {
-		if (!this->entity->get_attribute<attr_type::owner>().player.owns(obj.unit) ||
-		    !obj.unit.has_attribute(attr_type::building) ||
+	object_filter valid;
+	valid.owner = &this->entity->get_attribute<attr_type::owner>().player;
+	valid.accept = [this](const TerrainObject &obj) {
+		if (!obj.unit.has_attribute(attr_type::building) ||
 		    obj.unit.get_attribute<attr_type::building>().completed >= 1.0f) {
 			return false;
 		}
@@ -1059,19 +1256,19 @@ void GatherAction::on_completion_in_range(int target_type) {
 UnitReference GatherAction::nearest_dropsite(game_resource res_type) {
 
 	// find nearest dropsite from the targeted resource
-	auto ds = find_near(*this->target.get()->location,
-		[=](const TerrainObject &obj) {
+	object_filter own_dropsite;
+	own_dropsite.owner = &this->entity->get_attribute<attr_type::owner>().player;
+	own_dropsite.accept = [=](const TerrainObject &obj) {
 
-			if (not obj.unit.has_attribute(attr_type::building) or &obj.unit == this->entity or &obj.unit == this->target.get()) {
-				return false;
-			}
+		if (not obj.unit.has_attribute(attr_type::building) or &obj.unit == this->entity or &obj.unit == this->target.get()) {
+			return false;
+		}
 
-			return obj.unit.get_attribute<attr_type::building>().completed >= 1.0f &&
-			       obj.unit.has_attribute(attr_type::owner) &&
-			       obj.unit.get_attribute<attr_type::owner>().player.owns(*this->entity) &&
-			       obj.unit.has_attribute(attr_type::dropsite) &&
-			       obj.unit.get_attribute<attr_type::dropsite>().accepting_resource(res_type);
-	});
+		return obj.unit.get_attribute<attr_type::building>().completed >= 1.0f &&
+		       obj.unit.has_attribute(attr_type::dropsite) &&
+		       obj.unit.get_attribute<attr_type::dropsite>().accepting_resource(res_type);
+	};
+	auto ds = find_near(*this->target.get()->location, own_dropsite);
 
 	if (ds) {
 		return ds->unit.get_ref();
@@ -1110,7 +1307,10 @@ void AttackAction::update_in_range(unsigned int time, Unit *target_ptr) {
 	}
 
 	// inc frame
-	this->frame += time * this->current_graphics().at(graphic)->frame_count * this->rate_of_fire;
+	auto &g_set = this->current_graphics();
+	if (g_set.count(graphic) > 0) {
+		this->frame += time * g_set.at(graphic)->frame_count * this->rate_of_fire;
+	}
 }
 
 bool AttackAction::completed_in_range(Unit *target_ptr) const {
@@ -1176,7 +1376,10 @@ void HealAction::update_in_range(unsigned int time, Unit *target_ptr) {
 	}
 
 	// inc frame
-	this->frame += time * this->current_graphics().at(graphic)->frame_count * heal.rate;
+	auto &g_set = this->current_graphics();
+	if (g_set.count(graphic) > 0) {
+		this->frame += time * g_set.at(graphic)->frame_count * heal.rate;
+	}
 }
 
 bool HealAction::completed_in_range(Unit *target_ptr) const {
@@ -1263,9 +1466,9 @@ void ProjectileAction::update(unsigned int time) {
 
 		// find object which was hit
 		auto terrain = this->entity->location->get_terrain();
-		TileContent *tc = terrain->get_data(new_position.to_tile3().to_tile());
-		if (tc && !tc->obj.empty()) {
-			for (auto obj_location : tc->obj) {
+		TileContent tc = terrain->get_data(new_position.to_tile3().to_tile());
+		if (tc && !tc.obj.empty()) {
+			for (auto obj_location : tc.obj) {
 				if (this->entity->location.get() != obj_location &&
 				    obj_location->check_collisions()) {
 					this->damage_unit(obj_location->unit);
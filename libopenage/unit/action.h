@@ -13,6 +13,11 @@
 
 namespace openage {
 
+namespace path {
+class FlowField;
+class PathRequest;
+} // namespace path
+
 class TerrainSearch;
 
 /**
@@ -47,6 +52,20 @@ public:
 	 */
 	virtual void update(unsigned int) = 0;
 
+	/**
+	 * prepares the next update of this action, called with the same time
+	 * before it. the units think in parallel, so only the game state
+	 * may be read and only members of this action may be written.
+	 */
+	virtual void think(unsigned int) {}
+
+	/**
+	 * how long the unit can skip its updates while this action is on top,
+	 * 0 if it has to be updated, sleep_until_woken if only events wake it.
+	 * the first update after sleeping gets all the time that passed.
+	 */
+	virtual time_nsec_t sleep_time() const { return 0; }
+
 	/**
 	 * action to perform when popped from a units action stack
 	 */
@@ -166,6 +185,7 @@ public:
 	TargetAction(Unit *e, graphic_type gt, UnitReference r);
 	virtual ~TargetAction() {}
 
+	void think(unsigned int) override;
 	void update(unsigned int) override;
 	void on_completion() override;
 	bool completed() const override;
@@ -202,6 +222,20 @@ private:
 	 */
 	coord::phys_t dist_to_target, radius;
 
+	/**
+	 * distance to the target measured while thinking
+	 */
+	struct distance_plan {
+		bool valid;
+		id_t target;
+		coord::phys3 from;
+		coord::phys3 target_at;
+		coord::phys_t distance;
+	};
+
+	// used by the update if neither unit moved since
+	distance_plan planned_distance;
+
 };
 
 /**
@@ -218,6 +252,7 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "decay"; }
+	time_nsec_t sleep_time() const override;
 
 private:
 	float end_frame;
@@ -259,6 +294,7 @@ public:
 	bool allow_interupt() const override { return true; }
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "foundation"; }
+	time_nsec_t sleep_time() const override { return sleep_until_woken; }
 
 private:
 	bool add_destruct_effect, cancel;
@@ -273,18 +309,45 @@ public:
 	IdleAction(Unit *e);
 	virtual ~IdleAction() {}
 
+	void think(unsigned int) override;
 	void update(unsigned int) override;
 	void on_completion() override;
 	bool completed() const override;
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return true; }
 	std::string name() const override { return "idle"; }
+	time_nsec_t sleep_time() const override;
 
 private:
+	/**
+	 * whether the unit looks for targets of its auto abilities
+	 */
+	bool searches_targets() const;
+
+	/**
+	 * searches the next tile around the unit for an object that
+	 * an auto ability could target. only modifies the search.
+	 */
+	UnitReference find_target();
+
 	// look for auto task actions
 	std::shared_ptr<TerrainSearch> search;
 	ability_set auto_abilities;
 
+	/**
+	 * target found while thinking
+	 */
+	struct target_plan {
+		bool valid;
+		unsigned int time;
+		coord::tile from;
+		UnitReference target;
+	};
+
+	// the update commands the unit to it if
+	// the unit has not moved since
+	target_plan planned_target;
+
 };
 
 /**
@@ -297,12 +360,19 @@ public:
 	 */
 	MoveAction(Unit *e, coord::phys3 tar, bool repath=true);
 
+	/**
+	 * moves unit to a given fixed location along a flow field
+	 * shared with the other units of its group
+	 */
+	MoveAction(Unit *e, coord::phys3 tar, std::shared_ptr<path::FlowField> flow_field);
+
 	/**
 	 * moves a unit to within a distance to another unit
 	 */
 	MoveAction(Unit *e, UnitReference tar, coord::phys_t within_range);
 	virtual ~MoveAction();
 
+	void think(unsigned int) override;
 	void update(unsigned int) override;
 	void on_completion() override;
 	bool completed() const override;
@@ -321,13 +391,45 @@ private:
 
 	path::Path path;
 
+	// shared group flow field, released once it is no longer followed
+	std::shared_ptr<path::FlowField> flow_field;
+
+	// search running in the background, the current path
+	// is followed until it has finished
+	std::shared_ptr<path::PathRequest> pending_path;
+
 	// should a new path be found if unit gets blocked
 	bool allow_repath, end_action;
 
+	/**
+	 * where following the path for some time leads to
+	 */
+	struct move_step {
+		bool valid;
+		unsigned int time;
+		coord::phys3 from;
+		coord::phys3 position;
+		coord::phys3_delta direction;
+		size_t waypoints_reached;
+	};
+
+	// found while thinking, the update moves there if
+	// the unit and its path have not changed since
+	move_step planned_step;
+
 	void initialise();
 
 	/**
-	 * use a star to find a path to target
+	 * follows the path from the current position without
+	 * modifying anything, so it is safe to think with.
+	 */
+	move_step plan_step(unsigned int time) const;
+
+	/**
+	 * follow the flow field if there is one,
+	 * otherwise use a star to find a path to target.
+	 * searches to a fixed location run in the background
+	 * if the unit container provides a path service.
 	 */
 	void set_path();
 
@@ -388,12 +490,18 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return true; }
 	std::string name() const override { return "train"; }
+	time_nsec_t sleep_time() const override;
 
 private:
 	UnitType *trained;
 	bool started;
 	bool complete;
 	float train_percent;
+
+	/**
+	 * training progress per millisecond
+	 */
+	static constexpr float train_rate = 0.001f;
 };
 
 /**
@@ -2,9 +2,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bitset>
 #include <functional>
 #include <map>
-#include <algorithm>
 
 #include "../coord/tile.h"
 #include "../gamedata/unit.gen.h"
@@ -75,9 +76,20 @@ enum class attr_type {
 	resource,
 	worker,
 	multitype,
-	garrison
+	garrison,
+	MAX
 };
 
+/**
+ * number of attribute types, each has its own slot in Attributes
+ */
+constexpr int attr_type_size = static_cast<int>(attr_type::MAX);
+
+/**
+ * a container where each attribute type uses 1 bit
+ */
+using attr_set = std::bitset<attr_type_size>;
+
 /**
  * List of unit's attack stance.
  * Can be used for buildings also.
@@ -2,10 +2,64 @@
 
 #include "attributes.h"
 
+#include "../error/error.h"
+
 namespace openage {
 
+template<class F>
+void Attributes::for_each_in_place(F &&f) {
+	this->for_each_in_place(std::forward<F>(f),
+	                        std::make_index_sequence<std::tuple_size<decltype(this->in_place)>::value>{});
+}
+
+template<class F, size_t... I>
+void Attributes::for_each_in_place(F &&f, std::index_sequence<I...>) {
+	int expand[] = {0, (f(std::get<I>(this->in_place)), 0)...};
+	(void)expand;
+}
+
+Attributes::Attributes() {}
+
+Attributes::Attributes(const Attributes &other) {
+	this->add_copies(other);
+}
+
+Attributes &Attributes::operator =(const Attributes &other) {
+	if (this != &other) {
+		for (int i = 0; i < attr_type_size; i++) {
+			this->remove(static_cast<attr_type>(i));
+		}
+		this->add_copies(other);
+	}
+	return *this;
+}
+
+Attributes::~Attributes() {
+	this->for_each_in_place([this](auto &slot) {
+		if (this->present.test(static_cast<int>(slot.type))) {
+			slot.destroy();
+		}
+	});
+}
+
 void Attributes::add(const std::shared_ptr<AttributeContainer> attr) {
-	this->attrs[attr->type] = attr;
+	attr_type type = attr->type;
+	int index = static_cast<int>(type);
+	ENSURE(attr->shared() != attr_in_place(type), "attribute is stored in the wrong slot");
+
+	this->remove(type);
+	if (attr_in_place(type)) {
+		this->for_each_in_place([&attr, type](auto &slot) {
+			using attr_t = typename std::remove_reference<decltype(slot.get())>::type;
+			if (slot.type == type) {
+				slot.construct(*static_cast<const attr_t *>(attr.get()));
+			}
+		});
+	}
+	else {
+		this->shared_attrs[attr_shared_index(type)] = attr;
+	}
+	this->present.set(index);
 }
 
 void Attributes::add_copies(const Attributes &other) {
@@ -13,32 +67,73 @@ void Attributes::add_copies(const Attributes &other) {
 }
 
 void Attributes::add_copies(const Attributes &other, bool shared, bool unshared) {
-	for (auto &i : other.attrs) {
-		auto &attr = *i.second.get();
-
-		if (attr.shared()) {
-			if (shared) {
-				// pass self
-				this->add(i.second);
+	if (shared) {
+		// pass self
+		for (int i = 0; i < attr_type_size; i++) {
+			attr_type type = static_cast<attr_type>(i);
+			if (other.present.test(i) and not attr_in_place(type)) {
+				this->shared_attrs[attr_shared_index(type)] = other.shared_attrs[attr_shared_index(type)];
+				this->present.set(i);
 			}
 		}
-		else if (unshared) {
-			// create copy
-			this->add(attr.copy());
-		}
+	}
+
+	if (unshared) {
+		// copy into the own slots
+		this->for_each_in_place([this, &other](auto &slot) {
+			using slot_t = typename std::remove_reference<decltype(slot)>::type;
+			if (other.present.test(static_cast<int>(slot.type))) {
+				this->add(std::get<slot_t>(other.in_place).get());
+			}
+		});
 	}
 }
 
 bool Attributes::remove(const attr_type type) {
-	return this->attrs.erase(type) > 0;
+	int index = static_cast<int>(type);
+	bool removed = this->present.test(index);
+	if (not removed) {
+		return false;
+	}
+
+	if (attr_in_place(type)) {
+		this->for_each_in_place([type](auto &slot) {
+			if (slot.type == type) {
+				slot.destroy();
+			}
+		});
+	}
+	else {
+		this->shared_attrs[attr_shared_index(type)].reset();
+	}
+	this->present.reset(index);
+	return true;
 }
 
 bool Attributes::has(const attr_type type) const {
-	return this->attrs.find(type) != this->attrs.end();
+	return this->present.test(static_cast<int>(type));
+}
+
+AttributeContainer &Attributes::get(const attr_type type) {
+	if (not this->has(type)) {
+		this->missing(type);
+	}
+
+	if (not attr_in_place(type)) {
+		return *this->shared_attrs[attr_shared_index(type)];
+	}
+
+	AttributeContainer *result = nullptr;
+	this->for_each_in_place([&result, type](auto &slot) {
+		if (slot.type == type) {
+			result = &slot.get();
+		}
+	});
+	return *result;
 }
 
-std::shared_ptr<AttributeContainer> Attributes::get(const attr_type type) const {
-	return this->attrs.at(type);
+void Attributes::missing(const attr_type type) const {
+	throw Error{MSG(err) << "Attribute " << static_cast<int>(type) << " is not available"};
 }
 
 } // namespace openage
@@ -2,25 +2,114 @@
 
 #pragma once
 
-#include <map>
+#include <array>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
+#include "../util/compiler.h"
 #include "attribute.h"
 
 namespace openage {
 
+/**
+ * Whether attributes of the given type are stored in place in Attributes.
+ * These are the unshared ones, of which each unit has its own.
+ */
+constexpr bool attr_in_place(attr_type type) {
+	return (type == attr_type::damaged or
+	        type == attr_type::formation or
+	        type == attr_type::direction or
+	        type == attr_type::projectile or
+	        type == attr_type::building or
+	        type == attr_type::resource or
+	        type == attr_type::garrison);
+}
+
+/**
+ * Index of a shared attribute type among the shared ones.
+ */
+constexpr int attr_shared_index(attr_type type) {
+	int index = 0;
+	for (int i = 0; i < static_cast<int>(type); i++) {
+		if (not attr_in_place(static_cast<attr_type>(i))) {
+			index += 1;
+		}
+	}
+	return index;
+}
+
+/**
+ * number of shared attribute types
+ */
+constexpr int attr_shared_size = attr_shared_index(attr_type::MAX);
+
+/**
+ * Space for an unshared attribute inside of Attributes.
+ * Whether it holds an attribute is tracked by the Attributes.
+ */
+template<attr_type T>
+class AttributeSlot {
+	static_assert(attr_in_place(T), "only unshared attributes are stored in place");
+	static_assert(std::is_base_of<UnsharedAttributeContainer, Attribute<T>>::value,
+	              "attributes stored in place must be unshared");
+
+public:
+	static constexpr attr_type type = T;
+
+	Attribute<T> &get() {
+		return *reinterpret_cast<Attribute<T> *>(&this->storage);
+	}
+
+	const Attribute<T> &get() const {
+		return *reinterpret_cast<const Attribute<T> *>(&this->storage);
+	}
+
+	void construct(const Attribute<T> &attr) {
+		new (&this->storage) Attribute<T>(attr);
+	}
+
+	void destroy() {
+		this->get().~Attribute<T>();
+	}
+
+private:
+	typename std::aligned_storage<sizeof(Attribute<T>), alignof(Attribute<T>)>::type storage;
+};
+
 /**
  * Contains a group of attributes.
  * Can contain only one attribute of each type.
+ *
+ * Unshared attributes are stored in place, so units don't allocate them.
+ * Shared attributes are not copied, all units of a type point to
+ * the attribute of the type. Looking up either one is a single load.
  */
 class Attributes {
 public:
-	Attributes() {}
+	Attributes();
+	Attributes(const Attributes &other);
+	Attributes &operator =(const Attributes &other);
+	~Attributes();
 
 	/**
 	 * Add an attribute or replace any attribute of the same type.
+	 * Unshared attributes are copied into their slot.
 	 */
 	void add(const std::shared_ptr<AttributeContainer> attr);
 
+	/**
+	 * Add a copy of the attribute or replace any attribute of the same type.
+	 */
+	template<attr_type T>
+	void add(const Attribute<T> &attr) {
+		this->remove(T);
+		this->put(attr, std::integral_constant<bool, attr_in_place(T)>{});
+		this->present.set(static_cast<int>(T));
+	}
+
 	/**
 	 * Add copies of all the attributes from the given Attributes.
 	 */
@@ -46,19 +135,84 @@ public:
 	/**
 	 * Get the attribute based on the type.
 	 */
-	std::shared_ptr<AttributeContainer> get(const attr_type type) const;
+	AttributeContainer &get(const attr_type type);
 
 	/**
 	 * Get the attribute
 	 */
 	template<attr_type T>
-	Attribute<T> &get() const {
-		return *reinterpret_cast<Attribute<T> *>(this->attrs.at(T).get());
+	Attribute<T> &get() {
+		if (unlikely(not this->present.test(static_cast<int>(T)))) {
+			this->missing(T);
+		}
+		return this->slot<T>(std::integral_constant<bool, attr_in_place(T)>{});
+	}
+
+	template<attr_type T>
+	const Attribute<T> &get() const {
+		return const_cast<Attributes *>(this)->get<T>();
 	}
 
 private:
+	/**
+	 * Throws the error for accessing an attribute that doesn't exist.
+	 */
+	[[noreturn]] void missing(const attr_type type) const;
+
+	template<attr_type T>
+	Attribute<T> &slot(std::true_type /* in place */) {
+		return std::get<AttributeSlot<T>>(this->in_place).get();
+	}
+
+	template<attr_type T>
+	Attribute<T> &slot(std::false_type /* in place */) {
+		return *static_cast<Attribute<T> *>(this->shared_attrs[attr_shared_index(T)].get());
+	}
+
+	template<attr_type T>
+	void put(const Attribute<T> &attr, std::true_type /* in place */) {
+		std::get<AttributeSlot<T>>(this->in_place).construct(attr);
+	}
+
+	template<attr_type T>
+	void put(const Attribute<T> &attr, std::false_type /* in place */) {
+		this->shared_attrs[attr_shared_index(T)] = std::make_shared<Attribute<T>>(attr);
+	}
+
+	/**
+	 * Call the function with each slot of the attributes stored in place.
+	 */
+	template<class F>
+	void for_each_in_place(F &&f);
+
+	template<class F, size_t... I>
+	void for_each_in_place(F &&f, std::index_sequence<I...>);
+
+	/**
+	 * Types of the present attributes.
+	 */
+	attr_set present;
+
+	/**
+	 * The shared attributes, by attr_shared_index.
+	 */
+	std::array<std::shared_ptr<AttributeContainer>, attr_shared_size> shared_attrs;
+
+	/**
+	 * The unshared attributes.
+	 */
+	std::tuple<
+		AttributeSlot<attr_type::damaged>,
+		AttributeSlot<attr_type::formation>,
+		AttributeSlot<attr_type::direction>,
+		AttributeSlot<attr_type::projectile>,
+		AttributeSlot<attr_type::building>,
+		AttributeSlot<attr_type::resource>,
+		AttributeSlot<attr_type::garrison>
+	> in_place;
 
-	std::map<attr_type, std::shared_ptr<AttributeContainer>> attrs;
+	static_assert(std::tuple_size<decltype(in_place)>::value + attr_shared_size == attr_type_size,
+	              "each unshared attribute type needs a slot");
 };
 
 } // namespace openage
@@ -1,7 +1,9 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "command.h"
 
+#include "../pathfinding/flow_field.h"
+
 namespace openage {
 
 Command::Command(const Player &p, Unit *unit, bool haspos, UnitType *t)
@@ -86,4 +88,14 @@ bool Command::has_flag(command_flag flag) const {
 	return 0 < this->flags.count(flag);
 }
 
+void Command::set_group(const coord::tile &min, const coord::tile &max) {
+	if (this->has_pos) {
+		this->group_flow_fields = std::make_shared<path::FlowFieldGroup>(this->pos, min, max);
+	}
+}
+
+path::FlowFieldGroup *Command::flow_fields() const {
+	return this->group_flow_fields.get();
+}
+
 } // namespace openage
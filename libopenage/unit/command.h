@@ -2,9 +2,11 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_set>
 
 #include "../coord/phys3.h"
+#include "../coord/tile.h"
 #include "ability.h"
 
 namespace openage {
@@ -39,6 +41,10 @@ struct hash<openage::command_flag> {
 
 namespace openage {
 
+namespace path {
+class FlowFieldGroup;
+} // namespace path
+
 class Player;
 class Unit;
 class UnitType;
@@ -111,6 +117,18 @@ public:
 	 */
 	bool has_flag(command_flag flag) const;
 
+	/**
+	 * the command is issued to a group of units standing in the
+	 * given tile area, so moving to the position can share flow fields.
+	 */
+	void set_group(const coord::tile &min, const coord::tile &max);
+
+	/**
+	 * flow fields shared by the units of this command,
+	 * nullptr if it is not a group command to a position.
+	 */
+	path::FlowFieldGroup *flow_fields() const;
+
 	/**
 	 * player who created the command
 	 */
@@ -138,6 +156,11 @@ private:
 	 */
 	ability_set modifiers;
 
+	/**
+	 * shared by all copies of this command, queued by the units
+	 */
+	std::shared_ptr<path::FlowFieldGroup> group_flow_fields;
+
 };
 
 } // namespace openage
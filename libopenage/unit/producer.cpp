@@ -3,6 +3,7 @@
 #include <initializer_list>
 
 #include "../gamedata/unit.gen.h"
+#include "../pathfinding/hierarchy.h"
 #include "../terrain/terrain.h"
 #include "../terrain/terrain_object.h"
 #include "../terrain/terrain_outline.h"
@@ -192,30 +193,30 @@ void ObjectProducer::initialise(Unit *unit, Player &player) {
 	// hitpoints if available
 	if (this->unit_data.hit_points > 0) {
 		unit->add_attribute(std::make_shared<Attribute<attr_type::hitpoints>>(this->unit_data.hit_points));
-		unit->add_attribute(std::make_shared<Attribute<attr_type::damaged>>(this->unit_data.hit_points));
+		unit->add_attribute(Attribute<attr_type::damaged>(this->unit_data.hit_points));
 	}
 
 	// collectable resources
 	if (this->unit_data.unit_class == gamedata::unit_classes::TREES) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::wood, 125));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::wood, 125));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::BERRY_BUSH) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 100));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::food, 100));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::SEA_FISH) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 200));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::food, 200));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::PREY_ANIMAL) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 140));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::food, 140));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::SHEEP) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 100));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::food, 100));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::GOLD_MINE) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::gold, 800));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::gold, 800));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::STONE_MINE) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::stone, 350));
+		unit->add_attribute(Attribute<attr_type::resource>(game_resource::stone, 350));
 	}
 
 	// decaying units have a timed lifespan
@@ -265,6 +266,14 @@ TerrainObject *ObjectProducer::place(Unit *u, std::shared_ptr<Terrain> terrain,
 
 	// find set of allowed terrains
 	std::unordered_set<terrain_t> terrains = allowed_terrains(this->unit_data.terrain_restriction);
+	for (terrain_t id : terrains) {
+		if (not fits_terrain_mask(id)) {
+			log::log(MSG(warn) << "terrain id " << id << " of " << this->name()
+			         << " does not fit into a terrain mask, the unit can't enter it");
+			continue;
+		}
+		u->location->allowed_terrain |= terrain_mask_t{1} << id;
+	}
 
 	/*
 	 * decide what terrain is passable using this lambda
@@ -273,29 +282,33 @@ TerrainObject *ObjectProducer::place(Unit *u, std::shared_ptr<Terrain> terrain,
 	 */
 	TerrainObject *obj_ptr = u->location.get();
 	std::weak_ptr<Terrain> terrain_ptr = terrain;
-	u->location->passable = [obj_ptr, terrain_ptr, terrains](const coord::phys3 &pos) -> bool {
+
+	// invalid tile types and buildings are in the passability bitmaps,
+	// which the game thread keeps up to date. the lambda only reads them.
+	const path::Hierarchy *bitmaps = &terrain->get_path_hierarchy(u->location->allowed_terrain);
+	u->location->passable = [obj_ptr, terrain_ptr, bitmaps](const coord::phys3 &pos) -> bool {
 
 		// if location is deleted, then so is this lambda (deleting terrain implies location is deleted)
 		// so locking objects here will not return null
 		auto terrain = terrain_ptr.lock();
 
 		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
-
-			// invalid tile types
-			if (!tc || terrains.count(tc->terrain_id) == 0) {
+		for (coord::tile check_pos : tiles(obj_ptr->get_range(pos))) {
+			if (not bitmaps->tile_passable(check_pos, obj_ptr)) {
 				return false;
 			}
 
-			// compare with objects intersecting the units tile
+			// compare with moving objects intersecting the units tile
 			// ensure no intersections with other objects
-			for (auto obj_cmp : tc->obj) {
-				if (obj_ptr != obj_cmp &&
-				    obj_cmp->check_collisions() &&
-				    obj_ptr->intersects(*obj_cmp, pos)) {
-					return false;
-				}
+			TileContent tc = terrain->get_data(check_pos);
+			if (!tc) {
+				return false;
+			}
+			auto covers_tiles = [](const TerrainObject &obj_cmp) {
+				return obj_cmp.covers_tiles();
+			};
+			if (obj_ptr->intersects_any(tc.obj, pos, covers_tiles)) {
+				return false;
 			}
 		}
 		return true;
@@ -369,7 +382,7 @@ void MovableProducer::initialise(Unit *unit, Player &player) {
 	 * basic attributes
 	 */
 	if (!unit->has_attribute(attr_type::direction)) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{ 1, 0, 0 }));
+		unit->add_attribute(Attribute<attr_type::direction>(coord::phys3_delta{ 1, 0, 0 }));
 	}
 
 	/*
@@ -390,7 +403,7 @@ void MovableProducer::initialise(Unit *unit, Player &player) {
 	else {
 		unit->add_attribute(std::make_shared<Attribute<attr_type::attack>>(nullptr, 0, 0, 1));
 	}
-	unit->add_attribute(std::make_shared<Attribute<attr_type::formation>>());
+	unit->add_attribute(Attribute<attr_type::formation>{});
 }
 
 TerrainObject *MovableProducer::place(Unit *unit, std::shared_ptr<Terrain> terrain, coord::phys3 init_pos) const {
@@ -423,7 +436,7 @@ void LivingProducer::initialise(Unit *unit, Player &player) {
 	// add worker attributes
 	if (this->unit_data.unit_class == gamedata::unit_classes::CIVILIAN) {
 		unit->add_attribute(std::make_shared<Attribute<attr_type::worker>>());
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>());
+		unit->add_attribute(Attribute<attr_type::resource>{});
 		unit->add_attribute(std::make_shared<Attribute<attr_type::multitype>>());
 
 		// add graphic ids for resource actions
@@ -466,7 +479,7 @@ void LivingProducer::initialise(Unit *unit, Player &player) {
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::FISHING_BOAT) {
 		unit->add_attribute(std::make_shared<Attribute<attr_type::worker>>());
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>());
+		unit->add_attribute(Attribute<attr_type::resource>{});
 
 		// add fishing abilites
 		auto &worker_attr = unit->get_attribute<attr_type::worker>();
@@ -560,17 +573,17 @@ void BuildingProducer::initialise(Unit *unit, Player &player) {
 	unit->add_attribute(player_attr);
 
 	// building specific attribute
-	auto build_attr = std::make_shared<Attribute<attr_type::building>>();
-	build_attr->foundation_terrain = this->foundation_terrain;
-	build_attr->pp = this->owner.get_type(293); // fem_villager, male is 83
-	build_attr->gather_point = unit->location->pos.draw;
-	build_attr->completion_state = this->enable_collisions? object_state::placed : object_state::placed_no_collision;
+	Attribute<attr_type::building> build_attr;
+	build_attr.foundation_terrain = this->foundation_terrain;
+	build_attr.pp = this->owner.get_type(293); // fem_villager, male is 83
+	build_attr.gather_point = unit->location->pos.draw;
+	build_attr.completion_state = this->enable_collisions? object_state::placed : object_state::placed_no_collision;
 	unit->add_attribute(build_attr);
 
 	// garrison and hp for all buildings
-	unit->add_attribute(std::make_shared<Attribute<attr_type::garrison>>());
+	unit->add_attribute(Attribute<attr_type::garrison>{});
 	unit->add_attribute(std::make_shared<Attribute<attr_type::hitpoints>>(this->unit_data.hit_points));
-	unit->add_attribute(std::make_shared<Attribute<attr_type::damaged>>(this->unit_data.hit_points));
+	unit->add_attribute(Attribute<attr_type::damaged>(this->unit_data.hit_points));
 
 	// population
 	if (this->id() == 109 || this->id() == 70) { // Town center, House
@@ -588,7 +601,7 @@ void BuildingProducer::initialise(Unit *unit, Player &player) {
 		coord::phys_t range_phys = coord::settings::phys_per_tile * this->unit_data.weapon_range_max;
 		unit->add_attribute(std::make_shared<Attribute<attr_type::attack>>(proj_type, range_phys, 350000, 1));
 		// formation is used only for the attack_stance
-		unit->add_attribute(std::make_shared<Attribute<attr_type::formation>>(attack_stance::aggresive));
+		unit->add_attribute(Attribute<attr_type::formation>(attack_stance::aggresive));
 		unit->give_ability(std::make_shared<AttackAbility>());
 	}
 
@@ -652,12 +665,12 @@ TerrainObject *BuildingProducer::place(Unit *u, std::shared_ptr<Terrain> terrain
 		auto terrain = terrain_ptr.lock();
 
 		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
+		for (coord::tile check_pos : tiles(obj_ptr->get_range(pos))) {
+			TileContent tc = terrain->get_data(check_pos);
 			if (!tc) {
 				return false;
 			}
-			for (auto tobj : tc->obj) {
+			for (auto tobj : tc.obj) {
 				if (tobj->check_collisions()) return false;
 			}
 		}
@@ -787,8 +800,8 @@ void ProjectileProducer::initialise(Unit *unit, Player &player) {
 	// projectile speed
 	coord::phys_t sp = this->unit_data.speed * coord::settings::phys_per_tile / 666;
 	unit->add_attribute(std::make_shared<Attribute<attr_type::speed>>(sp));
-	unit->add_attribute(std::make_shared<Attribute<attr_type::projectile>>(this->unit_data.projectile_arc));
-	unit->add_attribute(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{ 1, 0, 0 }));
+	unit->add_attribute(Attribute<attr_type::projectile>(this->unit_data.projectile_arc));
+	unit->add_attribute(Attribute<attr_type::direction>(coord::phys3_delta{ 1, 0, 0 }));
 
 	// if destruction graphic is available
 	if (this->destroyed) {
@@ -826,18 +839,16 @@ TerrainObject *ProjectileProducer::place(Unit *u, std::shared_ptr<Terrain> terra
 		}
 
 		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
+		for (coord::tile check_pos : tiles(obj_ptr->get_range(pos))) {
+			TileContent tc = terrain->get_data(check_pos);
 			if (!tc) return false;
 
 			// ensure no intersections with other objects
-			for (auto obj_cmp : tc->obj) {
-				if (obj_ptr != obj_cmp &&
-				    &obj_cmp->unit != launcher &&
-				    obj_cmp->check_collisions() &&
-				    obj_ptr->intersects(*obj_cmp, pos)) {
-					return false;
-				}
+			auto is_launcher = [launcher](const TerrainObject &obj_cmp) {
+				return &obj_cmp.unit == launcher;
+			};
+			if (obj_ptr->intersects_any(tc.obj, pos, is_launcher)) {
+				return false;
 			}
 		}
 		return true;
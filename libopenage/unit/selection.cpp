@@ -2,6 +2,7 @@
 
 #include "selection.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "../coord/tile.h"
@@ -248,10 +249,10 @@ void UnitSelection::select_space(const Player &player, Terrain *terrain, coord::
 
 	// look at each tile in the range and find all units
 	for (coord::tile check_pos : tiles_in_range(p1, p2)) {
-		TileContent *tc = terrain->get_data(check_pos);
+		TileContent tc = terrain->get_data(check_pos);
 		if (tc) {
 			// find objects within selection box
-			for (auto unit_location : tc->obj) {
+			for (auto unit_location : tc.obj) {
 				coord::camgame pos = unit_location->pos.draw.to_camgame();
 				if ((min.x < pos.x && pos.x < max.x) &&
 				     (min.y < pos.y && pos.y < max.y)) {
@@ -263,6 +264,33 @@ void UnitSelection::select_space(const Player &player, Terrain *terrain, coord::
 }
 
 void UnitSelection::all_invoke(Command &cmd) {
+
+	// own units moving together follow one shared flow field
+	// instead of searching a path each.
+	if (cmd.has_position() and this->units.size() > 1) {
+		coord::tile min, max;
+		size_t own_units = 0;
+		for (auto u : this->units) {
+			if (not u.second.is_valid() or
+			    not u.second.get()->is_own_unit(cmd.player) or
+			    not u.second.get()->location) {
+				continue;
+			}
+			coord::tile pos = u.second.get()->location->pos.draw.to_tile3().to_tile();
+			if (own_units == 0) {
+				min = max = pos;
+			}
+			min.ne = std::min(min.ne, pos.ne);
+			min.se = std::min(min.se, pos.se);
+			max.ne = std::max(max.ne, pos.ne);
+			max.se = std::max(max.se, pos.se);
+			own_units += 1;
+		}
+		if (own_units > 1) {
+			cmd.set_group(min, max);
+		}
+	}
+
 	for (auto u : this->units) {
 		if (u.second.is_valid() && u.second.get()->is_own_unit(cmd.player)) {
 
@@ -321,7 +349,7 @@ selection_type_t UnitSelection::get_unit_selection_type(const Player &player, Un
 	}
 }
 
-std::vector<coord::tile> tiles_in_range(coord::camgame p1, coord::camgame p2) {
+TileSpan tiles_in_range(coord::camgame p1, coord::camgame p2) {
 	// the remaining corners
 	coord::camgame p3 = coord::camgame{p1.x, p2.y};
 	coord::camgame p4 = coord::camgame{p2.x, p1.y};
@@ -339,18 +367,8 @@ std::vector<coord::tile> tiles_in_range(coord::camgame p1, coord::camgame p2) {
 		max.se = std::max(max.se, t.se);
 	}
 
-	// find all units in the boxed region
-	std::vector<coord::tile> tiles;
-	coord::tile check_pos = min;
-	while (check_pos.ne <= max.ne) {
-		while (check_pos.se <= max.se) {
-			tiles.push_back(check_pos);
-			check_pos.se += 1;
-		}
-		check_pos.se = min.se;
-		check_pos.ne += 1;
-	}
-	return tiles;
+	// the boxed region, including the tiles at its far edges
+	return tile_range{min, max + coord::tile_delta{1, 1}, coord::phys3{0, 0, 0}};
 }
 
 } /* namespace openage */
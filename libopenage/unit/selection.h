@@ -1,11 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include "../coord/camgame.h"
 #include "../handlers.h"
+#include "../terrain/terrain_object.h"
 #include "ability.h"
 #include "unit_container.h"
 
@@ -14,7 +16,10 @@ namespace openage {
 class Engine;
 class Terrain;
 
-std::vector<coord::tile> tiles_in_range(coord::camgame p1, coord::camgame p2);
+/**
+ * the tiles below the screen rectangle between the given corners
+ */
+TileSpan tiles_in_range(coord::camgame p1, coord::camgame p2);
 
 /**
  * A selection of units always has a type
@@ -0,0 +1,384 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../gamestate/player.h"
+#include "../job/job_manager.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../testing/testing.h"
+#include "action.h"
+#include "unit.h"
+#include "unit_container.h"
+#include "unit_type.h"
+
+namespace openage {
+namespace unit {
+namespace tests {
+
+/**
+ * Lets units walk towards each other in lanes, so that they block
+ * each other depending on the order of their updates.
+ *
+ * @returns a hash of the unit positions after some updates.
+ */
+size_t walk_lanes(job::JobManager *think_workers) {
+	constexpr coord::tile_t size = 24;
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+
+	auto terrain = std::make_shared<Terrain>(nullptr, coord::tile{0, 0}, coord::tile{size - 1, size - 1});
+	std::vector<int> data(size * size, 0);
+	terrain->fill(data.data(), coord::tile_delta{size, size});
+
+	UnitContainer container;
+	container.set_terrain(terrain);
+	container.set_think_workers(think_workers);
+
+	Player player{nullptr, 1, "walker"};
+	NyanType type{player};
+	type.default_attributes.add(std::make_shared<Attribute<attr_type::speed>>(tile / 200));
+	type.default_attributes.add(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{1, 0, 0}));
+
+	for (coord::tile_t lane = 2; lane < size - 2; lane += 2) {
+		for (coord::tile_t depth = 0; depth < 8; depth++) {
+			// half of the units walk in the opposite direction
+			coord::tile_t first = 2 + depth / 2;
+			coord::tile_t last = size - 3 - depth / 2;
+			bool forward = (depth % 2 == 0);
+			coord::tile start{forward ? first : last, lane};
+			coord::tile end{forward ? last : first, lane};
+			coord::phys3 start_pos = start.to_tile3().to_phys3();
+			coord::phys3 end_pos = end.to_tile3().to_phys3();
+
+			Unit *unit = container.new_unit().get();
+			unit->make_location<RadialObject>(0.4f, nullptr);
+
+			TerrainObject *location = unit->location.get();
+			location->allowed_terrain = ~terrain_mask_t{0};
+			location->passable = collision_passable(location, terrain.get());
+
+			location->place(terrain, start_pos, object_state::placed) or TESTFAIL;
+
+			// the idle action keeps the units in the container after arriving
+			type.initialise(unit, player);
+			unit->push_action(std::make_unique<MoveAction>(unit, end_pos, false));
+		}
+	}
+
+	for (int i = 0; i < 40; i++) {
+		container.update_all(50 * 1000 * 1000);
+	}
+
+	size_t hash = 0;
+	auto combine = [&hash](size_t value) {
+		hash = hash * 1000003 ^ value;
+	};
+	for (Unit *unit : container.all_units()) {
+		combine(unit->id);
+		combine(unit->location->pos.draw.ne);
+		combine(unit->location->pos.draw.se);
+		combine(std::hash<std::string>{}(unit->top()->name()));
+	}
+	return hash;
+}
+
+/**
+ * The updates have the same result, however many workers the units think on.
+ */
+void update_determinism() {
+	size_t serial = walk_lanes(nullptr);
+
+	job::JobManager manager{4};
+	manager.start();
+	size_t parallel = walk_lanes(&manager);
+	size_t again = walk_lanes(&manager);
+	manager.stop();
+
+	TESTEQUALS(serial, parallel);
+	TESTEQUALS(serial, again);
+}
+
+/**
+ * Sleeps for a fixed time after each update, sums the time it gets.
+ */
+class NapAction : public UnitAction {
+public:
+	NapAction(Unit *u, time_nsec_t nap)
+		:
+		UnitAction{u, graphic_type::standing},
+		nap{nap},
+		updates{0},
+		elapsed{0} {}
+
+	void update(unsigned int time) override {
+		this->updates += 1;
+		this->elapsed += time;
+	}
+	void on_completion() override {}
+	bool completed() const override { return false; }
+	bool allow_interupt() const override { return true; }
+	bool allow_control() const override { return true; }
+	std::string name() const override { return "nap"; }
+	time_nsec_t sleep_time() const override { return this->nap; }
+
+	time_nsec_t nap;
+	int updates;
+	unsigned int elapsed;
+};
+
+/**
+ * Sleeping units are skipped until their timer runs out or they are woken,
+ * then they get the time that passed meanwhile.
+ */
+void unit_sleeping() {
+	constexpr time_nsec_t ms = 1000 * 1000;
+
+	auto terrain = std::make_shared<Terrain>(nullptr, coord::tile{0, 0}, coord::tile{7, 7});
+	std::vector<int> data(8 * 8, 0);
+	terrain->fill(data.data(), coord::tile_delta{8, 8});
+
+	UnitContainer container;
+	container.set_terrain(terrain);
+
+	Player player{nullptr, 1, "sleeper"};
+	NyanType type{player};
+
+	coord::phys3 position = coord::tile{3, 3}.to_tile3().to_phys3();
+	Unit *unit = container.new_unit().get();
+	unit->make_location<RadialObject>(0.4f, nullptr);
+	unit->location->place(terrain, position, object_state::placed) or TESTFAIL;
+	type.initialise(unit, player);
+
+	// idle units without animation sleep until they are woken
+	container.update_all(50 * ms);
+	TESTEQUALS(container.awake_count(), 0);
+
+	auto nap = std::make_unique<NapAction>(unit, 200 * ms);
+	NapAction *napping = nap.get();
+	unit->push_action(std::move(nap), true);
+
+	// updated at 100, sleeps until 300
+	for (int i = 0; i < 4; i++) {
+		container.update_all(50 * ms);
+	}
+	TESTEQUALS(napping->updates, 1);
+	TESTEQUALS(napping->elapsed, 50u);
+
+	container.update_all(50 * ms);
+	TESTEQUALS(napping->updates, 2);
+	TESTEQUALS(napping->elapsed, 250u);
+
+	// the timer at 500 is dropped when the unit is woken before
+	napping->nap = sleep_until_woken;
+	container.update_all(50 * ms);
+	unit->wake();
+	container.update_all(50 * ms);
+	TESTEQUALS(napping->updates, 3);
+	TESTEQUALS(napping->elapsed, 350u);
+
+	for (int i = 0; i < 10; i++) {
+		container.update_all(50 * ms);
+	}
+	TESTEQUALS(napping->updates, 3);
+	TESTEQUALS(container.awake_count(), 0);
+	TESTEQUALS(container.size(), 1);
+}
+
+/**
+ * Moving units are drawn between their positions before and after
+ * the last update, units that didn't move where they are.
+ */
+void unit_draw_position() {
+	constexpr time_nsec_t ms = 1000 * 1000;
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+
+	auto terrain = std::make_shared<Terrain>(nullptr, coord::tile{0, 0}, coord::tile{15, 15});
+	std::vector<int> data(16 * 16, 0);
+	terrain->fill(data.data(), coord::tile_delta{16, 16});
+
+	UnitContainer container;
+	container.set_terrain(terrain);
+
+	Player player{nullptr, 1, "walker"};
+	NyanType type{player};
+	type.default_attributes.add(std::make_shared<Attribute<attr_type::speed>>(tile / 200));
+	type.default_attributes.add(Attribute<attr_type::direction>{coord::phys3_delta{1, 0, 0}});
+
+	coord::phys3 start = coord::tile{2, 2}.to_tile3().to_phys3();
+	Unit *unit = container.new_unit().get();
+	unit->make_location<RadialObject>(0.4f, nullptr);
+	unit->location->place(terrain, start, object_state::placed) or TESTFAIL;
+	type.initialise(unit, player);
+	(unit->draw_position() == start) or TESTFAIL;
+
+	coord::phys3 end = coord::tile{12, 2}.to_tile3().to_phys3();
+	unit->push_action(std::make_unique<MoveAction>(unit, end, false));
+	container.update_all(50 * ms);
+	coord::phys3 moved = unit->location->pos.draw;
+	(not (moved == start)) or TESTFAIL;
+
+	container.set_interpolation(0.0f);
+	(unit->draw_position() == start) or TESTFAIL;
+	container.set_interpolation(1.0f);
+	(unit->draw_position() == moved) or TESTFAIL;
+	container.set_interpolation(0.5f);
+	coord::phys3 half = unit->draw_position();
+	TESTEQUALS(half.ne, start.ne + (moved.ne - start.ne) / 2);
+	TESTEQUALS(half.se, start.se + (moved.se - start.se) / 2);
+}
+
+/**
+ * Units share the shared attributes of their type
+ * and keep their own copies of the unshared ones.
+ */
+void unit_attributes() {
+	UnitContainer container;
+	Player player{nullptr, 1, "owner"};
+	NyanType type{player};
+	type.default_attributes.add(std::make_shared<Attribute<attr_type::speed>>(10));
+	type.default_attributes.add(Attribute<attr_type::damaged>{25});
+	type.default_attributes.add(Attribute<attr_type::resource>{game_resource::wood, 100});
+
+	Unit *first = container.new_unit().get();
+	Unit *second = container.new_unit().get();
+	first->add_attributes(type.default_attributes);
+	second->add_attributes(type.default_attributes);
+
+	TESTEQUALS(&first->get_attribute<attr_type::speed>(), &second->get_attribute<attr_type::speed>());
+	(&first->get_attribute<attr_type::damaged>() != &second->get_attribute<attr_type::damaged>()) or TESTFAIL;
+
+	first->get_attribute<attr_type::damaged>().hp = 5;
+	TESTEQUALS(second->get_attribute<attr_type::damaged>().hp, 25u);
+	TESTEQUALS(type.default_attributes.get<attr_type::damaged>().hp, 25u);
+
+	// unshared attributes are replaced in place
+	first->add_attribute(Attribute<attr_type::damaged>{7});
+	TESTEQUALS(first->get_attribute<attr_type::damaged>().hp, 7u);
+	(not first->has_attribute(attr_type::garrison)) or TESTFAIL;
+	TESTTHROWS(first->get_attribute<attr_type::garrison>());
+
+	// copies keep their own unshared attributes
+	Attributes copy{type.default_attributes};
+	copy.get<attr_type::resource>().amount = 1;
+	TESTEQUALS(type.default_attributes.get<attr_type::resource>().amount, 100);
+	TESTEQUALS(&copy.get<attr_type::speed>(), &type.default_attributes.get<attr_type::speed>());
+	copy.remove(attr_type::resource) or TESTFAIL;
+	(not copy.has(attr_type::resource)) or TESTFAIL;
+	copy.has(attr_type::damaged) or TESTFAIL;
+}
+
+/**
+ * References to removed units must not find the units in their slots.
+ */
+void unit_references() {
+	UnitContainer container;
+	UnitReference invalid;
+	(not invalid.is_valid()) or TESTFAIL;
+	TESTTHROWS(invalid.get());
+
+	UnitReference first = container.new_unit();
+	UnitReference second = container.new_unit();
+	first.is_valid() or TESTFAIL;
+	TESTEQUALS(container.size(), 2);
+
+	// units without actions are removed by the update
+	container.update_all(0);
+	TESTEQUALS(container.size(), 0);
+	(not first.is_valid() and not second.is_valid()) or TESTFAIL;
+
+	// the slots are reused by new units, with new ids
+	UnitReference third = container.new_unit();
+	third.is_valid() or TESTFAIL;
+	(not first.is_valid() and not second.is_valid()) or TESTFAIL;
+	(third.get()->id != first.get_id() and third.get()->id != second.get_id()) or TESTFAIL;
+}
+
+/**
+ * Creates and removes units, then resolves references to the new
+ * and to the removed ones.
+ */
+void benchmark_unit_references() {
+	constexpr size_t unit_count = 100000;
+	constexpr size_t lookups = 10000000;
+
+	UnitContainer container;
+	std::vector<UnitReference> removed;
+	removed.reserve(unit_count);
+	for (size_t i = 0; i < unit_count; i++) {
+		removed.push_back(container.new_unit());
+	}
+	container.update_all(0);
+
+	std::vector<UnitReference> live;
+	live.reserve(unit_count);
+	for (size_t i = 0; i < unit_count; i++) {
+		live.push_back(container.new_unit());
+	}
+
+	// every second lookup is a reference to a removed unit
+	size_t correct = 0;
+	for (size_t i = 0; i < lookups; i++) {
+		size_t index = (i * 7919) % unit_count;
+		if (i % 2 == 0) {
+			correct += live[index].is_valid();
+		}
+		else {
+			correct += not removed[index].is_valid();
+		}
+	}
+	TESTEQUALS(correct, lookups);
+}
+
+/**
+ * Tests units in a crowd with buildings for collisions with their
+ * neighbours, like the passability checks of movement do.
+ */
+void benchmark_collision_tests() {
+	constexpr coord::tile_t size = 64;
+	constexpr coord::phys_t tile = coord::settings::phys_per_tile;
+	constexpr int rounds = 2000;
+
+	auto terrain = std::make_shared<Terrain>(nullptr, coord::tile{0, 0}, coord::tile{size - 1, size - 1});
+	std::vector<int> data(size * size, 0);
+	terrain->fill(data.data(), coord::tile_delta{size, size});
+
+	UnitContainer container;
+	std::vector<TerrainObject *> crowd;
+	for (coord::tile_t ne = 1; ne < size - 1; ne++) {
+		for (coord::tile_t se = 1; se < size - 1; se++) {
+			coord::phys3 pos = coord::tile{ne, se}.to_tile3().to_phys3();
+			Unit *unit = container.new_unit().get();
+
+			// every fourth row is a wall of buildings
+			if (ne % 4 == 0) {
+				unit->make_location<SquareObject>(coord::tile_delta{1, 1}, nullptr);
+			}
+			else {
+				unit->make_location<RadialObject>(0.4f, nullptr);
+				crowd.push_back(unit->location.get());
+			}
+			unit->location->place(terrain, pos, object_state::placed) or TESTFAIL;
+		}
+	}
+
+	size_t collisions = 0;
+	for (int i = 0; i < rounds; i++) {
+		coord::phys3_delta step{(i % 5 - 2) * tile / 8, (i % 3 - 1) * tile / 8, 0};
+		for (TerrainObject *location : crowd) {
+			coord::phys3 pos = location->pos.draw + step;
+			for (coord::tile check_pos : tiles(location->get_range(pos))) {
+				TileContent tc = terrain->get_data(check_pos);
+				if (tc and location->intersects_any(tc.obj, pos)) {
+					collisions += 1;
+					break;
+				}
+			}
+		}
+	}
+	(collisions > 0) or TESTFAIL;
+}
+
+}}} // openage::unit::tests
@@ -1,6 +1,7 @@
 // Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 
@@ -22,7 +23,12 @@ Unit::Unit(UnitContainer *c, id_t id)
 	unit_type{nullptr},
 	selected{false},
 	pop_destructables{false},
-	container(c) {
+	container(c),
+	asleep{false},
+	last_update{0},
+	previous_position{0, 0, 0},
+	has_previous_position{false},
+	wake_at{0} {
 
 }
 
@@ -74,6 +80,14 @@ UnitAction *Unit::before(const UnitAction *action) const {
 	return nullptr;
 }
 
+void Unit::think(time_nsec_t lastframe_duration) {
+	if (this->location && this->has_action()) {
+		// same time as passed to the update
+		auto time_elapsed = lastframe_duration / 1e6;
+		this->top()->think(time_elapsed);
+	}
+}
+
 bool Unit::update(time_nsec_t lastframe_duration) {
 
 	// if unit is not on the map then do nothing
@@ -121,6 +135,34 @@ bool Unit::update(time_nsec_t lastframe_duration) {
 	return true;
 }
 
+time_nsec_t Unit::sleep_time() const {
+	if (!this->location ||
+	    !this->has_action() ||
+	    this->pop_destructables ||
+	    !this->action_secondary.empty() ||
+	    !this->command_queue.empty()) {
+		return 0;
+	}
+	return this->top()->sleep_time();
+}
+
+void Unit::wake() {
+	if (this->asleep.exchange(false)) {
+		this->container->unit_woken(this->id);
+	}
+}
+
+void Unit::fall_asleep() {
+	this->asleep.store(true);
+
+	// pairs with the fence in queue_cmd: either a command queued
+	// meanwhile is seen here, or queue_cmd sees the unit asleep
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!this->command_queue.empty()) {
+		this->wake();
+	}
+}
+
 void Unit::update_secondary(int64_t time_elapsed) {
 	// update secondary actions and remove when completed
 	auto position_it = std::remove_if(
@@ -134,12 +176,14 @@ void Unit::update_secondary(int64_t time_elapsed) {
 }
 
 void Unit::apply_all_cmds() {
-	std::lock_guard<std::mutex> lock(this->command_queue_lock);
-	while (!this->command_queue.empty()) {
-		auto &action = this->command_queue.front();
-		this->apply_cmd(action.first, action.second);
-		this->command_queue.pop();
+	// units without commands only check the queue head
+	if (this->command_queue.empty()) {
+		return;
 	}
+
+	this->command_queue.take_all([this](std::pair<std::shared_ptr<UnitAbility>, Command> &action) {
+		this->apply_cmd(action.first, action.second);
+	});
 }
 
 void Unit::apply_cmd(std::shared_ptr<UnitAbility> ability, const Command &cmd) {
@@ -174,9 +218,15 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 		return;
 	}
 
+	// moving units are drawn between their last two positions
+	coord::phys3 draw_pos = loc->pos.draw;
+	if (loc == this->location.get()) {
+		draw_pos = this->draw_position();
+	}
+
 	// frame specified by the current action
 	auto draw_frame = top_action->current_frame();
-	this->draw(loc->pos.draw, draw_texture, draw_frame);
+	this->draw(draw_pos, draw_texture, draw_frame);
 
 	// draw a shadow if the graphic is available
 	if (grpc.count(graphic_type::shadow) > 0) {
@@ -185,7 +235,7 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 
 			// position without height component
 			// TODO: terrain elevation
-			coord::phys3 shadow_pos = loc->pos.draw;
+			coord::phys3 shadow_pos = draw_pos;
 			shadow_pos.up = 0;
 			this->draw(shadow_pos, draw_shadow, draw_frame);
 		}
@@ -195,6 +245,26 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 	top_action->draw_debug();
 }
 
+coord::phys3 Unit::draw_position() const {
+	coord::phys3 position = this->location->pos.draw;
+
+	// only the units updated in the last step moved since the step before
+	if (not this->has_previous_position or this->container == nullptr or
+	    this->last_update != this->container->now) {
+		return position;
+	}
+
+	float progress = this->container->interpolation;
+	auto blend = [progress](coord::phys_t from, coord::phys_t to) {
+		return from + static_cast<coord::phys_t>((to - from) * progress);
+	};
+	return coord::phys3{
+		blend(this->previous_position.ne, position.ne),
+		blend(this->previous_position.se, position.se),
+		blend(this->previous_position.up, position.up)
+	};
+}
+
 void Unit::draw(coord::phys3 draw_pos, std::shared_ptr<UnitTexture> graphic, unsigned int frame) {
 
 	// players color if available
@@ -232,11 +302,13 @@ void Unit::push_action(std::unique_ptr<UnitAction> action, bool force) {
 	// unit not being deleted -- can control unit
 	if (force || this->accept_commands()) {
 	    this->action_stack.push_back(std::move(action));
+	    this->wake();
 	}
 }
 
 void Unit::secondary_action(std::unique_ptr<UnitAction> action) {
 	this->action_secondary.push_back(std::move(action));
+	this->wake();
 }
 
 void Unit::add_attribute(std::shared_ptr<AttributeContainer> attr) {
@@ -256,15 +328,22 @@ bool Unit::has_attribute(attr_type type) const {
 }
 
 std::shared_ptr<UnitAbility> Unit::queue_cmd(const Command &cmd) {
-	std::lock_guard<std::mutex> lock(this->command_queue_lock);
+	auto ability = this->find_ability(cmd);
+	if (ability) {
+		this->command_queue.push(std::make_pair(ability, cmd));
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		this->wake();
+	}
+	return ability;
+}
 
+std::shared_ptr<UnitAbility> Unit::find_ability(const Command &cmd) {
 	// following the specified ability priority
 	// find suitable ability for this target if available
 	for (auto &ability : ability_priority) {
 		auto pair = this->ability_available.find(ability);
 		if (pair != this->ability_available.end() &&
 		    cmd.ability()[static_cast<int>(pair->first)] && pair->second->can_invoke(*this, cmd)) {
-			command_queue.push(std::make_pair(pair->second, cmd));
 			return pair->second;
 		}
 	}
@@ -273,6 +352,7 @@ std::shared_ptr<UnitAbility> Unit::queue_cmd(const Command &cmd) {
 
 void Unit::delete_unit() {
 	this->pop_destructables = true;
+	this->wake();
 }
 
 void Unit::stop_gather() {
@@ -297,7 +377,7 @@ void Unit::stop_actions() {
 }
 
 UnitReference Unit::get_ref() {
-	return UnitReference(this->container, id, this);
+	return UnitReference(this->container, this->id);
 }
 
 UnitContainer *Unit::get_container() const {
@@ -2,13 +2,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
-#include <mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
-#include <queue>
 
 #include "../coord/phys3.h"
+#include "../datastructure/mpsc_queue.h"
 #include "../handlers.h"
 #include "../log/logsource.h"
 #include "../terrain/terrain_object.h"
@@ -120,11 +121,31 @@ public:
 	 */
 	UnitAction *before(const UnitAction *action) const;
 
+	/**
+	 * prepare the next update of this object, which will use the action
+	 * currently on top of the stack. only reads the game state,
+	 * so units can think in parallel.
+	 */
+	void think(time_nsec_t lastframe_duration);
+
 	/**
 	 * update this object using the action currently on top of the stack
 	 */
 	bool update(time_nsec_t lastframe_duration);
 
+	/**
+	 * how long the updates of this unit can be skipped, 0 if it has to be
+	 * updated. units with commands or secondary actions stay awake,
+	 * otherwise the action on top of the stack decides.
+	 */
+	time_nsec_t sleep_time() const;
+
+	/**
+	 * update a sleeping unit again from the next update on.
+	 * does nothing if the unit is awake, can be called from any thread.
+	 */
+	void wake();
+
 	/**
 	 * draws this action by taking the graphic type of the top action
 	 * the graphic is found from the current graphic set
@@ -138,6 +159,12 @@ public:
 	 */
 	void draw(TerrainObject *loc, const graphic_set &graphics);
 
+	/**
+	 * the position to draw this unit at, between its positions before and
+	 * after its last update, as far as the real time is into the next one.
+	 */
+	coord::phys3 draw_position() const;
+
 	/**
 	 * draws with a specific graphic and frame
 	 */
@@ -174,6 +201,15 @@ public:
 	 */
 	void add_attribute(std::shared_ptr<AttributeContainer> attr);
 
+	/**
+	 * give a copy of the attribute to this unit,
+	 * without allocating it if it's unshared.
+	 */
+	template<attr_type T>
+	void add_attribute(const Attribute<T> &attr) {
+		this->attributes.add(attr);
+	}
+
 	/**
 	 * Give new attributes to this unit.
 	 * This is used to add the default attributes
@@ -197,9 +233,7 @@ public:
 	 */
 	template<attr_type T>
 	Attribute<T> &get_attribute() {
-		return *reinterpret_cast<Attribute<T> *>(attributes.get(T).get());
-		// TODO change to (templates errors)
-		//return attributes.get<T>();
+		return this->attributes.get<T>();
 	}
 
 	/**
@@ -210,6 +244,12 @@ public:
 	 */
 	std::shared_ptr<UnitAbility> queue_cmd(const Command &cmd);
 
+	/**
+	 * the ability that would apply the command if it was queued now,
+	 * nullptr if there is none. only reads the game state.
+	 */
+	std::shared_ptr<UnitAbility> find_ability(const Command &cmd);
+
 	/**
 	 * removes all gather actions without calling their on_complete actions
 	 * this cancels the gathering action completely
@@ -274,14 +314,10 @@ private:
 
 
 	/**
-	 * queue commands to be applied on the next update
+	 * queue commands to be applied on the next update,
+	 * any thread can add to it without locking
 	 */
-	std::queue<std::pair<std::shared_ptr<UnitAbility>, const Command>> command_queue;
-
-	/**
-	 * mutex controlling updates to the command queue
-	 */
-	std::mutex command_queue_lock;
+	datastructure::MPSCQueue<std::pair<std::shared_ptr<UnitAbility>, Command>> command_queue;
 
 
 	/**
@@ -295,6 +331,36 @@ private:
 	 */
 	UnitContainer *container;
 
+	friend class UnitContainer;
+
+	/**
+	 * the container skips the updates of sleeping units
+	 */
+	std::atomic<bool> asleep;
+
+	/**
+	 * time of the container at the last update of this unit
+	 */
+	time_nsec_t last_update;
+
+	/**
+	 * position before the last update, drawing blends from it to
+	 * the current position. only valid if has_previous_position.
+	 */
+	coord::phys3 previous_position;
+	bool has_previous_position;
+
+	/**
+	 * time of the container this unit is woken at,
+	 * 0 if it sleeps until it is woken by an event
+	 */
+	time_nsec_t wake_at;
+
+	/**
+	 * stop updating this unit until it is woken
+	 */
+	void fall_asleep();
+
 	/**
 	 * applies new commands as part of the units update process
 	 */
@@ -302,7 +368,6 @@ private:
 
 	/**
 	 * applies one command using a chosen ability
-	 * locks the command queue mutex while operating
 	 */
 	void apply_cmd(std::shared_ptr<UnitAbility> ability, const Command &cmd);
 
@@ -2,9 +2,14 @@
 
 #include "unit_container.h"
 
+#include <algorithm>
 #include <memory>
 
+#include "../error/error.h"
+#include "../job/job_manager.h"
+#include "../job/parallel.h"
 #include "../log/log.h"
+#include "../pathfinding/path_service.h"
 #include "../terrain/terrain_object.h"
 #include "producer.h"
 #include "unit.h"
@@ -12,55 +17,84 @@
 
 namespace openage {
 
-reference_data::reference_data(const UnitContainer *c, id_t id, Unit *u)
-	:
-	container{c},
-	unit_id{id},
-	unit_ptr{u} {
-	if (!u) {
-		throw Error{MSG(err) << "Cannot reference null unit pointer"};
-	}
-}
+/**
+ * Number of units that think in one job.
+ */
+constexpr size_t think_batch_size = 64;
+
+
+/**
+ * Marks the end of the free list.
+ */
+constexpr uint32_t no_free_slot = UINT32_MAX;
+
+
+/**
+ * Resolution of the wake timers of sleeping units.
+ */
+constexpr time_nsec_t wake_timer_resolution = 1000 * 1000;
 
 
 UnitReference::UnitReference()
 	:
-	data{nullptr} {}
+	container{nullptr},
+	unit_id{0} {}
 
 
-UnitReference::UnitReference(const UnitContainer *c, id_t id, Unit *u)
+UnitReference::UnitReference(const UnitContainer *c, id_t id)
 	:
-	data{std::make_shared<reference_data>(c, id, u)} {}
+	container{c},
+	unit_id{id} {}
 
 
 bool UnitReference::is_valid() const {
-	return this->data &&
-	       this->data->container->valid_id(this->data->unit_id);
+	return this->container &&
+	       this->container->find_unit(this->unit_id) != nullptr;
 }
 
 
 Unit *UnitReference::get() const {
-	if (!this->is_valid()) {
+	Unit *unit = nullptr;
+	if (this->container) {
+		unit = this->container->find_unit(this->unit_id);
+	}
+	if (!unit) {
 		throw Error{MSG(err) << "Unit reference is no longer valid"};
 	}
-	return this->data->unit_ptr;
+	return unit;
 }
 
 
 UnitContainer::UnitContainer()
 	:
-	next_new_id{1} {}
+	first_free{no_free_slot},
+	unit_count{0},
+	wake_timers{wake_timer_resolution},
+	now{0},
+	interpolation{1.0f},
+	think_workers{nullptr} {}
 
 
 UnitContainer::~UnitContainer() {}
 
 
 void UnitContainer::reset() {
-	this->live_units.clear();
+	// the slots are kept, so that old ids stay invalid
+	for (size_t i = 0; i < this->unit_slots.size(); i++) {
+		if (this->unit_slots[i].unit) {
+			this->release_slot((id_t{i} << 32) | this->unit_slots[i].generation);
+		}
+	}
+	this->awake.clear();
+	this->woken.clear();
+	this->wake_timers.clear();
 }
 
 void UnitContainer::set_terrain(std::shared_ptr<Terrain> &t) {
 	this->terrain = t;
+	if (this->path_service) {
+		this->path_service->set_terrain(t);
+	}
 }
 
 std::shared_ptr<Terrain> UnitContainer::get_terrain() const {
@@ -70,36 +104,40 @@ std::shared_ptr<Terrain> UnitContainer::get_terrain() const {
 	return this->terrain.lock();
 }
 
+void UnitContainer::set_job_manager(job::JobManager *job_manager) {
+	this->path_service = std::make_unique<path::PathService>(job_manager);
+	this->path_service->set_terrain(this->terrain.lock());
+	this->set_think_workers(job_manager);
+}
+
+void UnitContainer::set_think_workers(job::JobManager *job_manager) {
+	this->think_workers = job_manager;
+}
+
+path::PathService *UnitContainer::get_path_service() const {
+	return this->path_service.get();
+}
+
 
 bool UnitContainer::valid_id(id_t id) const {
-	return (this->live_units.count(id) > 0);
+	return this->find_unit(id) != nullptr;
 }
 
 
 UnitReference UnitContainer::get_unit(id_t id) {
-	if (this->valid_id(id)) {
-		return UnitReference(this, id, this->live_units[id].get());
-	}
-	else {
-		return UnitReference(this, id, nullptr);
-	}
+	return UnitReference(this, id);
 }
 
 UnitReference UnitContainer::new_unit() {
-	auto id = next_new_id;
-	next_new_id += 1;
-
-	this->live_units.emplace(id, std::make_unique<Unit>(this, id));
-	return this->live_units[id]->get_ref();
+	auto id = this->reserve_slot();
+	return this->insert(std::make_unique<Unit>(this, id));
 }
 
 UnitReference UnitContainer::new_unit(UnitType &type,
                                       Player &owner,
                                       coord::phys3 position) {
 
-	auto new_id = next_new_id;
-	next_new_id += 1;
-
+	auto new_id = this->reserve_slot();
 	auto newobj = std::make_unique<Unit>(this, new_id);
 
 	// try placing unit at this location
@@ -108,19 +146,16 @@ UnitReference UnitContainer::new_unit(UnitType &type,
 	if (placed) {
 		type.initialise(newobj.get(), owner);
 		owner.active_unit_added(newobj.get()); // TODO change, move elsewhere
-		auto id = newobj->id;
-		this->live_units.emplace(id, std::move(newobj));
-		return this->live_units[id]->get_ref();
+		return this->insert(std::move(newobj));
 	}
+	this->release_slot(new_id);
 	return UnitReference(); // is not valid
 }
 
 UnitReference UnitContainer::new_unit(UnitType &type,
                                       Player &owner,
                                       TerrainObject *other) {
-	auto new_id = next_new_id;
-	next_new_id += 1;
-
+	auto new_id = this->reserve_slot();
 	auto newobj = std::make_unique<Unit>(this, new_id);
 
 	// try placing unit
@@ -128,45 +163,213 @@ UnitReference UnitContainer::new_unit(UnitType &type,
 	if (placed) {
 		type.initialise(newobj.get(), owner);
 		owner.active_unit_added(newobj.get()); // TODO change, move elsewhere
-		auto id = newobj->id;
-		this->live_units.emplace(id, std::move(newobj));
-		return this->live_units[id]->get_ref();
+		return this->insert(std::move(newobj));
 	}
+	this->release_slot(new_id);
 	return UnitReference(); // is not valid
 }
 
 
+id_t UnitContainer::reserve_slot() {
+	uint32_t index = this->first_free;
+	if (index == no_free_slot) {
+		index = this->unit_slots.size();
+		this->unit_slots.emplace_back();
+		this->unit_slots.back().generation = 1;
+	}
+	else {
+		this->first_free = this->unit_slots[index].next_free;
+	}
+	return (id_t{index} << 32) | this->unit_slots[index].generation;
+}
+
+
+UnitReference UnitContainer::insert(std::unique_ptr<Unit> unit) {
+	id_t id = unit->id;
+	unit_slot &slot = this->unit_slots[id >> 32];
+	ENSURE(not slot.unit and slot.generation == static_cast<uint32_t>(id),
+	       "unit inserted into a slot that was not reserved for it");
+
+	slot.unit = std::move(unit);
+	slot.unit->last_update = this->now;
+	this->unit_count += 1;
+
+	// new units are updated from the next update on
+	this->woken.push(id);
+	return UnitReference(this, id);
+}
+
+
+void UnitContainer::release_slot(id_t id) {
+	uint32_t index = id >> 32;
+	unit_slot &slot = this->unit_slots[index];
+
+	// the slot is freed before the unit is destroyed,
+	// which may create or look up other units
+	std::unique_ptr<Unit> unit = std::move(slot.unit);
+	if (unit) {
+		this->unit_count -= 1;
+	}
+
+	slot.generation += 1;
+	if (slot.generation == 0) {
+		// generation 0 would allow an id of 0
+		slot.generation = 1;
+	}
+	slot.next_free = this->first_free;
+	this->first_free = index;
+}
+
+
 bool dispatch_command(id_t, const Command &) {
 	return true;
 }
 
 bool UnitContainer::update_all(time_nsec_t lastframe_duration) {
+	this->now += lastframe_duration;
+	time_nsec_t step_start = timing::get_monotonic_time();
+	auto step_end = [&step_start](time_nsec_t &step) {
+		time_nsec_t step_now = timing::get_monotonic_time();
+		step += step_now - step_start;
+		step_start = step_now;
+	};
+
+	// units created during the update are updated from the next one on
+	std::vector<Unit *> units = this->awake_units();
+	step_end(this->timing.wake);
+
+	// prepare the updates from the current state of the game
+	this->think_all(units);
+	step_end(this->timing.think);
+
 	// update everything and find objects with no actions
 	std::vector<id_t> to_remove;
+	this->awake.clear();
 
-	for (auto &obj : this->live_units) {
-		obj.second->update(lastframe_duration);
+	for (Unit *unit : units) {
+		// units that slept get the time that passed meanwhile
+		time_nsec_t elapsed = this->now - unit->last_update;
+		unit->last_update = this->now;
 
-		if (not obj.second->has_action()) {
-			to_remove.push_back(obj.first);
+		// drawing blends between the positions before and after the update
+		unit->has_previous_position = (unit->location != nullptr);
+		if (unit->has_previous_position) {
+			unit->previous_position = unit->location->pos.draw;
+		}
+		unit->update(elapsed);
+
+		if (not unit->has_action()) {
+			to_remove.push_back(unit->id);
+			continue;
+		}
+
+		time_nsec_t sleep_time = unit->sleep_time();
+		if (sleep_time == 0) {
+			this->awake.push_back(unit->id);
+		}
+		else {
+			this->sleep(unit, sleep_time);
 		}
 	}
+	step_end(this->timing.update);
 
 	// cleanup and removal of objects
 	for (auto &obj : to_remove) {
 
 		// unique pointer triggers cleanup
-		this->live_units.erase(obj);
+		this->release_slot(obj);
 	}
+	step_end(this->timing.removal);
+
+	// start the path searches requested in this update
+	if (this->path_service) {
+		this->path_service->update();
+	}
+	step_end(this->timing.path_search);
 	return true;
 }
 
+void UnitContainer::think_all(const std::vector<Unit *> &units) {
+	time_nsec_t now = this->now;
+	auto think = [&units, now](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			units[i]->think(now - units[i]->last_update);
+		}
+	};
+
+	job::parallel_for(this->think_workers, 0, units.size(), think_batch_size, think);
+}
+
 std::vector<Unit *> UnitContainer::all_units() {
 	std::vector<Unit *> result;
-	for (auto &u : this->live_units) {
-		result.push_back(u.second.get());
+	result.reserve(this->unit_count);
+	for (auto &slot : this->unit_slots) {
+		if (slot.unit) {
+			result.push_back(slot.unit.get());
+		}
+	}
+	return result;
+}
+
+size_t UnitContainer::size() const {
+	return this->unit_count;
+}
+
+size_t UnitContainer::awake_count() const {
+	return this->awake.size();
+}
+
+const update_timing &UnitContainer::get_timing() const {
+	return this->timing;
+}
+
+void UnitContainer::set_interpolation(float progress) {
+	this->interpolation = progress;
+}
+
+std::vector<Unit *> UnitContainer::awake_units() {
+	this->wake_timers.advance(this->now, [this](const wake_timer &timer) {
+		// the unit may have been woken and fallen asleep again since
+		Unit *unit = this->find_unit(timer.second);
+		if (unit and unit->wake_at == timer.first) {
+			unit->wake();
+		}
+	});
+
+	// merge the woken units, the ids stay ordered
+	size_t stayed_awake = this->awake.size();
+	this->woken.take_all([this](id_t id) {
+		this->awake.push_back(id);
+	});
+	auto middle = std::begin(this->awake) + stayed_awake;
+	std::sort(middle, std::end(this->awake));
+	std::inplace_merge(std::begin(this->awake), middle, std::end(this->awake));
+	this->awake.erase(std::unique(std::begin(this->awake), std::end(this->awake)),
+	                  std::end(this->awake));
+
+	std::vector<Unit *> result;
+	result.reserve(this->awake.size());
+	for (id_t id : this->awake) {
+		// removed units leave their ids behind
+		Unit *unit = this->find_unit(id);
+		if (unit) {
+			result.push_back(unit);
+		}
 	}
 	return result;
 }
 
+void UnitContainer::sleep(Unit *unit, time_nsec_t duration) {
+	unit->wake_at = 0;
+	if (duration != sleep_until_woken) {
+		unit->wake_at = this->now + duration;
+		this->wake_timers.add(unit->wake_at, wake_timer{unit->wake_at, unit->id});
+	}
+	unit->fall_asleep();
+}
+
+void UnitContainer::unit_woken(id_t id) {
+	this->woken.push(id);
+}
+
 } // namespace openage
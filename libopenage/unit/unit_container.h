@@ -2,11 +2,15 @@
 
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../coord/tile.h"
+#include "../datastructure/mpsc_queue.h"
+#include "../datastructure/timer_wheel.h"
 #include "../handlers.h"
 #include "../util/timing.h"
 
@@ -21,27 +25,38 @@ class Unit;
 class UnitContainer;
 class UnitType;
 
+namespace job {
+class JobManager;
+} // namespace job
+
+namespace path {
+class PathService;
+} // namespace path
+
 
 /**
  * Type used to identify each single unit in the game.
+ *
+ * The upper half is the index of the unit's slot in its container,
+ * the lower half the generation of the slot. A removed unit's id
+ * stays invalid even if a new unit gets the slot.
  */
-using id_t = unsigned long int;
+using id_t = uint64_t;
 
 
 /**
- * immutable reference data
+ * Sleep time of units that are only woken by events,
+ * such as commands or other units acting on them.
  */
-struct reference_data {
-	reference_data(const UnitContainer *c, id_t id, Unit *);
+constexpr time_nsec_t sleep_until_woken = std::numeric_limits<time_nsec_t>::max();
 
-	const UnitContainer *const container;
-	const id_t unit_id;
-	Unit *const unit_ptr;
-};
 
 /**
  * Reference to a single unit, which may have been removed
  * from the game, check is_valid() before calling get()
+ *
+ * References are plain values, copying them is free and
+ * checking them compares the id with the unit's slot.
  */
 class UnitReference {
 public:
@@ -54,23 +69,42 @@ public:
 	/**
 	 * create referece by unit id
 	 */
-	UnitReference(const UnitContainer *c, id_t id, Unit *);
+	UnitReference(const UnitContainer *c, id_t id);
 
 	bool is_valid() const;
 	Unit *get() const;
 
-private:
-
 	/**
-	 * The default copy constructor and assignment
-	 * will just copy the shared pointer
+	 * id of the referenced unit, which may have been removed
 	 */
-	std::shared_ptr<reference_data> data;
+	id_t get_id() const {
+		return this->unit_id;
+	}
+
+private:
+	const UnitContainer *container;
+	id_t unit_id;
+};
+
+/**
+ * real time spent in the steps of UnitContainer::update_all,
+ * summed up over all updates
+ */
+struct update_timing {
+	time_nsec_t wake = 0;
+	time_nsec_t think = 0;
+	time_nsec_t update = 0;
+	time_nsec_t removal = 0;
+	time_nsec_t path_search = 0;
 };
 
 /**
  * the list of units that are currently in use
  * will also give a view of the current game state for networking in later milestones
+ *
+ * units are kept in a slot map: a vector of slots which are reused through
+ * a free list. looking up an id is an index and a generation compare,
+ * removal frees the slot in O(1) and iterating sweeps the slots in order.
  */
 class UnitContainer {
 public:
@@ -89,11 +123,45 @@ public:
 	 */
 	std::shared_ptr<Terrain> get_terrain() const;
 
+	/**
+	 * run the path searches of units on the workers of a job manager,
+	 * the units also think on them
+	 */
+	void set_job_manager(job::JobManager *job_manager);
+
+	/**
+	 * let units think on the workers of a job manager,
+	 * nullptr lets them think on the updating thread.
+	 * unlike set_job_manager, path searches are not affected.
+	 */
+	void set_think_workers(job::JobManager *job_manager);
+
+	/**
+	 * service for asynchronous path searches,
+	 * nullptr if units have to search synchronously
+	 */
+	path::PathService *get_path_service() const;
+
 	/**
 	 * checks the id is valid
 	 */
 	bool valid_id(id_t id) const;
 
+	/**
+	 * the unit with the given id, nullptr if it was removed
+	 */
+	Unit *find_unit(id_t id) const {
+		size_t index = id >> 32;
+		if (index >= this->unit_slots.size()) {
+			return nullptr;
+		}
+		const unit_slot &slot = this->unit_slots[index];
+		if (slot.generation != static_cast<uint32_t>(id)) {
+			return nullptr;
+		}
+		return slot.unit.get();
+	}
+
 	/**
 	 * returns a reference to a unit
 	 */
@@ -123,26 +191,162 @@ public:
 	/**
 	 * update dispatched by the game engine on each physics tick.
 	 * this will update all game objects.
+	 *
+	 * first all units think in parallel, which only reads the game state,
+	 * then they are updated one after another in the order of their ids,
+	 * which is the order of their slots.
+	 * the result does not depend on the number of think workers.
+	 *
+	 * sleeping units are skipped until they are woken, either by an
+	 * event or by the timer their action asked for.
 	 */
 	bool update_all(time_nsec_t lastframe_duration);
 
 	/**
-	 * gets a list of all units in the container
+	 * gets a list of all units in the container, ordered by their ids
 	 */
 	std::vector<openage::Unit *> all_units();
 
+	/**
+	 * number of units in the container
+	 */
+	size_t size() const;
+
+	/**
+	 * number of units that stayed awake after the last update
+	 */
+	size_t awake_count() const;
+
+	/**
+	 * time the updates took so far, by step
+	 */
+	const update_timing &get_timing() const;
+
+	/**
+	 * set how far the real time is into the next update, from 0 to 1.
+	 * units are drawn between their positions before and after the last one.
+	 */
+	void set_interpolation(float progress);
+
 private:
-	id_t next_new_id;
+	friend class Unit;
+
+	struct unit_slot {
+		/**
+		 * the unit in this slot, nullptr if the slot is free or reserved
+		 */
+		std::unique_ptr<Unit> unit;
+
+		/**
+		 * lower half of the id the unit in this slot has,
+		 * advanced whenever the slot is freed
+		 */
+		uint32_t generation;
+
+		/**
+		 * index of the next free slot in the free list
+		 */
+		uint32_t next_free;
+	};
+
+	/**
+	 * take a slot from the free list, or a new one.
+	 * the returned id is invalid until a unit is put into the slot.
+	 */
+	id_t reserve_slot();
 
 	/**
-	 * mapping unit ids to unit objects
+	 * put the unit into the slot its id was reserved in
 	 */
-	std::unordered_map<id_t, std::unique_ptr<Unit>> live_units;
+	UnitReference insert(std::unique_ptr<Unit> unit);
+
+	/**
+	 * destroy the unit with the id, if any, and free its slot
+	 */
+	void release_slot(id_t id);
+
+	/**
+	 * let the units prepare their updates, split into
+	 * batches for the think workers if there are any
+	 */
+	void think_all(const std::vector<Unit *> &units);
+
+	/**
+	 * the units to update now: the ones that stayed awake,
+	 * the woken ones and the ones with expired timers, ordered by id
+	 */
+	std::vector<Unit *> awake_units();
+
+	/**
+	 * skip the updates of a unit for the given time
+	 */
+	void sleep(Unit *unit, time_nsec_t duration);
+
+	/**
+	 * update the unit again from the next update on,
+	 * called by Unit::wake from any thread
+	 */
+	void unit_woken(id_t id);
+
+	/**
+	 * units indexed by the upper half of their ids
+	 */
+	std::vector<unit_slot> unit_slots;
+
+	/**
+	 * first slot of the free list
+	 */
+	uint32_t first_free;
+
+	size_t unit_count;
+
+	/**
+	 * ids of the units that stayed awake after the last update, ordered
+	 */
+	std::vector<id_t> awake;
+
+	/**
+	 * ids of units that were woken or created since the last update
+	 */
+	datastructure::MPSCQueue<id_t> woken;
+
+	/**
+	 * time a sleeping unit asked to be woken at, and its id
+	 */
+	using wake_timer = std::pair<time_nsec_t, id_t>;
+
+	/**
+	 * timers of the sleeping units, so their actions don't have
+	 * to be updated just to count the time
+	 */
+	datastructure::TimerWheel<wake_timer> wake_timers;
+
+	/**
+	 * sum of all update durations
+	 */
+	time_nsec_t now;
+
+	/**
+	 * how far the real time is into the next update, see set_interpolation
+	 */
+	float interpolation;
 
 	/**
 	 * Terrain for initialising new units
 	 */
 	std::weak_ptr<Terrain> terrain;
+
+	/**
+	 * path searches, started at the end of each update
+	 */
+	std::unique_ptr<path::PathService> path_service;
+
+	/**
+	 * workers the units think on, nullptr if they think on the updating thread
+	 */
+	job::JobManager *think_workers;
+
+	update_timing timing;
 };
 
 } // namespace openage
@@ -65,7 +65,7 @@ TerrainObject *UnitType::place_beside(Unit *u, TerrainObject const *other) const
 
 	// find a free position adjacent to the object
 	auto terrain = other->get_terrain();
-	for (coord::tile temp_pos : tile_list(outline)) {
+	for (coord::tile temp_pos : tiles(outline)) {
 		TerrainChunk *chunk = terrain->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -7,6 +7,7 @@
 #ifdef _WIN32
 // TODO not yet implemented
 #else
+#include <sys/resource.h>
 #include <unistd.h>
 #endif
 
@@ -123,5 +124,25 @@ int execute_file(const char *path, bool background) {
 #endif
 }
 
+size_t peak_memory_usage() {
+#ifdef _WIN32
+	// TODO not yet implemented
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+
+#ifdef __APPLE__
+	// bytes on macOS
+	return usage.ru_maxrss;
+#else
+	// kilobytes everywhere else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
 } // namespace os
 } // namespace openage
@@ -1,7 +1,8 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace openage {
@@ -26,5 +27,11 @@ std::string self_exec_filename();
  */
 int execute_file(const char *path, bool background=true);
 
+/**
+ * returns the most memory this process has used so far, in bytes.
+ * 0 if it can't be determined on this platform.
+ */
+size_t peak_memory_usage();
+
 } // namespace os
 } // namespace openage
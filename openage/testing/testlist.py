@@ -69,14 +69,29 @@ def tests_cpp():
 
     yield "openage::coord::tests::coord"
     yield "openage::datastructure::tests::constexpr_map"
+    yield "openage::datastructure::tests::mpmc_queue"
+    yield "openage::datastructure::tests::mpsc_queue"
     yield "openage::datastructure::tests::pairing_heap"
+    yield "openage::datastructure::tests::spsc_queue"
+    yield "openage::datastructure::tests::timer_wheel"
+    yield "openage::gamestate::tests::headless_game", "headless game"
+    yield "openage::gamestate::tests::headless_game_workers", "headless game on workers"
+    yield "openage::gamestate::tests::load_terrain", "saved terrain outside of the regions"
+    yield "openage::gamestate::tests::simulation_clock"
     yield "openage::job::tests::test_job_manager"
+    yield "openage::job::tests::test_parallel", "parallel loops and task graphs"
     yield "openage::path::tests::path_node", "pathfinding"
     yield "openage::pyinterface::tests::pyobject"
     yield "openage::pyinterface::tests::err_py_to_cpp"
     yield "openage::renderer::tests::font"
     yield "openage::renderer::tests::font_manager"
     yield "openage::rng::tests::run"
+    yield "openage::terrain::tests::terrain_storage"
+    yield "openage::unit::tests::unit_attributes", "unit attributes"
+    yield "openage::unit::tests::unit_draw_position", "unit drawing between updates"
+    yield "openage::unit::tests::unit_references", "unit storage"
+    yield "openage::unit::tests::unit_sleeping", "sleeping units"
+    yield "openage::unit::tests::update_determinism", "unit updates"
     yield "openage::util::tests::constinit_vector"
     yield "openage::util::tests::enum_"
     yield "openage::util::tests::init"
@@ -99,6 +114,8 @@ def demos_cpp():
            "showcases console as an interactive terminal on your current tty")
     yield ("openage::error::demo",
            "showcases the openage exceptions, including backtraces")
+    yield ("openage::gamestate::tests::headless_game_demo",
+           "plays a game without graphics and reports the simulation speed")
     yield ("openage::log::tests::demo",
            "showcases the logging system")
     yield ("openage::pyinterface::tests::err_py_to_cpp_demo",
@@ -113,5 +130,30 @@ def benchmark_cpp():
     methods.
     """
 
-    # TODO Add a real benchmark here!
     yield ("openage::test::benchmark", "Test the benchmark")
+    yield ("openage::datastructure::tests::benchmark_queues",
+           "bounded queues against the locked queue under contention")
+    yield ("openage::gamestate::tests::benchmark_headless_game",
+           "villagers gathering and soldiers fighting in a headless game")
+    yield ("openage::job::tests::benchmark_tiny_jobs",
+           "a million tiny jobs on one to all hardware threads")
+    yield ("openage::job::tests::benchmark_fork_join",
+           "jobs that enqueue jobs on one to all hardware threads")
+    yield ("openage::path::tests::benchmark_a_star",
+           "A* searches using the reusable search context")
+    yield ("openage::path::tests::benchmark_jump_point_search",
+           "jump point searches on the A* benchmark scenarios")
+    yield ("openage::path::tests::benchmark_a_star_reference",
+           "A* searches using the former shared node implementation")
+    yield ("openage::terrain::tests::benchmark_sequential_tile_access",
+           "tile lookups in order on a finite terrain")
+    yield ("openage::terrain::tests::benchmark_random_tile_access",
+           "tile lookups at random positions on a finite terrain")
+    yield ("openage::terrain::tests::benchmark_sequential_tile_access_infinite",
+           "tile lookups in order on an infinite terrain")
+    yield ("openage::terrain::tests::benchmark_random_tile_access_infinite",
+           "tile lookups at random positions on an infinite terrain")
+    yield ("openage::unit::tests::benchmark_collision_tests",
+           "collision tests of units in a crowd with buildings")
+    yield ("openage::unit::tests::benchmark_unit_references",
+           "create and remove units, then look up references to them")